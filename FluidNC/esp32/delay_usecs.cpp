@@ -1,6 +1,7 @@
 #include "Driver/delay_usecs.h"
 
 #include <esp_attr.h>  // IRAM_ATTR
+#include <esp_timer.h>
 #include <xtensa/core-macros.h>
 
 #include <sdkconfig.h>
@@ -58,3 +59,7 @@ void IRAM_ATTR spinUntil(int32_t endTicks) {
 int32_t IRAM_ATTR getCpuTicks() {
     return XTHAL_GET_CCOUNT();
 }
+
+uint32_t IRAM_ATTR getUsecs() {
+    return uint32_t(esp_timer_get_time());
+}
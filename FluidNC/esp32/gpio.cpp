@@ -5,6 +5,7 @@
 #include "src/Uart.h"
 #include "src/Protocol.h"
 #include "Driver/fluidnc_gpio.h"
+#include "Driver/delay_usecs.h"  // getUsecs()
 
 #include "driver/gpio.h"
 #include "hal/gpio_hal.h"
@@ -85,21 +86,26 @@ static gpio_mask_t gpios_current  = 0;  // The last GPIO action events that were
 static int32_t gpio_next_event_ticks[GPIO_NUM_MAX + 1] = { 0 };
 static int32_t gpio_deltat_ticks[GPIO_NUM_MAX + 1]     = { 0 };
 
+// gpios_current and the rate limit are shared between poll_gpios() and the edge interrupt
+static portMUX_TYPE gpio_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static gpio_edge_callback_t gpioEdgeCallbacks[GPIO_NUM_MAX + 1] = { nullptr };
+
 // Do not send events for changes that occur too soon
 static void gpio_set_rate_limit(int gpio_num, uint32_t ms) {
     gpio_deltat_ticks[gpio_num] = ms * portTICK_PERIOD_MS;
 }
 
-static inline gpio_mask_t get_gpios() {
+static inline IRAM_ATTR gpio_mask_t get_gpios() {
     return ((((uint64_t)REG_READ(GPIO_IN1_REG)) << 32) | REG_READ(GPIO_IN_REG)) ^ gpios_inverted;
 }
-static gpio_mask_t gpio_mask(int gpio_num) {
+static inline IRAM_ATTR gpio_mask_t gpio_mask(int gpio_num) {
     return 1ULL << gpio_num;
 }
-static inline int gpio_is_active(int gpio_num) {
+static inline IRAM_ATTR int gpio_is_active(int gpio_num) {
     return get_gpios() & gpio_mask(gpio_num);
 }
-static void gpios_update(gpio_mask_t& gpios, int gpio_num, bool active) {
+static inline IRAM_ATTR void gpios_update(gpio_mask_t& gpios, int gpio_num, bool active) {
     if (active) {
         gpios |= gpio_mask(gpio_num);
     } else {
@@ -121,31 +127,85 @@ void gpio_set_event(int gpio_num, void* arg, int invert) {
     gpios_update(gpios_current, gpio_num, !active);
 }
 void gpio_clear_event(int gpio_num) {
+    if (gpioEdgeCallbacks[gpio_num]) {
+        gpio_isr_handler_remove((gpio_num_t)gpio_num);
+        gpio_set_intr_type((gpio_num_t)gpio_num, GPIO_INTR_DISABLE);
+        gpioEdgeCallbacks[gpio_num] = nullptr;
+    }
     gpioArgs[gpio_num] = nullptr;
     gpios_update(gpios_interest, gpio_num, false);
 }
 
-static void gpio_send_event(int gpio_num, bool active) {
-    auto    end_ticks  = gpio_next_event_ticks[gpio_num];
-    int32_t this_ticks = int32_t(xTaskGetTickCount());
-    if (end_ticks == 0 || ((this_ticks - end_ticks) > 0)) {
-        end_ticks = this_ticks + gpio_deltat_ticks[gpio_num];
-        if (end_ticks == 0) {
-            end_ticks = 1;
-        }
-        gpio_next_event_ticks[gpio_num] = end_ticks;
+// Records a change as sent, unless it is too soon after the last one.
+// Must be called with gpio_mux held.
+static IRAM_ATTR bool gpio_accept_change(int gpio_num, bool active, int32_t this_ticks) {
+    auto end_ticks = gpio_next_event_ticks[gpio_num];
+    if (end_ticks != 0 && ((this_ticks - end_ticks) <= 0)) {
+        return false;
+    }
+    end_ticks = this_ticks + gpio_deltat_ticks[gpio_num];
+    if (end_ticks == 0) {
+        end_ticks = 1;
+    }
+    gpio_next_event_ticks[gpio_num] = end_ticks;
+    gpios_update(gpios_current, gpio_num, active);
+    return true;
+}
 
+static void gpio_send_event(int gpio_num, bool active) {
+    portENTER_CRITICAL(&gpio_mux);
+    bool accepted = gpio_accept_change(gpio_num, active, int32_t(xTaskGetTickCount()));
+    portEXIT_CRITICAL(&gpio_mux);
+    if (accepted) {
         auto arg = gpioArgs[gpio_num];
         if (arg) {
             protocol_send_event_from_ISR(active ? &pinActiveEvent : &pinInactiveEvent, arg);
         }
-        gpios_update(gpios_current, gpio_num, active);
     }
 }
 
+// Pin change interrupt for GPIOs with an edge callback.  The callback runs right
+// away with a timestamp, for actions that cannot wait for the next poll_gpios().
+// The change is then sent as an event like a polled one.  Changes inside the rate
+// limit window are ignored here and picked up by poll_gpios() when it expires.
+static void IRAM_ATTR gpio_edge_isr(void* arg) {
+    int      gpio_num = int(intptr_t(arg));
+    uint32_t usecs    = getUsecs();
+    bool     active   = gpio_is_active(gpio_num);
+
+    portENTER_CRITICAL_ISR(&gpio_mux);
+    bool changed = active != bool(gpios_current & gpio_mask(gpio_num));
+    if (changed) {
+        changed = gpio_accept_change(gpio_num, active, int32_t(xTaskGetTickCountFromISR()));
+    }
+    portEXIT_CRITICAL_ISR(&gpio_mux);
+
+    if (changed && gpioArgs[gpio_num]) {
+        gpioEdgeCallbacks[gpio_num](gpioArgs[gpio_num], active, usecs);
+        protocol_send_event_from_ISR(active ? &pinActiveEvent : &pinInactiveEvent, gpioArgs[gpio_num]);
+    }
+}
+
+void gpio_set_edge_callback(int gpio_num, gpio_edge_callback_t callback) {
+    gpioEdgeCallbacks[gpio_num] = callback;
+
+    // The ISR service is installed without ESP_INTR_FLAG_IRAM, so the interrupt is held off
+    // while the flash cache is disabled, and an edge during a flash write is seen when the
+    // write ends or by poll_gpios().  It cannot be IRAM-safe anyway, because the callback
+    // calls the pin's virtual edge(), whose vtable is in flash.  The functions it reaches
+    // are still IRAM_ATTR, so that a cache miss does not add to the latency.
+    gpio_install_isr_service(0);  // Returns an error if it is already installed, which is harmless
+    gpio_num_t gpio = (gpio_num_t)gpio_num;
+    gpio_set_intr_type(gpio, GPIO_INTR_ANYEDGE);
+    gpio_isr_handler_add(gpio, gpio_edge_isr, (void*)intptr_t(gpio_num));
+    gpio_intr_enable(gpio);
+}
+
 void poll_gpios() {
-    gpio_mask_t gpios_active  = get_gpios();
+    gpio_mask_t gpios_active = get_gpios();
+    portENTER_CRITICAL(&gpio_mux);
     gpio_mask_t gpios_changed = (gpios_active ^ gpios_current) & gpios_interest;
+    portEXIT_CRITICAL(&gpio_mux);
     if (gpios_changed) {
         int zeros;
         while ((zeros = __builtin_clzll(gpios_changed)) != 64) {
@@ -5,10 +5,10 @@
 // the FIFO is below a set threshold.  The ISR pushes samples into the FIFO, representing
 // step pulses and inter-pulse delays.  There are variables for the value to push for
 // a pulse, the number of samples for that pulse, the value to push to the delay, and
-// the number of samples for the delay.  When the delay is done, the ISR calls the Stepper
-// pulse_func to determine the new values of those variables. The FIFO lets the ISR stay
-// just far enough ahead so the information is always ready, but not so far ahead to cause
-// latency problems.
+// the number of samples for the delay.  When the delay is done, the ISR takes the next
+// event from the current batch, calling the Stepper pulse_func for a new batch when that
+// one is used up.  The FIFO lets the ISR stay just far enough ahead so the information
+// is always ready, but not so far ahead to cause latency problems.
 
 #include "Driver/step_engine.h"
 #include "Driver/i2s_out.h"
@@ -330,6 +330,17 @@ static uint32_t _pulse_data;
 static uint32_t _delay_counts = 40;
 static uint32_t _tick_divisor;
 
+// Batched step events.  Each event is recorded as the pins to set and the
+// pins to clear relative to i2s_out_port_data, instead of as a complete
+// port value, so changes to non-stepping I2S outputs that happen while the
+// batch is being played out are not overwritten by stale data.
+#define I2S_BATCH_MAX 16
+
+static uint32_t _batch_set[I2S_BATCH_MAX];
+static uint32_t _batch_clear[I2S_BATCH_MAX];
+static uint32_t _batch_count = 0;
+static uint32_t _batch_index = 0;
+
 static void IRAM_ATTR set_timer_ticks(uint32_t ticks) {
     if (ticks) {
         _delay_counts = ticks / _tick_divisor;
@@ -369,20 +380,29 @@ static void IRAM_ATTR i2s_isr() {
             --i;
             --remaining_delay_counts;
         } else {
-            // Set _pulse_data to the non-pulse value in case pulse_func() does nothing,
-            // which can happen if it is not awake
-            _pulse_data = i2s_out_port_data;
+            if (_batch_index == _batch_count) {
+                // The batch is used up, so get another one.  If pulse_func()
+                // does nothing, which can happen if it is not awake, the batch
+                // stays empty and we output the non-pulse value.
+                _batch_count = 0;
+                _batch_index = 0;
+
+                _pulse_func();
+            }
+            if (_batch_index < _batch_count) {
+                pulse_data = (i2s_out_port_data | _batch_set[_batch_index]) & ~_batch_clear[_batch_index];
+                ++_batch_index;
+            } else {
+                pulse_data = i2s_out_port_data;
+            }
 
-            _pulse_func();
-
-            // Reload from variables that could have been modified by pulse_func
-            pulse_data             = _pulse_data;
             remaining_pulse_counts = pulse_data == i2s_out_port_data ? 0 : _pulse_counts;
             remaining_delay_counts = _delay_counts - remaining_pulse_counts;
         }
     } while (i);
 
-    // Save the counts back to the variables
+    // Save the pulse state back to the variables
+    _pulse_data             = pulse_data;
     _remaining_pulse_counts = remaining_pulse_counts;
     _remaining_delay_counts = remaining_delay_counts;
 
@@ -421,6 +441,8 @@ static uint32_t init_engine(uint32_t dir_delay_us, uint32_t pulse_us, uint32_t f
 
     _remaining_pulse_counts = 0;
     _remaining_delay_counts = 0;
+    _batch_count            = 0;
+    _batch_index            = 0;
 
     // gpio_mode(12, 0, 1, 0, 0, 0);
 
@@ -453,19 +475,22 @@ static IRAM_ATTR void finish_dir() {
 }
 
 static void IRAM_ATTR start_step() {
-    _pulse_data = i2s_out_port_data;
+    _batch_set[_batch_count]   = 0;
+    _batch_clear[_batch_count] = 0;
 }
 
 static IRAM_ATTR void set_step_pin(int pin, int level) {
     uint32_t bit = 1 << pin;
     if (level) {
-        _pulse_data |= bit;
+        _batch_set[_batch_count] |= bit;
     } else {
-        _pulse_data &= ~bit;
+        _batch_clear[_batch_count] |= bit;
     }
 }
 
-static void IRAM_ATTR finish_step() {}
+static void IRAM_ATTR finish_step() {
+    ++_batch_count;
+}
 
 static int IRAM_ATTR start_unstep() {
     return 1;
@@ -478,6 +503,20 @@ static uint32_t max_pulses_per_sec() {
     return 1000000 / (2 * _pulse_counts * i2s_frame_us);
 }
 
+// The batch size is limited by the event array and by STEP_BATCH_MAX_US
+// at the current step period.
+static uint32_t IRAM_ATTR start_batch() {
+    uint32_t n = STEP_BATCH_MAX_US / (_delay_counts * i2s_frame_us);
+    if (n > I2S_BATCH_MAX) {
+        n = I2S_BATCH_MAX;
+    }
+    return n ? n : 1;
+}
+
+// The ISR plays out the events one step period apart and calls
+// pulse_func() again when they have all been used.
+static void IRAM_ATTR finish_batch(uint32_t n_events) {}
+
 // clang-format off
 step_engine_t i2s_engine = {
     "I2S",
@@ -493,7 +532,9 @@ step_engine_t i2s_engine = {
     max_pulses_per_sec,
     set_timer_ticks,
     start_timer,
-    stop_timer
+    stop_timer,
+    start_batch,
+    finish_batch
 };
 // clang-format on
 REGISTER_STEP_ENGINE(I2S, &i2s_engine);
@@ -0,0 +1,14 @@
+#include "Driver/psram.h"
+#include "esp_heap_caps.h"
+
+void* psram_alloc(size_t size) {
+    void* ptr = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!ptr) {
+        ptr = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    return ptr;
+}
+
+void psram_free(void* ptr) {
+    heap_caps_free(ptr);
+}
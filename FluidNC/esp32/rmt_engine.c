@@ -3,6 +3,11 @@
 
 // Stepping engine that uses the ESP32 RMT hardware to time step pulses, thus avoiding
 // the need to wait for the end of step pulses.
+//
+// Step events are batched.  Each pulse_func call writes a run of step events
+// into the RMT channel memories as (delay, pulse) items spaced one step period
+// apart, starts the channels, and sets the step timer to fire when the run
+// is done.  That cuts the interrupt rate by the batch size.
 
 #include "Driver/step_engine.h"
 #include "Driver/fluidnc_gpio.h"
@@ -10,14 +15,30 @@
 #include <driver/rmt.h>
 #include <esp32-hal-gpio.h>
 #include <esp_attr.h>  // IRAM_ATTR
+#include <soc/rmt_struct.h>
+
+// The RMT clock is APB (80 MHz) / clk_div (20) = 4 MHz
+#define RMT_TICKS_PER_US 4
 
 static uint32_t _pulse_delay_us;
 static uint32_t _dir_delay_us;
 
+static uint32_t _timer_ticks;          // Step timer ticks per step event
+static uint32_t _timer_ticks_per_rmt;  // Step timer ticks per RMT tick
+
+// Per-channel batch state
+static int      _n_channels = 0;
+static uint32_t _idle_level[RMT_CHANNEL_MAX];
+static uint32_t _n_items[RMT_CHANNEL_MAX];  // Items written in this batch
+static uint32_t _cursor[RMT_CHANNEL_MAX];   // End time of the last item, in RMT ticks
+
+static uint32_t _event;  // Index of the current step event within the batch
+
 static uint32_t init_engine(uint32_t dir_delay_us, uint32_t pulse_delay_us, uint32_t frequency, bool (*callback)(void)) {
     stepTimerInit(frequency, callback);
-    _dir_delay_us   = dir_delay_us;
-    _pulse_delay_us = pulse_delay_us;
+    _dir_delay_us        = dir_delay_us;
+    _pulse_delay_us      = pulse_delay_us;
+    _timer_ticks_per_rmt = frequency / (RMT_TICKS_PER_US * 1000000);
     return _pulse_delay_us;
 }
 
@@ -37,7 +58,7 @@ static int init_step_pin(int step_pin, int step_inverted) {
                                .channel       = rmt_chan_num,
                                .gpio_num      = (gpio_num_t)step_pin,
                                .clk_div       = 20,
-                               .mem_block_num = 2,
+                               .mem_block_num = 1,
                                .flags         = 0,
                                .tx_config     = {
                                        .carrier_freq_hz      = 0,
@@ -52,16 +73,11 @@ static int init_step_pin(int step_pin, int step_inverted) {
                                    .idle_output_en = true,
                                } };
 
-    rmt_item32_t rmtItem[2];
-    rmtItem[0].duration0 = _dir_delay_us ? _dir_delay_us * 4 : 1;
-    rmtItem[0].duration1 = _pulse_delay_us * 4;
-    rmtItem[1].duration0 = 0;
-    rmtItem[1].duration1 = 0;
-
-    rmtItem[0].level0 = rmtConfig.tx_config.idle_level;
-    rmtItem[0].level1 = !rmtConfig.tx_config.idle_level;
+    // The items are written per batch by set_step_pin()
     rmt_config(&rmtConfig);
-    rmt_fill_tx_items(rmtConfig.channel, &rmtItem[0], rmtConfig.mem_block_num, 0);
+    _idle_level[rmt_chan_num] = rmtConfig.tx_config.idle_level;
+    _n_items[rmt_chan_num]    = 0;
+    _n_channels               = next_RMT_chan_num;
     return (int)rmt_chan_num;
 }
 
@@ -76,23 +92,27 @@ static IRAM_ATTR void finish_dir() {}
 // No need for any common setup before setting step pins
 static IRAM_ATTR void start_step() {}
 
-// Restart the RMT which has already been configured
-// for the desired pulse length, polarity, and direction delay
+// Append an item to the channel's RMT memory that waits until the
+// direction delay after the start of the current step event, then
+// emits the pulse.  The start is converted to RMT ticks from the whole
+// offset in timer ticks, so the rounding does not add up along the batch.
 static IRAM_ATTR void set_step_pin(int pin, int level) {
-#ifdef CONFIG_IDF_TARGET_ESP32
-    RMT.conf_ch[pin].conf1.mem_rd_rst = 1;
-    RMT.conf_ch[pin].conf1.mem_rd_rst = 0;
-    RMT.conf_ch[pin].conf1.tx_start   = 1;
-#endif
-#ifdef CONFIG_IDF_TARGET_ESP32S3
-    RMT.chnconf0[pin].mem_rd_rst_n = 1;
-    RMT.chnconf0[pin].mem_rd_rst_n = 0;
-    RMT.chnconf0[pin].tx_start_n   = 1;
-#endif
+    uint32_t start = _event * _timer_ticks / _timer_ticks_per_rmt + _dir_delay_us * RMT_TICKS_PER_US;
+    uint32_t delay = start > _cursor[pin] ? start - _cursor[pin] : 1;
+
+    rmt_item32_t item;
+    item.duration0 = delay;
+    item.level0    = _idle_level[pin];
+    item.duration1 = _pulse_delay_us * RMT_TICKS_PER_US;
+    item.level1    = !_idle_level[pin];
+
+    RMTMEM.chan[pin].data32[_n_items[pin]++].val = item.val;
+    _cursor[pin] += delay + item.duration1;
 }
 
-// This is a noop because the RMT channels do everything
-static IRAM_ATTR void finish_step() {}
+static IRAM_ATTR void finish_step() {
+    ++_event;
+}
 
 // This is a noop because the RMT channels take care
 // of the pulse trailing edges.
@@ -115,16 +135,72 @@ static uint32_t max_pulses_per_sec() {
     return pps;
 }
 
+// The timer is set for the whole batch in finish_batch()
 static void IRAM_ATTR set_timer_ticks(uint32_t ticks) {
-    stepTimerSetTicks(ticks);
+    _timer_ticks = ticks;
+}
+
+// A batch is limited by the RMT channel memory, less one word
+// for the end marker, and by STEP_BATCH_MAX_US
+static uint32_t IRAM_ATTR start_batch() {
+    uint32_t n   = SOC_RMT_MEM_WORDS_PER_CHANNEL - 1;
+    uint32_t max = STEP_BATCH_MAX_US * RMT_TICKS_PER_US * _timer_ticks_per_rmt / _timer_ticks;
+    if (n > max) {
+        n = max;
+    }
+
+    _event = 0;
+    for (int ch = 0; ch < _n_channels; ch++) {
+        _n_items[ch] = 0;
+        _cursor[ch]  = 0;
+    }
+    return n ? n : 1;
+}
+
+// Terminate the item list of each channel that has pulses in this batch,
+// restart it, and arrange for the next interrupt after the last event
+static void IRAM_ATTR finish_batch(uint32_t n_events) {
+    for (int ch = 0; ch < _n_channels; ch++) {
+        if (_n_items[ch]) {
+            RMTMEM.chan[ch].data32[_n_items[ch]].val = 0;
+#ifdef CONFIG_IDF_TARGET_ESP32
+            RMT.conf_ch[ch].conf1.mem_rd_rst = 1;
+            RMT.conf_ch[ch].conf1.mem_rd_rst = 0;
+            RMT.conf_ch[ch].conf1.tx_start   = 1;
+#endif
+#ifdef CONFIG_IDF_TARGET_ESP32S3
+            RMT.chnconf0[ch].mem_rd_rst_n = 1;
+            RMT.chnconf0[ch].mem_rd_rst_n = 0;
+            RMT.chnconf0[ch].tx_start_n   = 1;
+#endif
+        }
+    }
+    // A segment with no step events still takes one step period
+    stepTimerSetTicks((n_events ? n_events : 1) * _timer_ticks);
 }
 
 static void IRAM_ATTR start_timer() {
     stepTimerStart();
 }
 
+// Stop the channels too, so the rest of the current batch is not emitted
 static void IRAM_ATTR stop_timer() {
     stepTimerStop();
+    for (int ch = 0; ch < _n_channels; ch++) {
+        RMTMEM.chan[ch].data32[0].val = 0;
+#ifdef CONFIG_IDF_TARGET_ESP32
+        RMT.conf_ch[ch].conf1.tx_start   = 0;
+        RMT.conf_ch[ch].conf1.mem_rd_rst = 1;
+        RMT.conf_ch[ch].conf1.mem_rd_rst = 0;
+#endif
+#ifdef CONFIG_IDF_TARGET_ESP32S3
+        RMT.chnconf0[ch].tx_stop_n     = 1;
+        RMT.chnconf0[ch].conf_update_n = 1;
+        RMT.chnconf0[ch].mem_rd_rst_n  = 1;
+        RMT.chnconf0[ch].mem_rd_rst_n  = 0;
+#endif
+        _n_items[ch] = 0;
+    }
 }
 
 // clang-format off
@@ -142,7 +218,9 @@ static step_engine_t engine = {
     max_pulses_per_sec,
     set_timer_ticks,
     start_timer,
-    stop_timer
+    stop_timer,
+    start_batch,
+    finish_batch
 };
 
 REGISTER_STEP_ENGINE(RMT, &engine);
@@ -16,6 +16,10 @@ int32_t usToCpuTicks(int32_t us);
 int32_t usToEndTicks(int32_t us);
 int32_t getCpuTicks();
 
+// Microseconds since boot.  Unlike getCpuTicks(), it is the same on both cores,
+// so it can timestamp an interrupt for comparison with a later time in a task.
+uint32_t getUsecs();
+
 #ifdef __cplusplus
 }
 #endif
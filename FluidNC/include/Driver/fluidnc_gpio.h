@@ -25,6 +25,13 @@ void gpio_set_event(int gpio_num, void* arg, int invert);
 void gpio_clear_event(int gpio_num);
 void poll_gpios();
 
+// Called from the pin change interrupt with the event argument, the new
+// state, and the time of the change in microseconds
+typedef void (*gpio_edge_callback_t)(void* arg, int active, uint32_t usecs);
+
+// Adds an edge interrupt to a GPIO that has been set up with gpio_set_event()
+void gpio_set_edge_callback(int gpio_num, gpio_edge_callback_t callback);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,10 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+#include <stddef.h>
+
+// Allocates from external PSRAM if the board has it, otherwise from internal RAM.
+// Use this for large buffers that are not accessed from interrupt handlers.
+void* psram_alloc(size_t size);
+void  psram_free(void* ptr);
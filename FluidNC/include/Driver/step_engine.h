@@ -59,13 +59,37 @@ typedef struct step_engine {
     // Start the pulse event timer
     void (*start_timer)();
 
-    // Stop the pulse event timer
+    // Stop the pulse event timer, and discard any step events that the
+    // engine has queued but not yet emitted
     void (*stop_timer)();
 
+    // Optional batched stepping, for engines that can queue a run of step
+    // events and emit them at precise intervals without further help from
+    // the CPU.  Engines that cannot do that leave these NULL, and the pulse
+    // callback is then called once per step event.
+    //
+    // start_batch() returns the number of step events the engine can accept
+    // at the period most recently given to set_timer_ticks(), limited so
+    // that a batch lasts no longer than STEP_BATCH_MAX_US.  Each event is
+    // presented as start_step(), set_step_pin() for each pulsing motor,
+    // and finish_step().  finish_batch() commits the events and arranges
+    // for the next pulse callback to occur when the last one is done.
+    uint32_t (*start_batch)();
+    void (*finish_batch)(uint32_t n_events);
+
     // Link to next engine in the list of registered stepping engines
     struct step_engine* link;
 } step_engine_t;
 
+// Upper bound on the duration of a batch of step events.  Stepper counts
+// the steps of a batch in the axis positions when it queues them, so the
+// reported position leads the motors by up to this long, and limit switches
+// act on the next batch.  Probing uses batches of one step event.  A stop
+// that discards a queued batch (reset, hard limit or fault pin) leaves the
+// position ahead by the steps that were not emitted, which those paths
+// already treat as lost.
+#define STEP_BATCH_MAX_US 100
+
 // Linked list of registered step engines
 extern step_engine_t* step_engines;
 
@@ -0,0 +1,11 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Host PWM outputs for the motion simulator.  The duty cycle is discarded.
+
+#include "Driver/PwmPin.h"
+
+PwmPin::PwmPin(int gpio, bool invert, uint32_t frequency) : _gpio(gpio), _frequency(frequency), _channel(0), _period(1 << 10) {}
+
+PwmPin::~PwmPin() {}
+
+void PwmPin::setDuty(uint32_t duty) {}
@@ -0,0 +1,45 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// The startup log of the motion simulator.  Host memory does not survive a
+// restart, so there is never a log from a previous panic.
+
+#include "src/StartupLog.h"
+#include "src/Protocol.h"  // send_line()
+
+static const size_t _maxlen = 7000;
+static char         _messages[_maxlen];
+static size_t       _len;
+
+void StartupLog::init() {
+    _len = 0;
+}
+size_t StartupLog::write(uint8_t data) {
+    if (_len >= _maxlen) {
+        return 0;
+    }
+    _messages[_len++] = (char)data;
+    return 1;
+}
+void StartupLog::dump(Channel& out) {
+    for (size_t i = 0; i < _len;) {
+        std::string line;
+        while (i < _len) {
+            char c = _messages[i++];
+            if (c == '\r') {
+                continue;
+            }
+            if (c == '\n') {
+                break;
+            }
+            line += c;
+        }
+        if (!line.empty() && line.back() == ']') {
+            line.pop_back();
+        }
+        log_stream(out, line);
+    }
+}
+
+StartupLog::~StartupLog() {}
+
+StartupLog startupLog;
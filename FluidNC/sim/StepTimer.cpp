@@ -0,0 +1,80 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Host implementation of the step timer for the motion simulator.
+// A dedicated thread stands in for the timer interrupt, calling the
+// pulse callback back-to-back while the timer is running.  Each call
+// advances simulated time by the current timer period.
+
+#include "Driver/StepTimer.h"
+#include "sim.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+volatile sim_stats_t sim_stats;
+uint32_t             sim_timer_frequency = 0;
+bool                 sim_realtime        = false;
+bool (*sim_motion_pending)(void)         = nullptr;
+
+static bool (*timer_isr_callback)(void);
+
+static std::atomic<bool>     timer_running { false };
+static std::atomic<uint32_t> timer_ticks { 0 };
+
+static void timer_isr_thread() {
+    using clock = std::chrono::steady_clock;
+
+    auto     start      = clock::now();
+    uint64_t start_tick = 0;
+    bool     was_idle   = true;
+
+    while (true) {
+        if (!timer_running) {
+            was_idle = true;
+            std::this_thread::yield();
+            continue;
+        }
+        if (was_idle) {
+            // Pace relative to the moment the timer was (re)started
+            start      = clock::now();
+            start_tick = sim_stats.sim_ticks;
+            was_idle   = false;
+        }
+
+        sim_stats.sim_ticks += timer_ticks;
+        if (sim_realtime) {
+            auto sim_ns = (sim_stats.sim_ticks - start_tick) * 1000000000ULL / sim_timer_frequency;
+            std::this_thread::sleep_until(start + std::chrono::nanoseconds(sim_ns));
+        }
+
+        sim_stats.isr_calls++;
+        if (!timer_isr_callback()) {
+            timer_running = false;
+            if (sim_motion_pending && sim_motion_pending()) {
+                sim_stats.underruns++;
+            }
+        }
+    }
+}
+
+void stepTimerStart() {
+    timer_ticks   = 10;  // Interrupt very soon to start the stepping
+    timer_running = true;
+}
+
+void stepTimerSetTicks(uint32_t ticks) {
+    timer_ticks = ticks;
+}
+
+void stepTimerStop() {
+    timer_running = false;
+}
+
+void stepTimerInit(uint32_t frequency, bool (*callback)(void)) {
+    sim_timer_frequency = frequency;
+    timer_isr_callback  = callback;
+
+    static std::thread isr_thread(timer_isr_thread);
+    isr_thread.detach();
+}
@@ -0,0 +1,43 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Host GPIOs for the motion simulator.  An output reads back the level that
+// was last written and an input reads as inactive, so limit switches, probes
+// and control pins never trip and pin events are never sent.
+
+#include "Driver/fluidnc_gpio.h"
+#include "Driver/gpio_dump.h"
+#include "src/Protocol.h"
+
+static const int n_gpios = 64;
+
+static int gpio_levels[n_gpios];
+
+void gpio_write(pinnum_t pin, int value) {
+    gpio_levels[pin] = value;
+}
+int gpio_read(pinnum_t pin) {
+    return gpio_levels[pin];
+}
+void gpio_mode(pinnum_t pin, int input, int output, int pullup, int pulldown, int opendrain) {
+    if (!output) {
+        gpio_levels[pin] = pullup;
+    }
+}
+void gpio_drive_strength(pinnum_t pin, int strength) {}
+void gpio_set_interrupt_type(pinnum_t pin, int mode) {}
+void gpio_add_interrupt(pinnum_t pin, int mode, void (*callback)(void*), void* arg) {}
+void gpio_remove_interrupt(pinnum_t pin) {}
+void gpio_route(pinnum_t pin, uint32_t signal) {}
+
+void gpio_set_event(int gpio_num, void* arg, int invert) {}
+void gpio_clear_event(int gpio_num) {}
+void gpio_set_edge_callback(int gpio_num, gpio_edge_callback_t callback) {}
+void poll_gpios() {}
+
+void gpio_dump(Print& out) {
+    for (int gpio = 0; gpio < n_gpios; gpio++) {
+        if (gpio_levels[gpio]) {
+            out << "gpio" << gpio << " high\n";
+        }
+    }
+}
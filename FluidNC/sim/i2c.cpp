@@ -0,0 +1,16 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// The motion simulator has no I2C bus, so initialization fails and no
+// device answers.
+
+#include "Driver/fluidnc_i2c.h"
+
+bool i2c_master_init(int bus_number, pinnum_t sda_pin, pinnum_t scl_pin, uint32_t frequency) {
+    return true;
+}
+int i2c_write(int bus_number, uint8_t address, const uint8_t* data, size_t count) {
+    return -1;
+}
+int i2c_read(int bus_number, uint8_t address, uint8_t* data, size_t count) {
+    return -1;
+}
@@ -0,0 +1,46 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// The local filesystem of the motion simulator is the current directory of
+// the host.  There is no SD card, so every path names a local file.
+
+#include "Driver/localfs.h"
+
+#include <cstring>
+#include <string>
+
+const char* localfsName = "";
+
+bool localfs_mount() {
+    return false;
+}
+void localfs_unmount() {}
+bool localfs_format(const char* fsname) {
+    return true;
+}
+
+std::uintmax_t localfs_size() {
+    std::error_code ec;
+
+    auto space = std::filesystem::space(".", ec);
+    if (ec) {
+        return 0;
+    }
+    return space.capacity;
+}
+
+const char* canonicalPath(const char* filename, const char* defaultFs) {
+    static std::string path;
+
+    // Drop a filesystem prefix, so /localfs/job.nc and job.nc are both ./job.nc
+    path = filename;
+    for (auto prefix : { "/localfs/", "/spiffs/", "/littlefs/", "/sd/" }) {
+        if (!strncasecmp(filename, prefix, strlen(prefix))) {
+            path = filename + strlen(prefix);
+            break;
+        }
+    }
+    if (path.empty() || path[0] != '/') {
+        path.insert(0, "./");
+    }
+    return path.c_str();
+}
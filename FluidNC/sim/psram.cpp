@@ -0,0 +1,11 @@
+#include "Driver/psram.h"
+
+#include <cstdlib>
+
+void* psram_alloc(size_t size) {
+    return malloc(size);
+}
+
+void psram_free(void* ptr) {
+    free(ptr);
+}
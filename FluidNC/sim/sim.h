@@ -0,0 +1,38 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Shared state between the host-side motion simulator pieces: the
+// software step engine, the host step timer, and the benchmark driver.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint64_t isr_calls;    // Calls to the pulse callback, i.e. step timer interrupts
+    uint64_t step_events;  // Step pin assertions across all motors
+    uint64_t dir_changes;  // Direction pin transitions across all motors
+    uint64_t segments;     // Segments loaded by the ISR (one timer period change per segment)
+    uint64_t sim_ticks;    // Simulated time in ticks of the step timer
+    uint64_t underruns;    // ISR ran dry while the planner still had blocks
+} sim_stats_t;
+
+extern volatile sim_stats_t sim_stats;
+
+// Frequency of the step timer, captured from stepTimerInit()
+extern uint32_t sim_timer_frequency;
+
+// When true, the step timer paces the ISR to simulated time so that segment
+// buffer starvation shows up as underruns.  When false, the ISR free-runs.
+extern bool sim_realtime;
+
+// Set by the driver; returns true if motion is still queued when the ISR stops
+extern bool (*sim_motion_pending)(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,125 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Software stepping engine for the host-side motion simulator.  Instead of
+// toggling GPIOs it counts step and direction events so the benchmark can
+// report how many step events the ISR would have produced.
+//
+// The engine registers itself under the names of every hardware engine so
+// that unmodified machine configuration files can be used with the simulator.
+// As on the hardware, the RMT and I2S variants take step events in batches.
+
+#include "Driver/step_engine.h"
+#include "Driver/StepTimer.h"
+#include "sim.h"
+
+#include <stddef.h>  // NULL
+
+#define SIM_MAX_PINS 64
+
+static uint32_t _pulse_delay_us;
+static uint32_t _dir_delay_us;
+static int      _next_pin = 0;
+static int      _dir_levels[SIM_MAX_PINS];
+static uint32_t _timer_ticks;
+
+static uint32_t init_engine(uint32_t dir_delay_us, uint32_t pulse_delay_us, uint32_t frequency, bool (*callback)(void)) {
+    stepTimerInit(frequency, callback);
+    _dir_delay_us   = dir_delay_us;
+    _pulse_delay_us = pulse_delay_us;
+    return _pulse_delay_us;
+}
+
+// Pins are replaced by small surrogate IDs so that direction state
+// can be tracked in a flat array.
+static int init_step_pin(int step_pin, int step_invert) {
+    if (_next_pin == SIM_MAX_PINS) {
+        return -1;
+    }
+    return _next_pin++;
+}
+
+static void set_dir_pin(int pin, int level) {
+    if (pin >= 0 && pin < SIM_MAX_PINS && _dir_levels[pin] != level) {
+        _dir_levels[pin] = level;
+        sim_stats.dir_changes++;
+    }
+}
+
+static void finish_dir() {}
+
+static void start_step() {}
+
+// Only count assertions; deassertions come through start_unstep()
+static void set_step_pin(int pin, int level) {
+    sim_stats.step_events++;
+}
+
+static void finish_step() {}
+
+// Return 1 so Stepping::unstep() skips the per-motor deassertion loop,
+// as with the RMT engine which ends pulses in hardware.
+static int start_unstep() {
+    return 1;
+}
+
+static void finish_unstep() {}
+
+static uint32_t max_pulses_per_sec() {
+    uint32_t pulse_us = _pulse_delay_us ? _pulse_delay_us : 1;
+    return 1000000 / (2 * pulse_us + _dir_delay_us);
+}
+
+// Each period change corresponds to a newly-loaded segment
+static void set_timer_ticks(uint32_t ticks) {
+    sim_stats.segments++;
+    _timer_ticks = ticks;
+    stepTimerSetTicks(ticks);
+}
+
+// Batches are limited only by STEP_BATCH_MAX_US
+static uint32_t start_batch() {
+    uint32_t n = (uint32_t)((uint64_t)STEP_BATCH_MAX_US * sim_timer_frequency / 1000000 / _timer_ticks);
+    return n ? n : 1;
+}
+
+static void finish_batch(uint32_t n_events) {
+    stepTimerSetTicks((n_events ? n_events : 1) * _timer_ticks);
+}
+
+static void start_timer() {
+    stepTimerStart();
+}
+
+static void stop_timer() {
+    stepTimerStop();
+}
+
+// clang-format off
+#define SIM_ENGINE(engine_name, batch_start, batch_finish) { \
+    engine_name,        \
+    init_engine,        \
+    init_step_pin,      \
+    set_dir_pin,        \
+    finish_dir,         \
+    start_step,         \
+    set_step_pin,       \
+    finish_step,        \
+    start_unstep,       \
+    finish_unstep,      \
+    max_pulses_per_sec, \
+    set_timer_ticks,    \
+    start_timer,        \
+    stop_timer,         \
+    batch_start,        \
+    batch_finish        \
+}
+
+// "I2S" covers both I2S_STATIC and I2S_STREAM via find_engine()'s prefix match
+static step_engine_t timed_engine = SIM_ENGINE("Timed", NULL, NULL);
+static step_engine_t rmt_engine   = SIM_ENGINE("RMT", start_batch, finish_batch);
+static step_engine_t i2s_engine   = SIM_ENGINE("I2S", start_batch, finish_batch);
+// clang-format on
+
+REGISTER_STEP_ENGINE(SimTimed, &timed_engine);
+REGISTER_STEP_ENGINE(SimRMT, &rmt_engine);
+REGISTER_STEP_ENGINE(SimI2S, &i2s_engine);
@@ -0,0 +1,302 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Host-side motion pipeline simulator and throughput benchmark.
+//
+// Usage: fluidnc_sim [--realtime] [--quiet] config.yaml job.nc [job2.nc ...]
+//
+// Each job line goes through the same execute_line() -> gc_execute_line() ->
+// mc_linear()/mc_arc() -> plan_buffer_line() path as on the controller, while
+// a host thread stands in for the step timer interrupt and calls
+// Stepper::pulse_func() through the simulated stepping engine.
+//
+// plan_buffer_line() and Stepper::prep_buffer() are timed by wrapping their
+// symbols at link time (see -Wl,--wrap in [env:sim] in platformio.ini), so the
+// firmware sources are measured unmodified.  The wrap only sees calls from
+// other files, so the block count comes from plan_blocks_added instead.
+
+#include "src/Machine/MachineConfig.h"
+#include "src/Machine/Homing.h"
+#include "src/Settings.h"
+#include "src/Protocol.h"
+#include "src/Planner.h"
+#include "src/Stepper.h"
+#include "src/Serial.h"
+#include "src/GCode.h"
+#include "src/System.h"
+
+#include "Driver/delay_usecs.h"
+#include "sim.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using sim_clock = std::chrono::steady_clock;
+
+static uint64_t elapsed_ns(sim_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(sim_clock::now() - start).count();
+}
+
+// Latency histogram with power-of-two nanosecond buckets
+class Histogram {
+    static const int n_buckets = 32;
+
+    const char* _name;
+    uint64_t    _buckets[n_buckets] = { 0 };
+    uint64_t    _count              = 0;
+    uint64_t    _total_ns           = 0;
+    uint64_t    _max_ns             = 0;
+
+public:
+    explicit Histogram(const char* name) : _name(name) {}
+
+    void add(uint64_t ns) {
+        int bucket = 0;
+        while (bucket < n_buckets - 1 && (uint64_t(1) << (bucket + 1)) <= ns) {
+            ++bucket;
+        }
+        ++_buckets[bucket];
+        ++_count;
+        _total_ns += ns;
+        if (ns > _max_ns) {
+            _max_ns = ns;
+        }
+    }
+
+    uint64_t count() const { return _count; }
+
+    // Upper bound of the bucket containing the given fraction of samples
+    uint64_t percentile(double fraction) const {
+        uint64_t target = uint64_t(fraction * _count);
+        uint64_t seen   = 0;
+        for (int i = 0; i < n_buckets; i++) {
+            seen += _buckets[i];
+            if (seen > target) {
+                return uint64_t(1) << (i + 1);
+            }
+        }
+        return _max_ns;
+    }
+
+    void report() const {
+        printf("%s: %llu calls", _name, (unsigned long long)_count);
+        if (_count == 0) {
+            printf("\n");
+            return;
+        }
+        printf(", mean %llu ns, p50 < %llu ns, p99 < %llu ns, max %llu ns\n",
+               (unsigned long long)(_total_ns / _count),
+               (unsigned long long)percentile(0.50),
+               (unsigned long long)percentile(0.99),
+               (unsigned long long)_max_ns);
+        for (int i = 0; i < n_buckets; i++) {
+            if (_buckets[i]) {
+                printf("  [%9llu, %9llu) ns %10llu\n",
+                       (unsigned long long)(uint64_t(1) << i),
+                       (unsigned long long)(uint64_t(1) << (i + 1)),
+                       (unsigned long long)_buckets[i]);
+            }
+        }
+    }
+};
+
+// Calls from motion control; the time includes any blend chords planned within the call
+static Histogram plan_hist("plan_buffer_line()");
+static Histogram prep_hist("Stepper::prep_buffer()");
+static Histogram line_hist("execute_line()");
+
+extern "C" {
+// The linker redirects calls to the wrapped symbols here; the __real_
+// names refer to the original implementations.
+bool __real__Z16plan_buffer_linePfP16plan_line_data_t(float* target, plan_line_data_t* pl_data);
+void __real__ZN7Stepper11prep_bufferEv();
+
+bool __wrap__Z16plan_buffer_linePfP16plan_line_data_t(float* target, plan_line_data_t* pl_data) {
+    auto start  = sim_clock::now();
+    bool result = __real__Z16plan_buffer_linePfP16plan_line_data_t(target, pl_data);
+    plan_hist.add(elapsed_ns(start));
+    return result;
+}
+
+void __wrap__ZN7Stepper11prep_bufferEv() {
+    auto start = sim_clock::now();
+    __real__ZN7Stepper11prep_bufferEv();
+    prep_hist.add(elapsed_ns(start));
+}
+}
+
+// Channel that sends controller output to stdout
+class SimChannel : public Channel {
+    bool _quiet;
+
+public:
+    explicit SimChannel(bool quiet) : Channel("sim"), _quiet(quiet) {}
+
+    // Input comes from the job files, not from the channel
+    int  available() override { return 0; }
+    int  read() override { return -1; }
+    int  peek() override { return -1; }
+    void flush() override { fflush(stdout); }
+
+    size_t write(uint8_t c) override {
+        if (!_quiet) {
+            putchar(c);
+        }
+        return 1;
+    }
+    size_t write(const uint8_t* buffer, size_t length) override {
+        if (!_quiet) {
+            fwrite(buffer, 1, length, stdout);
+        }
+        return length;
+    }
+    void ack(Error status) override {
+        if (status != Error::Ok) {
+            Channel::ack(status);
+        }
+    }
+};
+
+static bool read_file(const char* path, std::string& contents) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    contents = ss.str();
+    return true;
+}
+
+static void usage() {
+    fprintf(stderr, "Usage: fluidnc_sim [--realtime] [--quiet] config.yaml job.nc [job2.nc ...]\n");
+}
+
+int main(int argc, char* argv[]) {
+    bool                     quiet       = false;
+    const char*              config_file = nullptr;
+    std::vector<const char*> jobs;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--realtime")) {
+            sim_realtime = true;
+        } else if (!strcmp(argv[i], "--quiet")) {
+            quiet = true;
+        } else if (!config_file) {
+            config_file = argv[i];
+        } else {
+            jobs.push_back(argv[i]);
+        }
+    }
+    if (!config_file || jobs.empty()) {
+        usage();
+        return 1;
+    }
+
+    std::string yaml;
+    if (!read_file(config_file, yaml)) {
+        fprintf(stderr, "Cannot read %s\n", config_file);
+        return 1;
+    }
+
+    SimChannel out(quiet);
+    allChannels.registration(&out);
+
+    // This follows the order of setup() in Main.cpp, without the hardware buses
+    timing_init();
+    protocol_init();
+    settings_init();
+    Machine::MachineConfig::load_yaml(yaml);
+    if (state_is(State::ConfigAlarm)) {
+        fprintf(stderr, "Configuration error in %s\n", config_file);
+        return 1;
+    }
+    Stepping::init();
+    plan_init();
+    Axes::init();
+    config->_kinematics->init();
+
+    // As in protocol_do_soft_restart(), which sets the overrides to 100%
+    system_reset();
+    gc_init();
+    plan_reset();
+    Stepper::reset();
+    plan_sync_position();
+    gc_sync_position();
+
+    // The simulator starts at the machine origin with all axes considered homed
+    Machine::Homing::set_all_axes_homed();
+    set_state(State::Idle);
+
+    sim_motion_pending = []() { return plan_get_current_block() != nullptr; };
+
+    uint64_t lines        = 0;
+    uint64_t errors       = 0;
+    uint32_t start_blocks = plan_blocks_added;
+    auto     start        = sim_clock::now();
+
+    for (auto const& job : jobs) {
+        std::ifstream in(job);
+        if (!in) {
+            fprintf(stderr, "Cannot read %s\n", job);
+            return 1;
+        }
+        std::string text;
+        while (std::getline(in, text)) {
+            char line[LINE_BUFFER_SIZE];
+            strncpy(line, text.c_str(), sizeof(line) - 1);
+            line[sizeof(line) - 1] = '\0';
+            // Remove a CR left over from CR-LF line endings
+            auto len = strlen(line);
+            if (len && line[len - 1] == '\r') {
+                line[len - 1] = '\0';
+            }
+
+            auto  line_start = sim_clock::now();
+            Error status     = execute_line(line, out, AuthenticationLevel::LEVEL_ADMIN);
+            line_hist.add(elapsed_ns(line_start));
+            ++lines;
+            if (status != Error::Ok) {
+                ++errors;
+                out.ack(status);
+            }
+
+            // This is what protocol_main_loop() does after each line
+            protocol_auto_cycle_start();
+            protocol_execute_realtime();
+            if (sys.abort) {
+                fprintf(stderr, "Aborted at %s line %llu\n", job, (unsigned long long)lines);
+                return 1;
+            }
+        }
+    }
+    protocol_buffer_synchronize();
+
+    double wall_s = elapsed_ns(start) / 1e9;
+    double sim_s  = sim_timer_frequency ? double(sim_stats.sim_ticks) / sim_timer_frequency : 0;
+    // Blocks that entered the planner ring, rather than calls, so merged lines
+    // and blend chords are counted as the planner sees them
+    uint32_t blocks = plan_blocks_added - start_blocks;
+
+    printf("\n");
+    printf("Lines:           %llu (%llu errors)\n", (unsigned long long)lines, (unsigned long long)errors);
+    printf("Wall time:       %.3f s\n", wall_s);
+    printf("Simulated time:  %.3f s\n", sim_s);
+    printf("Blocks:          %llu, %.0f blocks/s\n", (unsigned long long)blocks, blocks / wall_s);
+    printf("Segments:        %llu, %.0f segments/s\n", (unsigned long long)sim_stats.segments, sim_stats.segments / wall_s);
+    printf("ISR events:      %llu, %.0f events/s\n", (unsigned long long)sim_stats.isr_calls, sim_stats.isr_calls / wall_s);
+    printf("Step events:     %llu, %.0f steps/s\n", (unsigned long long)sim_stats.step_events, sim_stats.step_events / wall_s);
+    printf("Dir changes:     %llu\n", (unsigned long long)sim_stats.dir_changes);
+    if (sim_realtime) {
+        printf("Underruns:       %llu\n", (unsigned long long)sim_stats.underruns);
+    }
+    printf("\n");
+    line_hist.report();
+    plan_hist.report();
+    prep_hist.report();
+    return 0;
+}
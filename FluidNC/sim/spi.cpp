@@ -0,0 +1,11 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// The motion simulator accepts an SPI bus in the config file, but there
+// are no SPI devices on it.
+
+#include "Driver/spi.h"
+
+bool spi_init_bus(pinnum_t sck_pin, pinnum_t miso_pin, pinnum_t mosi_pin, bool dma, int8_t sck_drive_strength, int8_t mosi_drive_strength) {
+    return true;
+}
+void spi_deinit_bus() {}
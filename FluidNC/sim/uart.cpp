@@ -0,0 +1,38 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Host UARTs for the motion simulator.  Nothing is ever received.  What is
+// sent to UART0, the console of the controller, goes to stdout so that log
+// messages sent directly to Uart0 are not lost; other UARTs discard it.
+
+#include <Driver/fluidnc_uart.h>
+
+#include <cstdio>
+
+void uart_init(int uart_num) {}
+void uart_mode(int uart_num, unsigned long baud, UartData dataBits, UartParity parity, UartStop stopBits) {}
+bool uart_half_duplex(int uart_num) {
+    return false;
+}
+int uart_read(int uart_num, uint8_t* buf, int len, int timeout_ms) {
+    return 0;
+}
+int uart_write(int uart_num, const uint8_t* buf, int len) {
+    if (uart_num == 0) {
+        fwrite(buf, 1, len, stdout);
+    }
+    return len;
+}
+void uart_xon(int uart_num) {}
+void uart_xoff(int uart_num) {}
+void uart_sw_flow_control(int uart_num, bool on, int xon_threshold, int xoff_threshold) {}
+bool uart_pins(int uart_num, int tx_pin, int rx_pin, int rts_pin, int cts_pin) {
+    return false;
+}
+int uart_buflen(int uart_num) {
+    return 0;
+}
+void uart_discard_input(int uart_num) {}
+bool uart_wait_output(int uart_num, int timeout_ms) {
+    return false;
+}
+void uart_register_input_pin(int uart_num, uint8_t pinnum, InputPin* object) {}
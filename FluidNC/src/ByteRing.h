@@ -0,0 +1,86 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  ByteRing.h - a fixed-size ring of bytes for one writer and one reader.
+
+  The storage is part of the object, so nothing is allocated when bytes are
+  received.  The writer only advances _head and the reader only advances
+  _tail, so a task or ISR that writes can run concurrently with one that
+  reads without a lock.  clear() is a reader operation.
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+template <size_t N>
+class ByteRing {
+    static_assert(N && (N & (N - 1)) == 0, "ByteRing size must be a power of 2");
+
+    uint8_t               _data[N];
+    std::atomic<uint32_t> _head { 0 };  // Total bytes written
+    std::atomic<uint32_t> _tail { 0 };  // Total bytes read
+
+public:
+    static constexpr size_t capacity = N;
+
+    size_t size() const {
+        // Loading _tail first keeps the difference from going negative
+        uint32_t tail = _tail.load(std::memory_order_acquire);
+        return _head.load(std::memory_order_acquire) - tail;
+    }
+    size_t free() const { return N - size(); }
+    bool   empty() const { return size() == 0; }
+
+    // Writer side.  push() returns false if the ring is full, and write()
+    // returns the number of bytes that fit.
+    bool push(uint8_t byte) {
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        if (head - _tail.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+        _data[head % N] = byte;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+    size_t write(const uint8_t* data, size_t length) {
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        length        = std::min(length, N - (head - _tail.load(std::memory_order_acquire)));
+        size_t offset = head % N;
+        size_t first  = std::min(length, N - offset);
+        memcpy(_data + offset, data, first);
+        memcpy(_data, data + first, length - first);
+        _head.store(head + length, std::memory_order_release);
+        return length;
+    }
+
+    // Reader side.  pop() and peek() return -1 if the ring is empty.
+    int peek() const {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        return tail == _head.load(std::memory_order_acquire) ? -1 : _data[tail % N];
+    }
+    int pop() {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire)) {
+            return -1;
+        }
+        int byte = _data[tail % N];
+        _tail.store(tail + 1, std::memory_order_release);
+        return byte;
+    }
+    size_t read(uint8_t* data, size_t length) {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        length        = std::min(length, size_t(_head.load(std::memory_order_acquire) - tail));
+        size_t offset = tail % N;
+        size_t first  = std::min(length, N - offset);
+        memcpy(data, _data + offset, first);
+        memcpy(data + first, _data, length - first);
+        _tail.store(tail + length, std::memory_order_release);
+        return length;
+    }
+    void clear() { _tail.store(_head.load(std::memory_order_acquire), std::memory_order_release); }
+};
@@ -8,6 +8,7 @@
 #include "Limits.h"
 #include "Logging.h"
 #include "Job.h"
+#include "LineFrame.h"
 #include <string_view>
 #include <algorithm>
 
@@ -28,11 +29,132 @@ void Channel::resume() {
 }
 
 void Channel::flushRx() {
+    _rxFlush.store(true, std::memory_order_release);
+}
+
+// Reader side of flushRx()
+void Channel::discardInput() {
     _linelen   = 0;
     _lastWasCR = false;
-    while (_queue.size()) {
-        _queue.pop();
+    _rx.clear();
+    _rxCut.store(false, std::memory_order_release);
+    if (_framing) {
+        setFraming(true);
+    }
+}
+
+void Channel::setFraming(bool on) {
+    std::lock_guard<std::mutex> lock(_frameMutex);
+    _framing      = on;
+    _rxSeq        = 0;
+    _nakSent      = false;
+    _framedHead   = 0;
+    _framedTail   = 0;
+    _doneSeq      = 0xffff;  // The frame before 0, so an early ack acknowledges nothing
+    _ackPending   = false;
+    _ackBytes     = 0;
+    _unackedBytes = 0;
+    // Acknowledge often enough that the sender is never stalled waiting for one
+    _ackThreshold = on ? frameWindow() / 4 : 0;
+}
+
+int Channel::frameWindow() {
+    // Everything the sender has sent beyond the last executed frame is either
+    // in the receive buffer, in the partial line, or in accepted frames.
+    return rx_buffer_available() + available() + int(_linelen) + int(_unackedBytes);
+}
+
+// Inside a frame, only Ctrl-X is a realtime character, so that a reset always
+// gets through and the rest of the frame reaches the CRC check intact
+bool Channel::isRealtime(uint8_t ch) {
+    bool inFrame = _rxFrame.inFrame(ch);
+    if (_framing && inFrame) {
+        return ch == uint8_t(Cmd::Reset);
+    }
+    return is_realtime_command(ch);
+}
+
+// Called with _frameMutex held
+void Channel::pushFramedLine(bool framed, uint16_t seq, size_t bytes) {
+    _framedLines[_framedHead++ % INPUT_LINE_SLOTS] = { framed, seq, bytes };
+}
+
+// Checks a line for framing, removing the frame around its payload.
+// Returns false if the line must be dropped.
+bool Channel::acceptFrame(char* line) {
+    size_t   bytes = strlen(line) + 1;  // Including the line ending
+    uint16_t seq;
+
+    std::lock_guard<std::mutex> lock(_frameMutex);
+    switch (LineFrame::decode(line, seq)) {
+        case LineFrame::Status::NotFramed:
+            // Ordinary input is still accepted, and acknowledged with "ok"
+            pushFramedLine(false, 0, 0);
+            return true;
+        case LineFrame::Status::Corrupt:
+            break;
+        case LineFrame::Status::Ok: {
+            uint16_t ahead = seq - _rxSeq;
+            if (ahead == 0) {
+                _rxSeq++;
+                _nakSent = false;
+                pushFramedLine(true, seq, bytes);
+                _unackedBytes += bytes;
+                return true;
+            }
+            if (ahead >= 0x8000) {
+                // A frame that was already accepted, resent because its ack was lost
+                // or late.  Acknowledge again if every accepted frame has been executed.
+                if (!_unackedBytes) {
+                    _ackPending = true;
+                }
+                return false;
+            }
+            // One or more frames are missing
+            break;
+        }
+    }
+    if (!_nakSent) {
+        log_stream(*this, "[NAK:" << _rxSeq << "," << frameWindow() << "]");
+        _nakSent = true;
+    }
+    return false;
+}
+
+void Channel::sendFrameAck() {
+    log_stream(*this, "[ACK:" << _doneSeq << "," << frameWindow() << "]");
+    _ackPending = false;
+    _ackBytes   = 0;
+}
+
+// Returns false if the line being acknowledged was not framed
+bool Channel::ackFrame(Error status) {
+    std::lock_guard<std::mutex> lock(_frameMutex);
+    if (_framedHead == _framedTail) {
+        return false;
+    }
+    auto line = _framedLines[_framedTail++ % INPUT_LINE_SLOTS];
+    if (!line.framed) {
+        return false;
+    }
+    _doneSeq = line.seq;
+    _unackedBytes -= std::min(line.bytes, _unackedBytes);
+    if (status != Error::Ok) {
+        // An error acknowledges the frame and everything before it
+        log_stream(*this, "[ERR:" << _doneSeq << "," << static_cast<int>(status) << "," << frameWindow() << "]");
+        _ackPending = false;
+        _ackBytes   = 0;
+        if (config->_verboseErrors) {
+            log_error_to(*this, errorString(status));
+        }
+        return true;
+    }
+    _ackPending = true;
+    _ackBytes += line.bytes;
+    if (_ackBytes >= _ackThreshold) {
+        sendFrameAck();
     }
+    return true;
 }
 
 bool Channel::lineComplete(char* line, char ch) {
@@ -198,45 +320,113 @@ void Channel::handleRealtimeCharacter(uint8_t ch) {
     execute_realtime_command(static_cast<Cmd>(cmd), *this);
 }
 
-void Channel::push(uint8_t byte) {
-    if (is_realtime_command(byte)) {
-        handleRealtimeCharacter(byte);
+// Writer side of the receive ring
+void Channel::rxWrite(const uint8_t* data, size_t length) {
+    while (length) {
+        if (_rxDiscarding) {
+            if (_rxCut.load(std::memory_order_acquire)) {
+                // The reader has not yet discarded the start of the cut line
+                return;
+            }
+            auto end = std::find_if(data, data + length, [](uint8_t ch) { return ch == '\n' || ch == '\r'; });
+            if (end == data + length) {
+                return;
+            }
+            _rxDiscarding = false;
+            length -= end + 1 - data;
+            data = end + 1;
+            continue;
+        }
+        size_t n = _rx.write(data, length);
+        if (n == length) {
+            return;
+        }
+        ++_rxOverruns;
+        _rxDiscarding = true;
+        _rxCut.store(true, std::memory_order_release);
+        data += n;
+        length -= n;
+    }
+}
+
+// Reader side: everything before the cut has been read, so the line in
+// progress is incomplete and must not run
+void Channel::discardCutLine() {
+    _linelen   = 0;
+    _lastWasCR = false;
+    _rxCut.store(false, std::memory_order_release);
+    if (_framing) {
+        // The missing frames will be NAKed when the next one arrives
+        log_error_to(*this, "Receive overrun, line discarded");
     } else {
-        _queue.push(byte);
+        ack(Error::Overflow);
+    }
+}
+
+void Channel::push(const uint8_t* data, size_t length) {
+    while (length) {
+        // Write the run of ordinary characters up to the next realtime character
+        size_t run = 0;
+        while (run < length && !isRealtime(data[run])) {
+            ++run;
+        }
+        rxWrite(data, run);
+        data += run;
+        length -= run;
+        if (length) {
+            handleRealtimeCharacter(*data++);
+            --length;
+        }
     }
 }
 
 Error Channel::pollLine(char* line) {
+    if (_rxFlush.exchange(false, std::memory_order_acq_rel)) {
+        discardInput();
+    }
     if (_paused) {
         return Error::Ok;
     }
     handle();
     while (1) {
         int ch = -1;
-        if (line && _queue.size()) {
-            ch = _queue.front();
-            _queue.pop();
+        if (line && _rxCut.load(std::memory_order_acquire) && _rx.empty()) {
+            discardCutLine();
+        }
+        if (line && !_rx.empty()) {
+            ch = _rx.pop();
         } else {
             ch = read();
             if (ch < 0) {
                 break;
             }
             _active = true;
-            if (realtimeOkay(ch) && is_realtime_command(ch)) {
+            if (isRealtime(ch) && realtimeOkay(ch)) {
                 handleRealtimeCharacter((uint8_t)ch);
                 continue;
             }
             if (!line) {
-                _queue.push(ch);
+                uint8_t byte = ch;
+                rxWrite(&byte, 1);
                 continue;
             }
             // Fall through if line is non-null and it is not a realtime character
         }
 
         if (lineComplete(line, ch)) {
+            if (_framing && !acceptFrame(line)) {
+                continue;
+            }
             return Error::Ok;
         }
     }
+    if (_framing) {
+        // The input is idle, so send any batched acknowledgement now
+        std::lock_guard<std::mutex> lock(_frameMutex);
+        if (_ackPending) {
+            sendFrameAck();
+        }
+    }
     if (_active) {
         autoReport();
     }
@@ -262,6 +452,9 @@ void Channel::registerEvent(uint8_t pinnum, InputPin* obj) {
 }
 
 void Channel::ack(Error status) {
+    if (_framing && ackFrame(status)) {
+        return;
+    }
     if (status == Error::Ok) {
         sendLine(MsgLevelNone, "ok");
         return;
@@ -285,6 +478,14 @@ void Channel::print_msg(MsgLevel level, const char* msg) {
     }
 }
 
+// Hand a message to the output task, counting the times
+// that the queue is full and the sender has to wait.
+static void queue_message(const LogMessage& msg) {
+    while (!xQueueSend(message_queue, &msg, 10)) {
+        ++log_sends_blocked;
+    }
+}
+
 // This overload is used primarily with fixed string
 // values.  It sends a pointer to the string whose
 // memory does not need to be reclaimed later.
@@ -292,8 +493,8 @@ void Channel::print_msg(MsgLevel level, const char* msg) {
 // with fixed messages.
 void Channel::sendLine(MsgLevel level, const char* line) {
     if (outputTask) {
-        LogMessage msg { this, (void*)line, level, false };
-        while (!xQueueSend(message_queue, &msg, 10)) {}
+        LogMessage msg { this, (void*)line, level, LineType::Constant };
+        queue_message(msg);
     } else {
         print_msg(level, line);
     }
@@ -309,8 +510,8 @@ void Channel::sendLine(MsgLevel level, const char* line) {
 // is allocated once and freed once.
 void Channel::sendLine(MsgLevel level, const std::string* line) {
     if (outputTask) {
-        LogMessage msg { this, (void*)line, level, true };
-        while (!xQueueSend(message_queue, &msg, 10)) {}
+        LogMessage msg { this, (void*)line, level, LineType::String };
+        queue_message(msg);
     } else {
         print_msg(level, line->c_str());
         delete line;
@@ -336,6 +537,21 @@ void Channel::sendLine(MsgLevel level, const std::string& line) {
     }
 }
 
+// This overload is used by log_*() and status reports,
+// whose lines are built in a preallocated LogBuffer.
+// The output task returns the buffer to the pool after
+// sending the message, so no heap memory is involved.
+// This is the preferred form for dynamic messages.
+void Channel::sendLine(MsgLevel level, LogBuffer* line) {
+    if (outputTask) {
+        LogMessage msg { this, (void*)line, level, LineType::Buffer };
+        queue_message(msg);
+    } else {
+        print_msg(level, line->text);
+        log_buffer_release(line);
+    }
+}
+
 bool Channel::is_visible(const std::string& stem, std::string extension, bool isdir) {
     if (stem.length() && stem[0] == '.') {
         // Exclude hidden files and directories
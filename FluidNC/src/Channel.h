@@ -13,14 +13,29 @@
 // overrunning input buffers.  The default implementation of ack() sends
 // "ok" and "error:" messages via the standard Grbl serial protocol, but it
 // could be implemented in other ways for different channel protocols.
+//
+// With $Channel/Framing=ON, lines can also be sent as LineFrame frames that
+// carry a sequence number and a CRC.  Frames are acknowledged in batches so
+// that senders can keep a window of lines in flight instead of waiting for
+// an "ok" after each one:
+//   [ACK:seq,window]       Frames up to seq have been executed
+//   [ERR:seq,code,window]  Frame seq failed with error code, earlier ones were executed
+//   [NAK:seq,window]       Frame seq was corrupt or missing; resend from seq
+// window is the number of bytes that the sender may have in flight beyond
+// seq.  Later frames are dropped until seq is resent, and frames that were
+// already received are dropped and reacknowledged.  Sequence numbers start
+// at 0 when framing is turned on and after a reset.
 
 #pragma once
 
+#include "src/Config.h"       // INPUT_LINE_SLOTS
 #include "src/Error.h"        // Error
 #include "src/GCode.h"        // gc_modal_t
 #include "src/Types.h"        // State
 #include "src/RealtimeCmd.h"  // Cmd
 #include "src/UTF8.h"
+#include "src/ByteRing.h"
+#include "src/LineFrame.h"
 
 #include "src/Pins/PinAttributes.h"
 #include "src/Machine/EventPin.h"
@@ -28,6 +43,8 @@
 #include <Stream.h>
 #include <freertos/FreeRTOS.h>  // TickType_T
 #include <queue>
+#include <mutex>
+#include <atomic>
 
 class Channel : public Stream {
 private:
@@ -47,6 +64,8 @@ public:
 
     static constexpr int maxLine = 255;
 
+    static constexpr size_t rxRingSize = 256;
+
     int _message_level = MsgLevelVerbose;
 
 protected:
@@ -56,7 +75,21 @@ protected:
     bool        _addCR         = false;
     char        _lastWasCR     = false;
 
-    std::queue<uint8_t> _queue;
+    // Received characters that have not yet been assembled into a line.
+    // push() writes and pollLine() reads, so the ring needs no lock.
+    // When input does not fit, the line it was cut from is discarded:
+    // the writer sets _rxCut and drops everything until the reader has
+    // emptied the ring and thrown away the partial line, then drops the
+    // rest of that line up to its line ending.
+    ByteRing<rxRingSize> _rx;
+    std::atomic<bool>    _rxCut { false };
+    std::atomic<bool>    _rxFlush { false };  // flushRx() was called; the reader discards the input
+    bool                 _rxDiscarding = false;  // Writer is dropping the rest of a cut line
+    uint32_t             _rxOverruns   = 0;
+
+    void rxWrite(const uint8_t* data, size_t length);
+    void discardCutLine();
+    void discardInput();
 
     uint32_t _reportInterval = 0;
     int32_t  _nextReportTime = 0;
@@ -83,6 +116,38 @@ protected:
     bool _ended   = false;
     bool _percent = false;
 
+    // Framed input state.  pollLine() runs in the polling task while ack()
+    // runs in the protocol task, so the shared fields are under _frameMutex.
+    struct FramedLine {
+        bool     framed;
+        uint16_t seq;
+        size_t   bytes;
+    };
+    bool     _framing = false;
+    uint16_t _rxSeq   = 0;      // Next expected sequence number
+    bool     _nakSent = false;  // Frames are dropped until _rxSeq is resent
+
+    // Lines read but not yet acknowledged, oldest at _framedTail.  Each one
+    // holds an input line slot until it is executed, so they cannot outnumber
+    // the slots.
+    FramedLine _framedLines[INPUT_LINE_SLOTS];
+    uint32_t   _framedHead = 0;
+    uint32_t   _framedTail = 0;
+
+    uint16_t           _doneSeq      = 0;      // Last executed frame
+    bool               _ackPending   = false;  // _doneSeq has not been acknowledged
+    size_t             _ackBytes     = 0;      // Bytes of executed frames since the last ack
+    size_t             _unackedBytes = 0;      // Bytes of accepted frames that have not been executed
+    size_t             _ackThreshold = 0;
+    std::mutex         _frameMutex;
+    LineFrame::Tracker _rxFrame;  // Follows the received bytes, whether or not framing is on
+
+    bool isRealtime(uint8_t ch);
+    void pushFramedLine(bool framed, uint16_t seq, size_t bytes);
+    bool acceptFrame(char* line);
+    void sendFrameAck();
+    bool ackFrame(Error status);
+
 protected:
     bool _active = true;
     bool _paused = false;
@@ -103,21 +168,54 @@ public:
     virtual void sendLine(MsgLevel level, const char* line);
     virtual void sendLine(MsgLevel level, const std::string* line);
     virtual void sendLine(MsgLevel level, const std::string& line);
+    virtual void sendLine(MsgLevel level, LogBuffer* line);
 
     size_t _line_number = 0;
 
     std::string _progress;
 
+    // Compact status reports, selected per channel with $Report/Format.
+    // Positions are sent as integer motor steps and, between periodic
+    // key frames, only the fields that changed since the last report.
+    struct StatusSnapshot {
+        const char* state;
+        int32_t     steps[MAX_N_AXIS];
+        int32_t     wco[MAX_N_AXIS];
+        int32_t     bf[2];  // Planner blocks and rx bytes available
+        int32_t     ln;
+        int32_t     fs[2];  // Feed rate and spindle speed
+        int32_t     ov[3];
+        int32_t     ms[4];  // Segment buffer stats
+        std::string accessories;
+        std::string pins;
+    };
+    bool           _compactStatus = false;
+    uint32_t       _statusFrames  = 0;  // Compact reports since the last key frame
+    StatusSnapshot _lastStatus;
+
+    void setCompactStatus(bool on) {
+        _compactStatus = on;
+        _statusFrames  = 0;  // Start with a key frame
+    }
+    bool compactStatus() { return _compactStatus; }
+
+    void setFraming(bool on);
+    bool framing() { return _framing; }
+    int  frameWindow();  // Bytes a sender may have in flight beyond the last acknowledged frame
+
     // rx_buffer_available() is the number of bytes that can be sent without overflowing
     // a reception buffer, even if the system is busy.  Channels that can handle external
     // input via an interrupt or other background mechanism should override it to return
     // the remaining space that mechanism has available.
-    // The queue can handle more than 256 characters but we don't want it to get too
-    // large, so we report a limited size.
-    virtual int rx_buffer_available() { return std::max(0, 256 - int(_queue.size())); }
+    virtual int rx_buffer_available() { return _rx.free(); }
+
+    // Times that input was discarded because the receive ring was full
+    uint32_t rxOverruns() { return _rxOverruns; }
 
     // flushRx() discards any characters that have already been received.  It is used
-    // after a reset, so that anything already sent will not be processed.
+    // after a reset, so that anything already sent will not be processed.  It is called
+    // from the protocol task, so it only asks the polling task, which reads the receive
+    // ring, to discard the input the next time it polls.
     virtual void flushRx();
 
     // realtimeOkay() returns true if the channel can currently interpret the character as
@@ -158,7 +256,7 @@ public:
 
     int peek() override { return -1; }
     int read() override { return -1; }
-    int available() override { return _queue.size(); }
+    int available() override { return _rx.size(); }
 
     virtual void print_msg(MsgLevel level, const char* msg);
 
@@ -169,17 +267,11 @@ public:
     virtual void autoReport();
     void         autoReportGCodeState();
 
-    void push(uint8_t byte);
-    void push(const uint8_t* data, size_t length) {
-        while (length--) {
-            push(*data++);
-        }
-    }
-    void push(std::string_view data) {
-        for (auto const& c : data) {
-            push((uint8_t)c);
-        }
-    }
+    // push() acts on realtime characters immediately and puts the others in the
+    // receive ring.  If they do not fit, the line is discarded with an error.
+    void push(uint8_t byte) { push(&byte, 1); }
+    void push(const uint8_t* data, size_t length);
+    void push(std::string_view data) { push(reinterpret_cast<const uint8_t*>(data.data()), data.length()); }
     void push(const std::string& s) { push(reinterpret_cast<const uint8_t*>(s.c_str()), s.length()); }
 
     void end() { _ended = true; }
@@ -0,0 +1,608 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "CompiledFile.h"
+
+#include "Machine/MachineConfig.h"  // config
+#include "GCode.h"                  // gc_state
+#include "MotionControl.h"          // mc_linear, mc_arc
+#include "Parameters.h"             // read_number
+#include "Spindles/Spindle.h"       // spindle
+#include "FluidPath.h"
+#include "MotionRecord.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <set>
+#include <sstream>
+
+const char* CompiledFile::extension = ".gcb";
+
+// The file is a Header followed by records.  Each record is a type byte, a length byte
+// and that many bytes of payload; see MotionRecord.h.  Values are in the byte order of
+// the controller.
+namespace {
+    const uint32_t file_magic   = 0x42434746;  // "FGCB"
+    const uint8_t  file_version = 1;
+
+    struct Header {
+        uint32_t magic;
+        uint8_t  version;
+        uint8_t  n_axis;
+        uint16_t reserved;
+    };
+
+    using RecordType = MotionRecord::Type;
+    static_assert(MAX_N_AXIS <= MotionRecord::max_axes, "Motion records hold up to 6 axes");
+
+    const int32_t max_line_number = 10000000;  // As in the parser
+
+    const Plane planes[] = { Plane::XY, Plane::ZX, Plane::YZ };
+
+    // The compiled jobs that are open, so that execute_line() can tell their lines of
+    // motion records from lines that another channel sends with the record mark
+    std::set<const Channel*> playing;
+
+    constexpr uint32_t word(char letter) {
+        return 1 << (letter - 'A');
+    }
+    // The words that a motion record can hold, besides G
+    const uint32_t motion_words = word('X') | word('Y') | word('Z') | word('A') | word('B') | word('C') | word('I') | word('J') |
+                                  word('K') | word('F') | word('N') | word('P');
+
+    void plane_axes(Plane plane, size_t& axis_0, size_t& axis_1, size_t& axis_linear) {
+        switch (plane) {
+            case Plane::XY:
+                axis_0      = X_AXIS;
+                axis_1      = Y_AXIS;
+                axis_linear = Z_AXIS;
+                break;
+            case Plane::ZX:
+                axis_0      = Z_AXIS;
+                axis_1      = X_AXIS;
+                axis_linear = Y_AXIS;
+                break;
+            default:  // case Plane::YZ:
+                axis_0      = Y_AXIS;
+                axis_1      = Z_AXIS;
+                axis_linear = X_AXIS;
+        }
+    }
+
+    // Follows the modal state that the parser will be in when each line runs, and
+    // decides which lines can become motion records.
+    class Compiler {
+        FileStream& _out;
+
+        Motion   _motion;
+        bool     _motion_known = false;  // No motion command yet, so a line of axis words stays text
+        Plane    _plane;
+        Distance _distance;
+        Units    _units;
+        FeedRate _feed_mode;
+        bool     _started = false;  // A line other than a leading % has been seen
+
+        void write(RecordType type, const void* payload, size_t length) {
+            uint8_t head[2] = { uint8_t(type), uint8_t(length) };
+            _out.write(head, 2);
+            _out.write(static_cast<const uint8_t*>(payload), length);
+        }
+
+        void text(const char* line) {
+            write(RecordType::Text, line, strlen(line));
+            ++n_text;
+        }
+
+    public:
+        size_t      n_text   = 0;
+        size_t      n_motion = 0;
+        bool        done     = false;  // A % after the start of the program ends it
+        std::string start_modes;
+
+        // The job starts in the modal state that the parser is in now, made explicit
+        // so that the records mean the same thing whenever the job is run.
+        explicit Compiler(FileStream& out) :
+            _out(out), _motion(gc_state.modal.motion), _plane(gc_state.modal.plane_select), _distance(gc_state.modal.distance),
+            _units(gc_state.modal.units), _feed_mode(gc_state.modal.feed_rate) {
+            Header header = { file_magic, file_version, uint8_t(Axes::_numberAxis), 0 };
+            _out.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+
+            std::ostringstream modes;
+            modes << "G" << int(_units) / 10 << " G" << int(_distance) / 10 << " G" << int(_plane) / 10 << " G" << int(_feed_mode) / 10;
+            start_modes = modes.str();
+            text(start_modes.c_str());
+        }
+
+        Error line(const char* line);
+    };
+
+    Error Compiler::line(const char* line) {
+        size_t pos = 0;
+        while (isspace(line[pos])) {
+            ++pos;
+        }
+        if (line[pos] == '\0' || line[pos] == ';') {
+            return Error::Ok;  // Blank
+        }
+        if (line[pos] == '%') {
+            // A leading % marks the start of the program and a later one its end
+            done     = _started;
+            _started = true;
+            return Error::Ok;
+        }
+        _started = true;
+        if (line[pos] == '$') {
+            text(line);
+            return Error::Ok;
+        }
+
+        // The modal state after this line, and its words
+        Motion   motion       = _motion;
+        bool     motion_known = _motion_known;
+        Plane    plane        = _plane;
+        Distance distance     = _distance;
+        Units    units        = _units;
+        FeedRate feed_mode    = _feed_mode;
+        bool     program_end  = false;
+
+        float    values[MAX_N_AXIS] = {};
+        float    ijk[3]     = {};
+        uint8_t  axis_words = 0;
+        uint8_t  ijk_words  = 0;
+        uint32_t letters    = 0;     // Words other than G and M, to catch repeats
+        bool     simple     = true;  // Nothing in the line needs the parser
+        bool     g_motion   = false;
+        float    feed       = 0;
+        float    p          = 0;
+        int32_t  number     = 0;
+        auto     n_axis     = Axes::_numberAxis;
+        float    value;
+
+        char c;
+        while ((c = line[pos]) != '\0') {
+            if (isspace(c)) {
+                ++pos;
+                continue;
+            }
+            if (c == ';') {
+                break;
+            }
+            if (c == '(') {
+                // The comment might be a message, which the parser handles
+                simple = false;
+                while (line[pos] && line[pos] != ')') {
+                    ++pos;
+                }
+                if (line[pos]) {
+                    ++pos;
+                }
+                continue;
+            }
+            c = toupper(c);
+            if (c == 'O' || c == '#') {
+                return Error::FlowControlSyntaxError;  // Needs the source file and runtime values
+            }
+            if (c < 'A' || c > 'Z') {
+                simple = false;  // The parser will report it
+                break;
+            }
+            ++pos;
+            if (line[pos] == '#' || line[pos] == '[') {
+                return Error::FlowControlSyntaxError;
+            }
+            if (!read_number(line, pos, value)) {
+                simple = false;
+                break;
+            }
+
+            if (c != 'G' && c != 'M') {
+                if (letters & word(c)) {
+                    simple = false;  // Repeated word
+                }
+                letters |= word(c);
+            }
+            switch (c) {
+                case 'G': {
+                    int code = lroundf(10 * value);
+                    switch (code) {
+                        case int(Motion::Seek):
+                        case int(Motion::Linear):
+                        case int(Motion::CwArc):
+                        case int(Motion::CcwArc):
+                        case int(Motion::ProbeToward):
+                        case int(Motion::ProbeTowardNoError):
+                        case int(Motion::ProbeAway):
+                        case int(Motion::ProbeAwayNoError):
+                        case int(Motion::None):
+                            simple       = simple && !g_motion && code <= int(Motion::CcwArc);
+                            g_motion     = true;
+                            motion       = Motion(code);
+                            motion_known = true;
+                            break;
+                        case int(Plane::XY):
+                        case int(Plane::ZX):
+                        case int(Plane::YZ):
+                            plane  = Plane(code);
+                            simple = false;
+                            break;
+                        case int(Distance::Absolute):
+                        case int(Distance::Incremental):
+                            distance = Distance(code);
+                            simple   = false;
+                            break;
+                        case int(Units::Mm):
+                        case int(Units::Inches):
+                            units  = Units(code);
+                            simple = false;
+                            break;
+                        case int(FeedRate::UnitsPerMin):
+                        case int(FeedRate::InverseTime):
+                            feed_mode = FeedRate(code);
+                            simple    = false;
+                            break;
+                        default:
+                            simple = false;
+                            break;
+                    }
+                    break;
+                }
+                case 'M':
+                    program_end = program_end || value == 2 || value == 30;
+                    simple      = false;
+                    break;
+                case 'X':
+                case 'Y':
+                case 'Z':
+                case 'A':
+                case 'B':
+                case 'C': {
+                    size_t axis = c >= 'X' ? c - 'X' : A_AXIS + c - 'A';
+                    if (axis < n_axis) {
+                        values[axis] = value;
+                        set_bitnum(axis_words, axis);
+                    } else {
+                        simple = false;
+                    }
+                    break;
+                }
+                case 'I':
+                case 'J':
+                case 'K':
+                    ijk[c - 'I'] = value;
+                    set_bitnum(ijk_words, c - 'I');
+                    break;
+                case 'F':
+                case 'N':
+                case 'P':
+                    if (value < 0) {
+                        simple = false;  // The parser will report it
+                    }
+                    if (c == 'F') {
+                        feed = value;
+                    } else if (c == 'N') {
+                        number = int32_t(truncf(value));
+                        simple = simple && number <= max_line_number;
+                    } else {
+                        p = value;
+                    }
+                    break;
+                default:
+                    simple = false;
+                    break;
+            }
+        }
+
+        bool arc = motion == Motion::CwArc || motion == Motion::CcwArc;
+        simple   = simple && motion_known && axis_words && int(motion) <= int(Motion::CcwArc) && distance == Distance::Absolute &&
+                 feed_mode == FeedRate::UnitsPerMin && !(letters & ~motion_words);
+
+        size_t axis_0, axis_1, axis_linear;
+        plane_axes(plane, axis_0, axis_1, axis_linear);
+        if (arc) {
+            // The same checks as the parser makes for an arc in center format
+            uint8_t in_plane = bitnum_to_mask(axis_0) | bitnum_to_mask(axis_1);
+            simple           = simple && (axis_words & in_plane) && ijk_words && !(ijk_words & ~in_plane);
+            simple           = simple && p >= 0 && p <= 255 && p == truncf(p);
+        } else {
+            simple = simple && !ijk_words && !(letters & word('P'));
+        }
+
+        if (simple) {
+            if (units == Units::Inches) {
+                for (size_t axis = 0; axis < n_axis; axis++) {
+                    if ((axis < A_AXIS || axis > C_AXIS) && bitnum_is_true(axis_words, axis)) {
+                        values[axis] *= MM_PER_INCH;
+                    }
+                }
+                for (auto& offset : ijk) {
+                    offset *= MM_PER_INCH;
+                }
+                feed *= MM_PER_INCH;
+            }
+
+            MotionRecord::Record record;
+            record.motion   = uint8_t(int(motion) / 10);
+            record.axes     = axis_words;
+            record.plane    = plane == Plane::XY ? 0 : plane == Plane::ZX ? 1 : 2;
+            record.turns    = uint8_t(p);
+            record.has_line = letters & word('N');
+            record.line     = number;
+            record.has_feed = letters & word('F');
+            record.feed     = feed;
+            copyAxes(record.values, values);
+            if (arc) {
+                record.offsets[0] = bitnum_is_true(ijk_words, axis_0) ? ijk[axis_0] : 0.0f;
+                record.offsets[1] = bitnum_is_true(ijk_words, axis_1) ? ijk[axis_1] : 0.0f;
+            }
+            uint8_t payload[MotionRecord::max_bytes];
+            write(RecordType::Motion, payload, MotionRecord::encode(record, n_axis, payload));
+            ++n_motion;
+        } else {
+            text(line);
+        }
+
+        _motion       = motion;
+        _motion_known = motion_known;
+        _plane        = plane;
+        _distance     = distance;
+        _units        = units;
+        _feed_mode    = feed_mode;
+        if (program_end) {
+            // The modal groups that the parser resets at M2 and M30
+            _motion    = Motion::Linear;
+            _plane     = Plane::XY;
+            _distance  = Distance::Absolute;
+            _feed_mode = FeedRate::UnitsPerMin;
+        }
+        return Error::Ok;
+    }
+
+    // Executes one motion record the way gc_execute_line() executes a line with the same words
+    Error execute_motion(const MotionRecord::Record& record) {
+        Motion motion = Motion(record.motion * 10);
+        Plane  plane  = planes[record.plane];
+
+        int32_t number = record.has_line ? record.line : 0;
+        float   feed   = record.has_feed ? record.feed : gc_state.feed_rate;
+        if (motion != Motion::Seek && feed == 0.0f) {
+            return Error::GcodeUndefinedFeedRate;
+        }
+
+        // Work coordinates to machine coordinates with the offsets in effect now
+        float target[MAX_N_AXIS];
+        auto  n_axis = Axes::_numberAxis;
+        for (size_t axis = 0; axis < n_axis; axis++) {
+            if (bitnum_is_true(record.axes, axis)) {
+                target[axis] = record.values[axis] + gc_state.coord_system[axis] + gc_state.coord_offset[axis];
+                if (axis == TOOL_LENGTH_OFFSET_AXIS) {
+                    target[axis] += gc_state.tool_length_offset;
+                }
+            } else {
+                target[axis] = gc_state.position[axis];
+            }
+        }
+
+        size_t axis_0, axis_1, axis_linear;
+        plane_axes(plane, axis_0, axis_1, axis_linear);
+        if (record.is_arc()) {
+            // The start is known only now, so the parser's arc check is made here
+            float start[2] = { gc_state.position[axis_0], gc_state.position[axis_1] };
+            float end[2]   = { target[axis_0], target[axis_1] };
+            if (!MotionRecord::arc_end_on_circle(start, end, record.offsets)) {
+                return Error::GcodeInvalidTarget;
+            }
+        }
+
+        plan_line_data_t  plan_data;
+        plan_line_data_t* pl_data = &plan_data;
+        memset(pl_data, 0, sizeof(plan_line_data_t));
+
+        gc_state.line_number = number;
+        pl_data->line_number = number;
+        gc_state.feed_rate   = feed;
+        pl_data->feed_rate   = feed;
+        // A laser is off during rapids
+        if (!(motion == Motion::Seek && spindle->isRateAdjusted())) {
+            pl_data->spindle_speed = gc_state.spindle_speed;
+        }
+        pl_data->spindle = gc_state.modal.spindle;
+        pl_data->coolant = gc_state.modal.coolant;
+        switch (gc_state.modal.control) {
+            case ControlMode::ExactPath:
+                pl_data->path_tolerance = config->_mergeTolerance;
+                break;
+            case ControlMode::ExactStop:
+                pl_data->motion.exactStop = 1;
+                break;
+            case ControlMode::Continuous:
+                pl_data->path_tolerance     = 0.5f * gc_state.path_tolerance;
+                pl_data->motion.blendCorner = 1;
+                break;
+        }
+
+        gc_state.modal.motion = motion;
+        switch (motion) {
+            case Motion::Seek:
+                pl_data->motion.rapidMotion = 1;
+                mc_linear(target, pl_data, gc_state.position);
+                break;
+            case Motion::Linear:
+                mc_linear(target, pl_data, gc_state.position);
+                break;
+            default: {
+                float offset[3] = {};
+                offset[axis_0]  = record.offsets[0];
+                offset[axis_1]  = record.offsets[1];
+                float radius    = hypot_f(offset[axis_0], offset[axis_1]);
+                mc_arc(target, pl_data, gc_state.position, offset, radius, axis_0, axis_1, axis_linear, motion == Motion::CwArc, record.turns);
+                break;
+            }
+        }
+        if (sys.abort) {
+            return Error::Reset;
+        }
+        copyAxes(gc_state.position, target);
+        return Error::Ok;
+    }
+}
+
+bool CompiledFile::is_compiled(const char* path) {
+    size_t len = strlen(path);
+    size_t ext = strlen(extension);
+    return len > ext && strcasecmp(path + len - ext, extension) == 0;
+}
+
+Error CompiledFile::compile(const char* fs, const char* path, Channel& out) {
+    if (is_compiled(path)) {
+        return Error::InvalidValue;
+    }
+    std::string binpath = std::string(path) + extension;
+    Error       err;
+    try {
+        InputFile  source(fs, path);
+        FileStream binary(binpath, "w", fs);
+        Compiler   compiler(binary);
+        char       line[Channel::maxLine];
+        while (!compiler.done && (err = source.readLine(line, Channel::maxLine - 1)) == Error::Ok) {
+            if ((err = compiler.line(line)) != Error::Ok) {
+                log_error_to(out, path << " line " << source.lineNumber() << " cannot be compiled: " << errorString(err));
+                break;
+            }
+        }
+        if (compiler.done || err == Error::Eof) {
+            log_info_to(out,
+                        binpath << ": " << compiler.n_motion << " motion and " << compiler.n_text << " text records, assuming "
+                                << compiler.start_modes);
+            return Error::Ok;
+        }
+    } catch (Error e) { return e; }
+
+    std::error_code ec;
+    stdfs::remove(FluidPath { binpath, fs, ec }, ec);
+    return err;
+}
+
+CompiledFile::CompiledFile(const char* fs, const char* path) : InputFile(fs, path) {
+    Header header;
+    if (readData(reinterpret_cast<char*>(&header), sizeof(header)) != sizeof(header) || header.magic != file_magic ||
+        header.version != file_version) {
+        log_error(path << " is not a compiled GCode file");
+        throw Error::FsFailedRead;
+    }
+    if (header.n_axis != Axes::_numberAxis) {
+        log_error(path << " was compiled for " << int(header.n_axis) << " axes");
+        throw Error::InvalidValue;
+    }
+    playing.insert(this);
+}
+
+CompiledFile::~CompiledFile() {
+    playing.erase(this);
+}
+
+bool CompiledFile::is_playing(const Channel* channel) {
+    return channel && playing.count(channel);
+}
+
+Error CompiledFile::readRecord(uint8_t& type, char* payload, uint8_t& length) {
+    uint8_t head[2];
+    size_t  n = readData(reinterpret_cast<char*>(head), 2);
+    if (n == 0) {
+        return Error::Eof;
+    }
+    type   = head[0];
+    length = head[1];
+    if (n != 2 || readData(payload, length) != length) {
+        return Error::FsFailedRead;  // Truncated
+    }
+    return Error::Ok;
+}
+
+// Returns a text record as a line, or collects consecutive motion records into one
+Error CompiledFile::pollLine(char* line) {
+    if (!line) {
+        return Error::NoData;
+    }
+    if (_pending_error != Error::Ok) {
+        return _pending_error;
+    }
+    if (_ended) {
+        end_message();
+        return Error::Eof;
+    }
+    if (_have_text) {
+        _have_text = false;
+        strcpy(line, _text);
+        ++_line_number;
+        update_progress();
+        return Error::Ok;
+    }
+
+    size_t used = 2;
+    while (used + 2 + MotionRecord::max_bytes <= Channel::maxLine) {
+        uint8_t type, length;
+        char    payload[256];
+        Error   err = readRecord(type, payload, length);
+        if (err == Error::Eof) {
+            break;
+        }
+        if (err != Error::Ok) {
+            return err;
+        }
+        if (type == uint8_t(RecordType::Text)) {
+            if (length > Channel::maxLine - 1) {
+                return Error::FsFailedRead;  // Longer than any line that compile() writes
+            }
+            char* dest = used == 2 ? line : _text;
+            memcpy(dest, payload, length);
+            dest[length] = '\0';
+            if (used == 2) {
+                ++_line_number;
+                update_progress();
+                return Error::Ok;
+            }
+            _have_text = true;
+            break;
+        }
+        if (type != uint8_t(RecordType::Motion) || length > MotionRecord::max_bytes) {
+            return Error::FsFailedRead;
+        }
+        line[used++] = type;
+        line[used++] = length;
+        memcpy(line + used, payload, length);
+        used += length;
+        ++_line_number;
+    }
+    if (used == 2) {
+        end_message();
+        return Error::Eof;
+    }
+    line[0] = record_mark;
+    line[1] = used - 2;
+    update_progress();
+    return Error::Ok;
+}
+
+Error CompiledFile::execute(const char* line) {
+    size_t length = uint8_t(line[1]);
+    if (length > Channel::maxLine - 2) {
+        return Error::InvalidStatement;
+    }
+    auto                 p   = reinterpret_cast<const uint8_t*>(line) + 2;
+    auto                 end = p + length;
+    MotionRecord::Record record;
+    while (true) {
+        switch (MotionRecord::next(p, end, Axes::_numberAxis, record)) {
+            case MotionRecord::Status::End:
+                return Error::Ok;
+            case MotionRecord::Status::Corrupt:
+                return Error::InvalidStatement;
+            case MotionRecord::Status::Ok:
+                break;
+        }
+        Error err = execute_motion(record);
+        if (err != Error::Ok) {
+            return err;
+        }
+    }
+}
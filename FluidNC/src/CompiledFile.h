@@ -0,0 +1,65 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  CompiledFile.h - pre-parsed ("compiled") GCode jobs.
+
+  $SD/Compile or $LocalFS/Compile parses a GCode file once and writes a .gcb
+  file beside it.  $File/Compile takes a path that starts with /sd/ or
+  /localfs/, and is on the local filesystem otherwise.  Each line that is
+  only a G0, G1, G2 or G3 motion, in absolute distance mode and units per
+  minute feed mode, becomes a binary motion record whose axis, arc offset
+  and feed values are already converted to mm.  The arc end point check
+  needs the start of the arc, so it is made when the record runs, with the
+  same tolerances as the parser.  Every other line is stored as text and
+  goes through the GCode parser when the job runs, so modal changes,
+  offsets, spindle and coolant commands and messages behave exactly as they
+  do in the source file.  Work offsets are applied when a record executes,
+  so a compiled job can be rerun after the work is rezeroed.
+
+  Running a .gcb file with $SD/Run or $LocalFS/Run plays it back.  Runs of
+  consecutive motion records are handed to the protocol loop as a single
+  line, which execute_line() passes to CompiledFile::execute() instead of
+  to the parser, but only while the job that is running is a compiled file.
+  lineNumber() counts records rather than source lines.
+
+  Parameters, expressions and O-word flow control cannot be compiled,
+  because their values are only known when the job runs.
+*/
+
+#include "InputFile.h"
+#include "Error.h"
+
+#include <cstdint>
+
+class CompiledFile : public InputFile {
+    // A text record that was read while collecting motion records
+    char _text[Channel::maxLine];
+    bool _have_text = false;
+
+    Error readRecord(uint8_t& type, char* payload, uint8_t& length);
+
+public:
+    static const char  record_mark = '\x01';  // First character of a line of motion records
+    static const char* extension;             // Appended to the source file name
+
+    static bool is_compiled(const char* path);
+
+    // Writes path + extension on the same filesystem
+    static Error compile(const char* fs, const char* path, Channel& out);
+
+    // Executes a line of motion records that starts with record_mark
+    static Error execute(const char* line);
+
+    // True if channel is an open compiled file
+    static bool is_playing(const Channel* channel);
+
+    CompiledFile(const char* fs, const char* path);
+    ~CompiledFile();
+
+    CompiledFile(const CompiledFile&)            = delete;
+    CompiledFile& operator=(const CompiledFile&) = delete;
+
+    Error pollLine(char* line) override;
+};
@@ -45,6 +45,10 @@ const int B2_AXIS = (B_AXIS + MAX_N_AXIS);
 const int C2_AXIS = (C_AXIS + MAX_N_AXIS);
 
 const int SUPPORT_TASK_CORE = 0;  // Reference: CONFIG_ARDUINO_RUNNING_CORE = 1
+const int MOTION_TASK_CORE  = 1;  // Segment preparation, on the core that runs the main loop
+
+// Input lines that can be read ahead of the GCode parser.  Must be a power of 2.
+const int INPUT_LINE_SLOTS = 4;
 
 // Serial baud rate
 // OK to change, but the ESP32 boot text is 115200, so you will not see that is your
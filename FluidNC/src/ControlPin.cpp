@@ -1,3 +1,19 @@
 #include "ControlPin.h"
 
-namespace Machine {};
+#include "Protocol.h"  // faultPinEvent
+#include "Stepper.h"   // Stepper::stop_from_ISR()
+
+namespace Machine {
+    ControlPin::ControlPin(const Event* event, const char* legend, char letter) : EventPin(event, legend), _letter(letter) {
+        _edgeCapture = true;
+    }
+
+    // The fault and e-stop pins cut off stepping right away.  They raise an alarm that
+    // requires a reset anyway, so there is no position to preserve.  Other pins such as
+    // feed hold just get their event sent immediately, since they must decelerate.
+    void IRAM_ATTR ControlPin::edge(bool active) {
+        if (active && _event == &faultPinEvent) {
+            Stepper::stop_from_ISR();
+        }
+    }
+};
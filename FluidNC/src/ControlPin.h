@@ -6,10 +6,12 @@ namespace Machine {
     private:
         char _letter;  // The name that appears in init() messages and the name of the configuration item
     public:
-        ControlPin(const Event* event, const char* legend, char letter) : EventPin(event, legend), _letter(letter) {}
+        ControlPin(const Event* event, const char* legend, char letter);
 
         char letter() { return _letter; };
 
+        void edge(bool active) override;
+
         ~ControlPin();
     };
 }
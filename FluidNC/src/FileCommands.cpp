@@ -6,6 +6,7 @@
 #include "src/WebUI/Authentication.h"
 #include "src/Configuration/JsonGenerator.h"
 #include "src/InputFile.h"    // InputFile
+#include "src/CompiledFile.h"  // CompiledFile
 #include "src/Job.h"          // Job::
 #include "src/xmodem.h"       // xmodemReceive(), xmodemTransmit()
 #include "src/Protocol.h"     // pollingPaused
@@ -49,7 +50,11 @@ static Error openFile(const char* fs, const char* parameter, Channel& out, Input
     }
 
     try {
-        theFile = new InputFile(fs, path.c_str());
+        if (CompiledFile::is_compiled(path.c_str())) {
+            theFile = new CompiledFile(fs, path.c_str());
+        } else {
+            theFile = new InputFile(fs, path.c_str());
+        }
     } catch (Error err) { return err; }
     return Error::Ok;
 }
@@ -261,6 +266,35 @@ static Error runFile(const char* fs, const char* parameter, AuthenticationLevel
     return Error::Ok;
 }
 
+// Writes a pre-parsed copy of a GCode file, which $SD/Run or $LocalFS/Run can run
+static Error compileFile(const char* fs, const char* parameter, AuthenticationLevel auth_level, Channel& out) {
+    if (notIdleOrAlarm()) {
+        return Error::IdleError;
+    }
+    if (!parameter || !*parameter) {
+        log_error_to(out, "Missing file name");
+        return Error::InvalidValue;
+    }
+    std::string path(parameter);
+    if (path[0] != '/') {
+        path = "/" + path;
+    }
+    return CompiledFile::compile(fs, path.c_str(), out);
+}
+
+// Like the other File/ commands, the local filesystem unless the path starts with /sd/
+static Error compileAnyFile(const char* parameter, AuthenticationLevel auth_level, Channel& out) {
+    return compileFile(localfsName, parameter, auth_level, out);
+}
+
+static Error compileSDFile(const char* parameter, AuthenticationLevel auth_level, Channel& out) {
+    return compileFile(sdName, parameter, auth_level, out);
+}
+
+static Error compileLocalFile(const char* parameter, AuthenticationLevel auth_level, Channel& out) {
+    return compileFile(localfsName, parameter, auth_level, out);
+}
+
 static Error runSDFile(const char* parameter, AuthenticationLevel auth_level, Channel& out) {  // ESP220
     return runFile("sd", parameter, auth_level, out);
 }
@@ -449,11 +483,10 @@ static Error renameObject(const char* fs, const char* parameter, AuthenticationL
         return Error::InvalidValue;
     }
     auto opath = strchr(parameter, '>');
-    if (*opath == '\0') {
+    if (!opath) {
         return Error::InvalidValue;
     }
-    const char* ipath = parameter;
-    *opath++          = '\0';
+    std::string ipath(parameter, opath++ - parameter);
     try {
         FluidPath inPath { ipath, fs };
         FluidPath outPath { opath, fs };
@@ -652,6 +685,7 @@ void make_file_commands() {
     new WebCommand("FORMAT", WEBCMD, WA, "ESP710", "LocalFS/Format", formatLocalFS);
     new WebCommand("path", WEBCMD, WU, NULL, "LocalFS/Show", showLocalFile);
     new WebCommand("path", WEBCMD, WU, "ESP700", "LocalFS/Run", runLocalFile, nullptr);
+    new WebCommand("path", WEBCMD, WU, NULL, "LocalFS/Compile", compileLocalFile);
     new WebCommand("path", WEBCMD, WU, NULL, "LocalFS/List", listLocalFiles);
     new WebCommand("path", WEBCMD, WU, NULL, "LocalFS/ListJSON", listLocalFilesJSON);
     new WebCommand("path", WEBCMD, WU, NULL, "LocalFS/Delete", deleteLocalFile);
@@ -664,8 +698,10 @@ void make_file_commands() {
     new WebCommand("path", WEBCMD, WU, NULL, "File/SendJSON", fileSendJson);
     new WebCommand("path", WEBCMD, WU, NULL, "File/ShowSome", fileShowSome);
     new WebCommand("path", WEBCMD, WU, NULL, "File/ShowHash", fileShowHash);
+    new WebCommand("path", WEBCMD, WU, NULL, "File/Compile", compileAnyFile);
     new WebCommand("path", WEBCMD, WU, "ESP221", "SD/Show", showSDFile);
     new WebCommand("path", WEBCMD, WU, "ESP220", "SD/Run", runSDFile, nullptr);
+    new WebCommand("path", WEBCMD, WU, NULL, "SD/Compile", compileSDFile);
     new WebCommand("file_or_directory_path", WEBCMD, WU, "ESP215", "SD/Delete", deleteSDObject);
     new WebCommand("path", WEBCMD, WU, NULL, "SD/Rename", renameSDObject);
     new WebCommand(NULL, WEBCMD, WU, "ESP210", "SD/List", listSDFiles);
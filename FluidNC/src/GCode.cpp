@@ -50,6 +50,7 @@ gc_modal_t modal_defaults = {
     // CutterCompensation::Disable,
     ToolLengthOffset::Cancel,
     CoordIndex::G54,
+    ControlMode::ExactPath,
     ProgramFlow::Running,
     {}, // 0, // CoolantState::M7,
     SpindleState::Disable,
@@ -580,12 +581,20 @@ Error gc_execute_line(char* line) {
                         break;
                         // NOTE: G59.x are not supported.
                     case 61:
-                        if (mantissa != 0) {
-                            FAIL(Error::GcodeUnsupportedCommand);  // [G61.1 not supported]
+                        if (mantissa == 10) {
+                            gc_block.modal.control = ControlMode::ExactStop;  // G61.1
+                            mantissa               = 0;  // Set to zero to indicate valid non-integer G command.
+                        } else if (mantissa == 0) {
+                            gc_block.modal.control = ControlMode::ExactPath;  // G61
+                        } else {
+                            FAIL(Error::GcodeUnsupportedCommand);
                         }
-                        // gc_block.modal.control = ControlMode::ExactPath; // G61
                         mg_word_bit = ModalGroup::MG13;
                         break;
+                    case 64:
+                        gc_block.modal.control = ControlMode::Continuous;  // G64
+                        mg_word_bit            = ModalGroup::MG13;
+                        break;
                     default:
                         FAIL(Error::GcodeUnsupportedCommand);  // [Unsupported G command]
                 }
@@ -918,6 +927,21 @@ Error gc_execute_line(char* line) {
         }
     }
     // clear_bitnum(value_words, GCodeWord::N); // NOTE: Single-meaning value word. Set at end of error-checking.
+    // G64 P is the path tolerance, so P cannot also be meant for another command in the block.
+    // G2/G3 (turns), G4, G10, G38, M56 and M62-M66 use P for something else.
+    bool setPathTolerance = bitnum_is_true(command_words, ModalGroup::MG13) && gc_block.modal.control == ControlMode::Continuous;
+    if (setPathTolerance && bitnum_is_true(value_words, GCodeWord::P)) {
+        auto motion = gc_block.modal.motion;
+        auto io     = gc_block.modal.io_control;
+        bool arc    = motion == Motion::CwArc || motion == Motion::CcwArc;
+        bool probe  = motion >= Motion::ProbeToward && motion <= Motion::ProbeAwayNoError;
+        bool output = io == IoControl::DigitalOnSync || io == IoControl::DigitalOffSync || io == IoControl::DigitalOnImmediate ||
+                      io == IoControl::DigitalOffImmediate || io == IoControl::WaitOnInput;
+        if ((axis_command == AxisCommand::MotionMode && (arc || probe)) || output || bitnum_is_true(command_words, ModalGroup::MM9) ||
+            gc_block.non_modal_command == NonModal::Dwell || gc_block.non_modal_command == NonModal::SetCoordinateData) {
+            FAIL(Error::GcodeWordRepeated);
+        }
+    }
     // Track for unused words at the end of error-checking.
     // NOTE: Single-meaning value words are removed all at once at the end of error-checking, because
     // they are always used when present. This was done to save a few bytes of flash. For clarity, the
@@ -1127,7 +1151,24 @@ Error gc_execute_line(char* line) {
             coords[gc_block.modal.coord_select]->get(block_coord_system);
         }
     }
-    // [16. Set path control mode ]: N/A. Only G61. G61.1 and G64 NOT SUPPORTED.
+    // [16. Set path control mode ]: G64 P is the path tolerance. It must not be negative.
+    // It is kept apart from gc_block.values.p, which G64 leaves for the other commands.
+    float pathTolerance = gc_state.path_tolerance;
+    if (setPathTolerance) {
+        if (bitnum_is_true(value_words, GCodeWord::P)) {
+            if (gc_block.values.p < 0.0) {
+                FAIL(Error::NegativeValue);
+            }
+            pathTolerance = gc_block.values.p;
+            if (gc_block.modal.units == Units::Inches) {
+                pathTolerance *= MM_PER_INCH;
+            }
+            clear_bitnum(value_words, GCodeWord::P);
+        } else {
+            // Without P, round corners by the same deviation that sets the cornering speed in G61
+            pathTolerance = config->_junctionDeviation;
+        }
+    }
     // [17. Set distance mode ]: N/A. Only G91.1. G90.1 NOT SUPPORTED.
     // [18. Set retract mode ]: NOT SUPPORTED.
     // [19. Remaining non-modal actions ]: Check go to predefined position, set G10, or set axis offsets.
@@ -1787,8 +1828,24 @@ Error gc_execute_line(char* line) {
         copyAxes(gc_state.coord_system, block_coord_system);
         gc_wco_changed();
     }
-    // [16. Set path control mode ]: G61.1/G64 NOT SUPPORTED
-    // gc_state.modal.control = gc_block.modal.control; // NOTE: Always default.
+    // [16. Set path control mode ]:
+    gc_state.modal.control = gc_block.modal.control;
+    gc_state.path_tolerance = pathTolerance;
+    switch (gc_state.modal.control) {
+        case ControlMode::ExactPath:
+            // Merging nearly collinear lines leaves the corners where they are.
+            pl_data->path_tolerance = config->_mergeTolerance;
+            break;
+        case ControlMode::ExactStop:
+            pl_data->motion.exactStop = 1;
+            break;
+        case ControlMode::Continuous:
+            // Half of the tolerance goes to merging lines and half to rounding the corners
+            // between them, so the path stays within P of the programmed one.
+            pl_data->path_tolerance     = 0.5f * gc_state.path_tolerance;
+            pl_data->motion.blendCorner = 1;
+            break;
+    }
     // [17. Set distance mode ]:
     gc_state.modal.distance = gc_block.modal.distance;
     // [18. Set retract mode ]: NOT SUPPORTED
@@ -2006,7 +2063,6 @@ void gc_exec_linef(bool sync_after, Channel& out, const char* format, ...) {
    group 8 = {M7*} enable mist coolant (* Compile-option)
    group 9 = {M48, M49} enable/disable feed and speed override switches
    group 10 = {G98, G99} return mode canned cycles
-   group 13 = {G61.1, G64} path control mode (G61 is supported)
 */
 
 static std::optional<WaitOnInputMode> validate_wait_on_input_mode_value(uint8_t value) {
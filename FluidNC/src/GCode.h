@@ -133,7 +133,9 @@ enum class CutterCompensation : gcodenum_t {
 
 // Modal Group G13: Control mode
 enum class ControlMode : gcodenum_t {
-    ExactPath = 610,  // G61
+    ExactPath  = 610,  // G61 Default
+    ExactStop  = 611,  // G61.1
+    Continuous = 640,  // G64
 };
 
 // GCodeCoolant is used by the parser, where at most one of
@@ -270,7 +272,7 @@ struct gc_modal_t {
     // CutterCompensation cutter_comp;  // {G40} NOTE: Don't track. Only default supported.
     ToolLengthOffset tool_length;   // {G43.1,G49}
     CoordIndex       coord_select;  // {G54,G55,G56,G57,G58,G59}
-    // uint8_t control;      // {G61} NOTE: Don't track. Only default supported.
+    ControlMode      control;       // {G61,G61.1,G64}
     ProgramFlow   program_flow;  // {M0,M1,M2,M30}
     CoolantState  coolant;       // {M7,M8,M9}
     SpindleState  spindle;       // {M3,M4,M5}
@@ -312,6 +314,7 @@ struct parser_state_t {
     // machine zero in mm. Non-persistent. Cleared upon reset and boot.
     float tool_length_offset;  // Tracks tool length offset value when enabled.
     bool  skip_blocks;         // Skipping due to flow control
+    float path_tolerance;      // G64 P value in mm
 };
 
 extern parser_state_t gc_state;
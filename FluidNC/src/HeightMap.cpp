@@ -0,0 +1,214 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "HeightMap.h"
+
+#include "Machine/MachineConfig.h"
+#include "MotionControl.h"  // mc_linear, mc_probe_cycle, probe_succeeded
+#include "Protocol.h"       // protocol_buffer_synchronize
+#include "GCode.h"          // gc_state, gc_sync_position
+#include "System.h"         // probe_steps, motor_steps_to_mpos
+#include "FileStream.h"
+#include "FluidPath.h"
+#include "Driver/localfs.h"  // localfsName
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+// The file is plain text so it can be inspected and edited:
+// the first line is "x0 y0 dx dy nx ny", followed by one row of heights per line
+bool HeightMap::save() {
+    try {
+        FileStream file(_filename, "w", localfsName);
+        char       buf[80];
+        int        nx = _grid.nx(), ny = _grid.ny();
+        snprintf(buf, sizeof(buf), "%.3f %.3f %.4f %.4f %d %d\n", _grid.x0(), _grid.y0(), _grid.dx(), _grid.dy(), nx, ny);
+        file.write((const uint8_t*)buf, strlen(buf));
+        for (int j = 0; j < ny; j++) {
+            for (int i = 0; i < nx; i++) {
+                snprintf(buf, sizeof(buf), i == nx - 1 ? "%.4f\n" : "%.4f ", _grid.height(i, j));
+                file.write((const uint8_t*)buf, strlen(buf));
+            }
+        }
+    } catch (...) {
+        log_error("Cannot write height map " << _filename);
+        return false;
+    }
+    return true;
+}
+
+bool HeightMap::load() {
+    std::unique_ptr<char[]> buffer;
+    try {
+        FileStream file(_filename, "r", localfsName);
+        auto       size = file.size();
+        buffer          = std::make_unique<char[]>(size + 1);
+        buffer[size]    = '\0';
+        if (file.read(buffer.get(), size) != size) {
+            return false;
+        }
+    } catch (...) {
+        // No stored map
+        return false;
+    }
+
+    char* p = buffer.get();
+    char* end;
+    float header[6];
+    for (auto& value : header) {
+        value = strtof(p, &end);
+        if (end == p) {
+            log_error("Height map " << _filename << " has a bad header");
+            return false;
+        }
+        p = end;
+    }
+    float x0 = header[0], y0 = header[1];
+    int   nx = int(header[4]), ny = int(header[5]);
+    if (!_grid.set(x0, y0, x0 + header[2] * (nx - 1), y0 + header[3] * (ny - 1), nx, ny)) {
+        log_error("Height map " << _filename << " has a bad grid");
+        return false;
+    }
+    for (auto& z : _grid.heights()) {
+        z = strtof(p, &end);
+        if (end == p) {
+            log_error("Height map " << _filename << " is missing points");
+            return false;
+        }
+        p = end;
+    }
+    _grid.build();
+    return true;
+}
+
+void HeightMap::init() {
+    if (Axes::_numberAxis > Z_AXIS && load()) {
+        _active = true;
+        log_info("Height map: " << _grid.nx() << "x" << _grid.ny() << " points from " << _filename);
+    }
+}
+
+Error HeightMap::probe(float x0, float y0, float x1, float y1, int nx, int ny) {
+    if (Axes::_numberAxis <= Z_AXIS || !config->_probe->exists()) {
+        return Error::InvalidStatement;
+    }
+    if (!HeightMapGrid::valid(x0, y0, x1, y1, nx, ny)) {
+        return Error::InvalidValue;
+    }
+
+    // Probe without compensation, so the positions below are raw machine positions.
+    // The heights go into a new grid, so the current map survives a failed probe.
+    protocol_buffer_synchronize();
+    bool was_active = _active;
+    _active         = false;
+    gc_sync_position();
+
+    float              dx = (x1 - x0) / (nx - 1);
+    float              dy = (y1 - y0) / (ny - 1);
+    std::vector<float> heights(nx * ny);
+
+    plan_line_data_t travel = {};
+    travel.motion.rapidMotion = 1;
+    travel.spindle            = SpindleState::Disable;
+    travel.coolant            = gc_state.modal.coolant;
+
+    plan_line_data_t probing = travel;
+    probing.motion           = {};
+    probing.feed_rate        = _probe_rate;
+    if (!ALLOW_FEED_OVERRIDE_DURING_PROBE_CYCLES) {
+        probing.motion.noFeedOverride = 1;
+    }
+
+    float safe_z = gc_state.position[Z_AXIS];
+    float target[MAX_N_AXIS];
+    copyAxes(target, gc_state.position);
+
+    for (int j = 0; j < ny; j++) {
+        // Serpentine order to shorten the travel between points
+        for (int n = 0; n < nx; n++) {
+            int i = (j & 1) ? nx - 1 - n : n;
+
+            target[X_AXIS] = x0 + i * dx;
+            target[Y_AXIS] = y0 + j * dy;
+            target[Z_AXIS] = safe_z;
+            mc_linear(target, &travel, gc_state.position);
+            copyAxes(gc_state.position, target);
+
+            target[Z_AXIS] = safe_z - _depth;
+            mc_probe_cycle(target, &probing, false, false, 0, __FLT_MAX__);
+            if (sys.abort || !probe_succeeded) {
+                log_error("Height map probing failed at " << target[X_AXIS] << "," << target[Y_AXIS]);
+                _active = was_active;
+                gc_sync_position();
+                return Error::InvalidStatement;
+            }
+            gc_sync_position();
+
+            float contact[MAX_N_AXIS];
+            motor_steps_to_mpos(contact, probe_steps);
+            heights[j * nx + i] = contact[Z_AXIS];
+
+            copyAxes(target, gc_state.position);
+            target[Z_AXIS] = safe_z;
+            mc_linear(target, &travel, gc_state.position);
+            copyAxes(gc_state.position, target);
+        }
+    }
+    protocol_buffer_synchronize();
+    if (sys.abort) {
+        _active = was_active;
+        gc_sync_position();
+        return Error::Reset;
+    }
+
+    // Heights are relative to the first point, where Z is expected to be zeroed
+    _grid.set(x0, y0, x1, y1, nx, ny);
+    auto& z = _grid.heights();
+    for (size_t n = 0; n < heights.size(); n++) {
+        z[n] = heights[n] - heights[0];
+    }
+    _grid.build();
+    save();
+
+    _active = true;
+    gc_sync_position();
+    log_info("Height map: " << nx << "x" << ny << " points saved to " << _filename);
+    return Error::Ok;
+}
+
+void HeightMap::clear() {
+    if (_active) {
+        protocol_buffer_synchronize();
+        _active = false;
+        gc_sync_position();
+    }
+    std::error_code ec;
+    stdfs::remove(FluidPath { _filename, localfsName, ec }, ec);
+}
+
+void HeightMap::show(Channel& out) {
+    if (!_active) {
+        log_info_to(out, "No height map");
+        return;
+    }
+    log_info_to(out,
+                "Height map " << _grid.nx() << "x" << _grid.ny() << " origin " << _grid.x0() << "," << _grid.y0() << " spacing "
+                              << _grid.dx() << "," << _grid.dy());
+    for (int j = _grid.ny() - 1; j >= 0; j--) {
+        std::string row;
+        char        buf[16];
+        for (int i = 0; i < _grid.nx(); i++) {
+            snprintf(buf, sizeof(buf), " %.3f", _grid.height(i, j));
+            row += buf;
+        }
+        log_info_to(out, row);
+    }
+}
+
+void HeightMap::group(Configuration::HandlerBase& handler) {
+    handler.item("file", _filename);
+    handler.item("probe_depth_mm", _depth, 0.1, 1000.0);
+    handler.item("probe_rate_mm_per_min", _probe_rate, 1.0, 100000.0);
+}
@@ -0,0 +1,70 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  HeightMap.h - Height map (mesh bed leveling) compensation.
+
+  $Probe/Grid probes a rectangular grid of points with G38.2 and stores the
+  heights in a file on the local filesystem.  While a map is loaded, the
+  Kinematics layer splits each line at the grid cell boundaries and adds the
+  bilinearly interpolated height to Z, so the tool follows a warped surface.
+  The reverse transform is applied when motor positions are converted back
+  to cartesian, so the reported machine position is the uncompensated one.
+  Moves to machine positions (G53, G28, G30) are compensated like any other
+  move, so that MPos reads back the position that was commanded.  System
+  motions such as homing and parking work in motor positions and are not.
+*/
+
+#include "Configuration/HandlerBase.h"
+#include "Configuration/Configurable.h"
+#include "Error.h"
+#include "HeightMapGrid.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Channel;
+
+class HeightMap : public Configuration::Configurable {
+    // Configuration
+    std::string _filename   = "heightmap.txt";
+    float       _depth      = 10.0f;   // Maximum probing distance below the starting Z
+    float       _probe_rate = 100.0f;  // mm/min
+
+    // Probed heights relative to the first point
+    HeightMapGrid _grid;
+
+    bool _active = false;
+
+    bool load();
+    bool save();
+
+public:
+    HeightMap() = default;
+
+    void init();
+
+    bool active() const { return _active; }
+
+    // Z offset at machine position (x,y)
+    float offset(float x, float y) const { return _grid.offset(x, y); }
+
+    // Fraction of the way from "from" to "to" where the line next crosses the grid
+    float next_crossing(const float* from, const float* to, float t) const { return _grid.next_crossing(from, to, t); }
+
+    // Probes the grid and, if every point succeeds, saves and activates the map.
+    // Otherwise the previous map, if any, stays in use.
+    Error probe(float x0, float y0, float x1, float y1, int nx, int ny);
+
+    // Deactivates compensation and removes the stored map
+    void clear();
+
+    void show(Channel& out);
+
+    // Configuration handlers.
+    void group(Configuration::HandlerBase& handler) override;
+
+    ~HeightMap() = default;
+};
@@ -0,0 +1,92 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "HeightMapGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+bool HeightMapGrid::valid(float x0, float y0, float x1, float y1, int nx, int ny) {
+    return nx >= 2 && ny >= 2 && nx <= max_points && ny <= max_points && x1 > x0 && y1 > y0;
+}
+
+bool HeightMapGrid::set(float x0, float y0, float x1, float y1, int nx, int ny) {
+    if (!valid(x0, y0, x1, y1, nx, ny)) {
+        return false;
+    }
+    _x0    = x0;
+    _y0    = y0;
+    _nx    = nx;
+    _ny    = ny;
+    _dx    = (x1 - x0) / (nx - 1);
+    _dy    = (y1 - y0) / (ny - 1);
+    _invDx = 1.0f / _dx;
+    _invDy = 1.0f / _dy;
+    _z.assign(nx * ny, 0.0f);
+    return true;
+}
+
+// Precompute the bilinear coefficients so offset() costs the same for every cell
+void HeightMapGrid::build() {
+    _cells.resize((_nx - 1) * (_ny - 1));
+    for (int j = 0; j < _ny - 1; j++) {
+        for (int i = 0; i < _nx - 1; i++) {
+            float z00 = _z[j * _nx + i];
+            float z10 = _z[j * _nx + i + 1];
+            float z01 = _z[(j + 1) * _nx + i];
+            float z11 = _z[(j + 1) * _nx + i + 1];
+
+            Cell& cell = _cells[j * (_nx - 1) + i];
+            cell.a     = z00;
+            cell.b     = z10 - z00;
+            cell.c     = z01 - z00;
+            cell.d     = z11 - z10 - z01 + z00;
+        }
+    }
+}
+
+float HeightMapGrid::offset(float x, float y) const {
+    float u = std::clamp((x - _x0) * _invDx, 0.0f, float(_nx - 1));
+    float v = std::clamp((y - _y0) * _invDy, 0.0f, float(_ny - 1));
+    int   i = std::min(int(u), _nx - 2);
+    int   j = std::min(int(v), _ny - 2);
+    u -= i;
+    v -= j;
+
+    const Cell& cell = _cells[j * (_nx - 1) + i];
+    return cell.a + cell.b * u + (cell.c + cell.d * u) * v;
+}
+
+float HeightMapGrid::next_crossing(const float* from, const float* to, float t) const {
+    const float eps  = 1e-4f;  // In grid units, so a point on a line does not cross it again
+    float       next = 1.0f;
+
+    for (int axis = 0; axis < 2; axis++) {
+        float delta = to[axis] - from[axis];
+        if (delta == 0.0f) {
+            continue;
+        }
+        float origin  = axis == 0 ? _x0 : _y0;
+        float spacing = axis == 0 ? _dx : _dy;
+        int   last    = (axis == 0 ? _nx : _ny) - 1;
+
+        // Position at t in grid units, and the next grid line in the direction of travel
+        float pos = (from[axis] + t * delta - origin) / spacing;
+        int   line;
+        if (delta > 0) {
+            line = std::max(int(floorf(pos + eps)) + 1, 0);
+            if (line > last) {
+                continue;
+            }
+        } else {
+            line = std::min(int(ceilf(pos - eps)) - 1, last);
+            if (line < 0) {
+                continue;
+            }
+        }
+        float crossing = (origin + line * spacing - from[axis]) / delta;
+        if (crossing > t && crossing < next) {
+            next = crossing;
+        }
+    }
+    return next;
+}
@@ -0,0 +1,61 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  HeightMapGrid.h - the geometry of a height map, without the probing and
+  storage in HeightMap.
+
+  Point (i,j) of the grid is at (x0 + i*dx, y0 + j*dy).  Between the points
+  the height is interpolated bilinearly, and beyond the edges of the grid the
+  heights at the edges continue outward.
+*/
+
+#include <vector>
+
+class HeightMapGrid {
+    float _x0 = 0, _y0 = 0;
+    float _dx = 1, _dy = 1;
+    float _invDx = 1, _invDy = 1;
+    int   _nx = 0, _ny = 0;
+
+    // Heights row by row
+    std::vector<float> _z;
+
+    // Bilinear coefficients for each cell, so that within a cell the offset
+    // is a + b*u + c*v + d*u*v with u and v running from 0 to 1 across it.
+    struct Cell {
+        float a, b, c, d;
+    };
+    std::vector<Cell> _cells;
+
+public:
+    static const int max_points = 64;  // Per side
+
+    static bool valid(float x0, float y0, float x1, float y1, int nx, int ny);
+
+    // Sets the grid to span (x0,y0) to (x1,y1) with all heights zero.
+    // Returns false, leaving the grid unchanged, if it is not valid.
+    bool set(float x0, float y0, float x1, float y1, int nx, int ny);
+
+    // Heights row by row.  Call build() after changing them.
+    std::vector<float>& heights() { return _z; }
+    float               height(int i, int j) const { return _z[j * _nx + i]; }
+
+    void build();
+
+    float x0() const { return _x0; }
+    float y0() const { return _y0; }
+    float dx() const { return _dx; }
+    float dy() const { return _dy; }
+    int   nx() const { return _nx; }
+    int   ny() const { return _ny; }
+
+    // Height at (x,y)
+    float offset(float x, float y) const;
+
+    // Returns the fraction of the way from "from" to "to" where the XY
+    // projection of the line next crosses a grid line after fraction t,
+    // or 1.0 if it does not.  X and Y are the first two elements.
+    float next_crossing(const float* from, const float* to, float t) const;
+};
@@ -4,8 +4,124 @@
 #include "InputFile.h"
 
 #include "Report.h"
+#include "Config.h"              // SUPPORT_TASK_CORE
+#include "Driver/delay_usecs.h"  // getUsecs
 
-InputFile::InputFile(const char* defaultFs, const char* path) : FileStream(path, "r", defaultFs) {}
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <algorithm>
+#include <cstring>
+
+// One task reads ahead for every open file, in the order the blocks were requested.
+// A request for block idle_marker does no reading; it only tells the task that queued
+// it that every fill queued before it has finished.
+struct FillRequest {
+    InputFile*   file;
+    int          block;
+    TaskHandle_t waiter;
+};
+static QueueHandle_t prefetch_queue = nullptr;
+static const int     idle_marker    = -1;
+
+void InputFile::prefetch_loop(void* unused) {
+    FillRequest request;
+    while (true) {
+        if (xQueueReceive(prefetch_queue, &request, portMAX_DELAY)) {
+            if (request.block == idle_marker) {
+                // The file may be deleted as soon as _idle is seen, so the
+                // waiter is notified through the copy in the request
+                request.file->_idle = true;
+                xTaskNotifyGive(request.waiter);
+            } else {
+                request.file->fill(request.block);
+            }
+        }
+    }
+}
+
+// Reads up to the end of the block, or to the first sector boundary after a seek
+void InputFile::fill(int index) {
+    Block&   block = _blocks[index];
+    size_t   want  = block_size - FileStream::position() % sector_size;
+    uint32_t start = getUsecs();
+    block.length   = FileStream::read(block.data, want);
+    _read_us += getUsecs() - start;
+    block.last  = block.length < want;
+    block.ready = true;
+    // next_block() publishes _waiter before it tests ready, so either it sees
+    // ready or this sees the waiter
+    TaskHandle_t waiter = _waiter;
+    if (waiter) {
+        xTaskNotifyGive(waiter);
+    }
+}
+
+void InputFile::request(int index) {
+    _blocks[index].ready = false;
+    FillRequest request  = { this, index, nullptr };
+    xQueueSend(prefetch_queue, &request, portMAX_DELAY);
+}
+
+// Blocks until the prefetch task has finished every fill queued for this file.
+// The notification count only wakes the task; the flags say whether to go on.
+void InputFile::wait_idle() {
+    _idle               = false;
+    FillRequest request = { this, idle_marker, xTaskGetCurrentTaskHandle() };
+    xQueueSend(prefetch_queue, &request, portMAX_DELAY);
+    while (!_idle) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+// Discards the read-ahead and starts reading at the current file position
+void InputFile::start() {
+    if (!prefetch_queue) {
+        prefetch_queue = xQueueCreate(8, sizeof(FillRequest));
+        xTaskCreatePinnedToCore(prefetch_loop,     // task
+                                "prefetch",        // name for task
+                                4096,              // size of task stack
+                                0,                 // parameters
+                                1,                 // priority
+                                NULL,              // task handle
+                                SUPPORT_TASK_CORE  // core
+        );
+    }
+    _current = 0;
+    _offset  = 0;
+    request(0);
+    request(1);
+}
+
+// Moves to the other block once the current one has been scanned, and
+// hands the scanned one back to be refilled.  Returns false at end of file.
+bool InputFile::next_block() {
+    Block& block = _blocks[_current];
+    if (!block.ready) {
+        ++_stalls;
+        _waiter = xTaskGetCurrentTaskHandle();
+        while (!block.ready) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+        _waiter = nullptr;
+    }
+    if (_offset < block.length) {
+        return true;
+    }
+    if (block.last) {
+        return false;
+    }
+    request(_current);
+    _current ^= 1;
+    _offset = 0;
+    return next_block();
+}
+
+InputFile::InputFile(const char* defaultFs, const char* path) : FileStream(path, "r", defaultFs) {
+    _start_ticks = xTaskGetTickCount();
+    _consumed    = FileStream::position();
+    start();
+}
 /*
   Read a line from the file
   Returns Error::Ok if a line was read, even if the line was empty.
@@ -14,25 +130,68 @@ InputFile::InputFile(const char* defaultFs, const char* path) : FileStream(path,
 */
 Error InputFile::readLine(char* line, int maxlen) {
     int len = 0;
-    int c;
-    while ((c = read()) >= 0) {
-        if (len >= maxlen) {
-            return Error::LineLengthExceeded;
-        }
-        if (c == '\r') {
-            continue;
+    while (next_block()) {
+        Block&      block = _blocks[_current];
+        const char* start = block.data + _offset;
+        auto        end   = static_cast<const char*>(memchr(start, '\n', block.length - _offset));
+        size_t      n     = (end ? end : block.data + block.length) - start;
+        for (size_t i = 0; i < n; i++) {
+            if (len >= maxlen) {
+                return Error::LineLengthExceeded;
+            }
+            if (start[i] != '\r') {
+                line[len++] = start[i];
+            }
         }
-        if (c == '\n') {
+        _offset += n;
+        _consumed += n;
+        if (end) {
+            if (len >= maxlen) {
+                return Error::LineLengthExceeded;
+            }
+            ++_offset;
+            ++_consumed;
             ++_line_number;
             if (len == 0) {
                 ++_blank_lines;
             }
-            break;
+            line[len] = '\0';
+            return Error::Ok;
         }
-        line[len++] = c;
     }
     line[len] = '\0';
-    return len || c >= 0 ? Error::Ok : Error::Eof;
+    return len ? Error::Ok : Error::Eof;
+}
+
+size_t InputFile::readData(char* buffer, size_t len) {
+    size_t done = 0;
+    while (done < len && next_block()) {
+        Block& block = _blocks[_current];
+        size_t n     = std::min(len - done, block.length - _offset);
+        memcpy(buffer + done, block.data + _offset, n);
+        _offset += n;
+        _consumed += n;
+        done += n;
+    }
+    return done;
+}
+
+void InputFile::set_position(size_t pos) {
+    wait_idle();
+    FileStream::set_position(pos);
+    _consumed = pos;
+    start();
+}
+
+// FileStream::save() remembers position(), which is where the next line starts
+void InputFile::save() {
+    wait_idle();
+    FileStream::save();
+}
+
+void InputFile::restore() {
+    FileStream::restore();
+    start();
 }
 
 void InputFile::ack(Error status) {
@@ -54,6 +213,25 @@ void InputFile::end_message() {
     _progress = "SD: ";
     _progress += name();
     _progress += ": Sent";
+
+    // The job rate includes the time spent waiting for the planner; the card rate is the
+    // time actually spent reading.  A job rate well below the card rate with few stalls
+    // means the card is keeping up.
+    uint32_t ms = (xTaskGetTickCount() - _start_ticks) * portTICK_PERIOD_MS;
+    if (ms) {
+        log_info(name() << ": " << _consumed << " bytes, " << _line_number << " lines in " << ms << " ms, "
+                        << uint32_t(uint64_t(_consumed) * 1000 / ms) << " bytes/s, " << uint32_t(uint64_t(_line_number) * 1000 / ms)
+                        << " lines/s, card " << (_read_us ? uint32_t(uint64_t(_consumed) * 1000000 / _read_us) : 0) << " bytes/s, "
+                        << _stalls << " stalls");
+    }
+}
+
+void InputFile::update_progress() {
+    float percent_complete = ((float)_consumed) * 100.0f / size();
+
+    std::ostringstream s;
+    s << "SD:" << std::fixed << std::setprecision(2) << percent_complete << "," << path().c_str();
+    _progress = s.str();
 }
 
 Error InputFile::pollLine(char* line) {
@@ -81,13 +259,8 @@ Error InputFile::pollLine(char* line) {
         return Error::Eof;
     }
     switch (auto err = readLine(line, Channel::maxLine)) {
-        case Error::Ok: {
-            float percent_complete = ((float)position()) * 100.0f / size();
-
-            std::ostringstream s;
-            s << "SD:" << std::fixed << std::setprecision(2) << percent_complete << "," << path().c_str();
-            _progress = s.str();
-        }
+        case Error::Ok:
+            update_progress();
             return Error::Ok;
         case Error::Eof:
             end_message();
@@ -98,4 +271,7 @@ Error InputFile::pollLine(char* line) {
     }
 }
 
-InputFile::~InputFile() {}
+// The prefetch task must not be left filling a block of a deleted file
+InputFile::~InputFile() {
+    wait_idle();
+}
@@ -8,6 +8,9 @@
 //  - For reporting the progress of GCode execution, counts the number of lines read and
 //    the percentage of the file size that has currently been read.
 //  - For reporting status, remembers the I/O channel that started the process of using the file.
+//  - Reads the file ahead of readLine() in large blocks, using a background task and a
+//    double buffer, so a slow SD card does not stall the job between lines.  When the job
+//    ends, the achieved bytes/s and lines/s are logged.
 // FileStream's Channel member is not that same Channel that FileStream ultimately
 // inherits from; rather it is a separate channel that is use for status reporting.
 
@@ -17,15 +20,54 @@
 #include "FileStream.h"  // FileStream and Channel
 #include "Error.h"
 
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>  // TaskHandle_t
+#include <atomic>
 #include <cstdint>
 
 class InputFile : public FileStream {
-private:
+protected:
     Error _pending_error = Error::Ok;
     void  end_message();
+    void  update_progress();
+
+    // Copies the next len bytes of the file to buffer.  Returns fewer at end of file.
+    size_t readData(char* buffer, size_t len);
 
+private:
     size_t _blank_lines = 0;
 
+    // Read-ahead.  The prefetch task fills one block while readLine() scans the other.
+    // Reads are a multiple of the SD sector size and start on a sector boundary.
+    static const size_t sector_size = 512;
+    static const size_t block_size  = 8 * sector_size;
+
+    struct Block {
+        char              data[block_size];
+        size_t            length;
+        bool              last;  // The file ends in this block
+        std::atomic<bool> ready;
+    };
+    Block                     _blocks[2];
+    int                       _current  = 0;  // Block that readLine() is scanning
+    size_t                    _offset   = 0;  // Next byte to scan in the current block
+    size_t                    _consumed = 0;  // File position of that byte
+    std::atomic<TaskHandle_t> _waiter { nullptr };  // Task blocked in next_block(), notified by fill()
+    std::atomic<bool>         _idle { true };       // Set by the prefetch task when wait_idle() may return
+
+    // Throughput, for the end of job message
+    uint32_t _start_ticks;
+    uint64_t _read_us = 0;  // Time the prefetch task spent reading
+    size_t   _stalls  = 0;  // Times readLine() had to wait for the card
+
+    void start();
+    void request(int block);
+    void wait_idle();
+    bool next_block();
+
+    static void prefetch_loop(void* unused);
+    void        fill(int block);
+
 public:
     // fsname is the default file system on which the file is located, in case the path does not specify
     // path is the full path to the file
@@ -52,5 +94,11 @@ public:
     void   ack(Error status) override;
     Error  pollLine(char* line) override;
 
+    // The position of the next line, not of the read-ahead
+    size_t position() override { return _consumed; }
+    void   set_position(size_t pos) override;
+    void   save() override;
+    void   restore() override;
+
     ~InputFile();
 };
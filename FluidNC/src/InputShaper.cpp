@@ -0,0 +1,92 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "InputShaper.h"
+
+#include <cmath>
+
+void InputShaper::reset() {
+    _n            = 1;
+    _amplitude[0] = 1.0f;
+    _time[0]      = 0.0f;
+    _duration     = 0.0f;
+}
+
+bool InputShaper::add(Type type, float frequency) {
+    if (type == None || frequency <= 0.0f) {
+        return true;
+    }
+
+    // Impulses as fractions of the resonance period, for zero damping
+    float       half = 0.5f / frequency;
+    float       a[3], t[3];
+    int         n;
+    const float mzv_edge = 1.0f - 1.0f / sqrtf(2.0f);
+    switch (type) {
+        case ZV:
+            n = 2;
+            a[0] = a[1] = 0.5f;
+            t[0]        = 0.0f;
+            t[1]        = half;
+            break;
+        case ZVD:
+            n    = 3;
+            a[0] = a[2] = 0.25f;
+            a[1]        = 0.5f;
+            t[0]        = 0.0f;
+            t[1]        = half;
+            t[2]        = 2.0f * half;
+            break;
+        default:  // MZV
+            n    = 3;
+            a[0] = a[2] = mzv_edge;
+            a[1]        = 1.0f - 2.0f * mzv_edge;
+            t[0]        = 0.0f;
+            t[1]        = 0.75f * half;
+            t[2]        = 1.5f * half;
+            break;
+    }
+    if (_n * n > max_impulses) {
+        return false;
+    }
+
+    // Convolve, working backwards so the existing impulses are read before they are overwritten
+    for (int i = _n - 1; i >= 0; i--) {
+        for (int j = n - 1; j >= 0; j--) {
+            _amplitude[i * n + j] = _amplitude[i] * a[j];
+            _time[i * n + j]      = _time[i] + t[j];
+        }
+    }
+    _n *= n;
+    _duration += t[n - 1];
+    return true;
+}
+
+// The acceleration pulse of length ramp_duration - duration(), convolved with the
+// impulses, integrated once for speed and twice for distance.
+float InputShaper::speed_fraction(float t, float ramp_duration) const {
+    float pulse = ramp_duration - _duration;
+    float sum   = 0.0f;
+    for (int i = 0; i < _n; i++) {
+        float u = t - _time[i];
+        if (u >= pulse) {
+            sum += _amplitude[i];
+        } else if (u > 0.0f) {
+            sum += _amplitude[i] * u / pulse;
+        }
+    }
+    return sum;
+}
+
+float InputShaper::distance_fraction(float t, float ramp_duration) const {
+    float pulse = ramp_duration - _duration;
+    float sum   = 0.0f;
+    for (int i = 0; i < _n; i++) {
+        float u = t - _time[i];
+        if (u >= pulse) {
+            sum += _amplitude[i] * (u - 0.5f * pulse);
+        } else if (u > 0.0f) {
+            sum += _amplitude[i] * 0.5f * u * u / pulse;
+        }
+    }
+    return sum;
+}
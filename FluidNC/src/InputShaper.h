@@ -0,0 +1,63 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  InputShaper.h - impulse trains that cancel a structural resonance.
+
+  Convolving an acceleration profile with a shaper's impulses leaves no
+  residual vibration at the shaper frequency.  ZV cancels one frequency,
+  ZVD and MZV also flatten the response around it, at the cost of a longer
+  shaper.  The damping ratio is taken as zero, which makes every shaper
+  symmetric in time.
+
+  The segment generator applies a shaper to a whole speed ramp: the ramp's
+  constant acceleration pulse is shortened by the shaper duration and then
+  convolved with the impulses.  Because the shaper is symmetric, the shaped
+  ramp has the same duration, end speeds and distance as the planned one,
+  so the planner's junctions and ramp boundaries are traced exactly.
+*/
+
+#include <cstdint>
+
+class InputShaper {
+public:
+    enum Type : int {
+        None = 0,
+        ZV,
+        ZVD,
+        MZV,
+    };
+
+    // Enough to cascade three-impulse shapers on three axes
+    static const int max_impulses = 27;
+
+    InputShaper() { reset(); }
+
+    // Back to a single impulse, which does no shaping
+    void reset();
+
+    // Cascades this shaper with one of the given type and frequency.
+    // Returns false if the result would have too many impulses.
+    bool add(Type type, float frequency);
+
+    bool  active() const { return _n > 1; }
+    int   impulses() const { return _n; }
+    float duration() const { return _duration; }  // Seconds
+
+    // The shortest ramp, in seconds, whose shaped acceleration peaks at no more than
+    // peak_ratio times its average.  The shortened pulse carries the whole speed change,
+    // so the peak is ramp_duration / (ramp_duration - duration()) times the average.
+    float min_ramp_duration(float peak_ratio) const { return _duration * peak_ratio / (peak_ratio - 1.0f); }
+
+    // The shaped ramp of the given duration, both in seconds, as fractions of
+    // its speed change and of the distance it would travel at that speed change
+    float speed_fraction(float t, float ramp_duration) const;
+    float distance_fraction(float t, float ramp_duration) const;
+
+private:
+    int   _n;
+    float _amplitude[max_impulses];
+    float _time[max_impulses];
+    float _duration;
+};
@@ -18,7 +18,7 @@ Error jog_execute(plan_line_data_t* pl_data, parser_block_t* gc_block, bool* can
     // NOTE: Spindle and coolant are allowed to fully function with overrides during a jog.
     pl_data->feed_rate             = gc_block->values.f;
     pl_data->motion.noFeedOverride = 1;
-    pl_data->is_jog                = true;
+    pl_data->motion.jogMotion      = 1;
     pl_data->line_number           = gc_block->values.n;
 
     if (!mc_linear(gc_block->values.xyz, pl_data, gc_state.position)) {
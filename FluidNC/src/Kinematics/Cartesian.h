@@ -38,6 +38,7 @@ namespace Kinematics {
         virtual void init_position() override;
         void         motors_to_cartesian(float* cartesian, float* motors, int n_axis) override;
         bool         transform_cartesian_to_motors(float* cartesian, float* motors) override;
+        bool         isCartesian() override { return true; }
 
         bool         canHome(AxisMask axisMask) override;
         void         releaseMotors(AxisMask axisMask, MotorMask motors) override;
@@ -41,6 +41,7 @@ namespace Kinematics {
         void         afterParse() override {}
 
         bool transform_cartesian_to_motors(float* motors, float* cartesian) override;
+        bool isCartesian() override { return false; }
 
         ~CoreXY() {}
 
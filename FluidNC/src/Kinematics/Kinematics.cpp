@@ -5,7 +5,11 @@
 #include "Kinematics.h"
 
 #include "src/Config.h"
+#include "src/Machine/MachineConfig.h"  // config->_heightMap
 #include "Cartesian.h"
+#include "src/Limits.h"  // limit_error, limitsMinPosition
+
+#include <algorithm>
 
 namespace Kinematics {
     void Kinematics::constrain_jog(float* target, plan_line_data_t* pl_data, float* position) {
@@ -26,12 +30,72 @@ namespace Kinematics {
 
     bool Kinematics::cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* position) {
         Assert(_system != nullptr, "No kinematic system");
-        return _system->cartesian_to_motors(target, pl_data, position);
+        // Homing and parking plan motor positions, so they are not compensated
+        auto map = config->_heightMap;
+        if (!map || !map->active() || pl_data->motion.systemMotion) {
+            return _system->cartesian_to_motors(target, pl_data, position);
+        }
+
+        // Split the line where it crosses the height map grid, so each piece
+        // lies within one cell and the bilinear Z offset is exact at its ends.
+        auto  n_axis    = Axes::_numberAxis;
+        float feed_rate = pl_data->feed_rate;
+        float from[MAX_N_AXIS];
+        float piece[MAX_N_AXIS];
+        copyAxes(from, position);
+        from[Z_AXIS] += map->offset(position[X_AXIS], position[Y_AXIS]);
+
+        bool  z_limits = config->_axes->_axis[Z_AXIS]->_softLimits;
+        bool  result   = true;
+        float t        = 0.0f;
+        while (t < 1.0f) {
+            float next = map->next_crossing(position, target, t);
+            if (next >= 1.0f) {
+                copyAxes(piece, target);
+            } else {
+                for (size_t axis = 0; axis < n_axis; axis++) {
+                    piece[axis] = position[axis] + next * (target[axis] - position[axis]);
+                }
+            }
+            piece[Z_AXIS] += map->offset(piece[X_AXIS], piece[Y_AXIS]);
+
+            // The target was checked against the soft limits before compensation.
+            // A jog stops at the limit, as constrain_jog() does with its target.
+            if (z_limits) {
+                float z_min = limitsMinPosition(Z_AXIS);
+                float z_max = limitsMaxPosition(Z_AXIS);
+                if (piece[Z_AXIS] < z_min || piece[Z_AXIS] > z_max) {
+                    if (!pl_data->motion.jogMotion) {
+                        limit_error(Z_AXIS, piece[Z_AXIS]);
+                        result = false;
+                        break;
+                    }
+                    piece[Z_AXIS] = std::clamp(piece[Z_AXIS], z_min, z_max);
+                }
+            }
+
+            // With inverse time feed, each piece takes its share of the time
+            if (pl_data->motion.inverseTime) {
+                pl_data->feed_rate = feed_rate / (next - t);
+            }
+            result = _system->cartesian_to_motors(piece, pl_data, from);
+            if (!result) {
+                break;
+            }
+            copyAxes(from, piece);
+            t = next;
+        }
+        pl_data->feed_rate = feed_rate;
+        return result;
     }
 
     void Kinematics::motors_to_cartesian(float* cartesian, float* motors, int n_axis) {
         Assert(_system != nullptr, "No kinematic system");
-        return _system->motors_to_cartesian(cartesian, motors, n_axis);
+        _system->motors_to_cartesian(cartesian, motors, n_axis);
+        auto map = config->_heightMap;
+        if (map && map->active()) {
+            cartesian[Z_AXIS] -= map->offset(cartesian[X_AXIS], cartesian[Y_AXIS]);
+        }
     }
 
     bool Kinematics::canHome(AxisMask axisMask) {
@@ -56,9 +120,22 @@ namespace Kinematics {
 
     bool Kinematics::transform_cartesian_to_motors(float* motors, float* cartesian) {
         Assert(_system != nullptr, "No kinematics system.");
+        auto map = config->_heightMap;
+        if (map && map->active()) {
+            float compensated[MAX_N_AXIS];
+            copyAxes(compensated, cartesian);
+            compensated[Z_AXIS] += map->offset(cartesian[X_AXIS], cartesian[Y_AXIS]);
+            return _system->transform_cartesian_to_motors(motors, compensated);
+        }
         return _system->transform_cartesian_to_motors(motors, cartesian);
     }
 
+    bool Kinematics::isCartesian() {
+        Assert(_system != nullptr, "No kinematics system.");
+        auto map = config->_heightMap;
+        return _system->isCartesian() && !(map && map->active());
+    }
+
     void Kinematics::group(Configuration::HandlerBase& handler) {
         ::Kinematics::KinematicsFactory::factory(handler, _system);
     }
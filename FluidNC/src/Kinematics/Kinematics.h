@@ -40,6 +40,10 @@ namespace Kinematics {
         void motors_to_cartesian(float* cartesian, float* motors, int n_axis);
         bool transform_cartesian_to_motors(float* motors, float* cartesian);
 
+        // True if the motor positions are the machine positions, with no height map either,
+        // so step counts and motor space moves stand for cartesian ones
+        bool isCartesian();
+
         void constrain_jog(float* target, plan_line_data_t* pl_data, float* position);
         bool invalid_line(float* target);
         bool invalid_arc(
@@ -81,6 +85,8 @@ namespace Kinematics {
 
         virtual bool transform_cartesian_to_motors(float* motors, float* cartesian) = 0;
 
+        virtual bool isCartesian() { return false; }
+
         virtual bool canHome(AxisMask axisMask) { return false; }
         virtual void releaseMotors(AxisMask axisMask, MotorMask motors) {}
         virtual bool limitReached(AxisMask& axisMask, MotorMask& motors, MotorMask limited) { return false; }
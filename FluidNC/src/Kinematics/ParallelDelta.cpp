@@ -6,7 +6,9 @@
 
 #include "../Protocol.h"  // protocol_execute_realtime
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
 /*
   ==================== How it Works ====================================
@@ -51,13 +53,14 @@ kinematics:
 namespace Kinematics {
 
     // trigonometric constants to speed up calculations
-    const float sqrt3  = 1.732050807;
-    const float dtr    = M_PI / (float)180.0;  // degrees to radians
-    const float sin120 = sqrt3 / 2.0;
-    const float cos120 = -0.5;
+    // These are all float so that the math stays in single precision, which the FPU does
+    const float sqrt3  = 1.732050807f;
+    const float dtr    = float(M_PI) / 180.0f;  // degrees to radians
+    const float sin120 = sqrt3 / 2.0f;
+    const float cos120 = -0.5f;
     const float tan60  = sqrt3;
-    const float sin30  = 0.5;
-    const float tan30  = 1.0 / sqrt3;
+    const float sin30  = 0.5f;
+    const float tan30  = 1.0f / sqrt3;
 
     // the geometry of the delta
     float rf;  // radius of the fixed side (length of motor cranks)
@@ -66,7 +69,10 @@ namespace Kinematics {
     float e;   // size of end effector side triangle
 
     static float last_angle[MAX_N_AXIS]     = { 0.0 };  // A place to save the previous motor angles for distance/feed rate calcs
-    static float last_cartesian[MAX_N_AXIS] = { 0.0 };  // A place to save the previous motor angles for distance/feed rate calcs
+    static float last_cos[3]                = { 0.0 };  // Cosines and sines of last_angle, for the adaptive segment check
+    static float last_sin[3]                = { 0.0 };
+    static float last_cartesian[MAX_N_AXIS] = { 0.0 };  // The cartesian position of last_angle, so its inverse kinematics can be reused
+    static bool  last_valid                 = false;
 
     void ParallelDelta::group(Configuration::HandlerBase& handler) {
         handler.item("crank_mm", rf, 50.0, 500.0);
@@ -74,16 +80,36 @@ namespace Kinematics {
         handler.item("linkage_mm", re, 20.0, 500.0);
         handler.item("end_effector_triangle_mm", e, 20.0, 500.0);
         handler.item("kinematic_segment_len_mm", _kinematic_segment_len_mm, 0.05, 20.0);  //
+        handler.item("kinematic_tolerance_mm", _kinematic_tolerance_mm, 0.0, 1.0);
+        handler.item("min_segment_len_mm", _min_segment_len_mm, 0.01, 20.0);
+        handler.item("max_segment_len_mm", _max_segment_len_mm, 0.05, 100.0);
         handler.item("homing_mpos_radians", _homing_mpos);
         handler.item("soft_limits", _softLimits);
         handler.item("max_z_mm", _max_z, -10000.0, 0.0);  //
         handler.item("use_servos", _use_servos);
     }
 
+    // The parts of the kinematics that depend only on the geometry
+    void ParallelDelta::precompute() {
+        _y1       = -0.5f * tan30 * f;  // f/2 * tg 30
+        _e_shift  = 0.5f * tan30 * e;
+        _rf2      = rf * rf;
+        _inv_rf   = 1.0f / rf;
+        _ik_const = _e_shift * _e_shift + _rf2 - re * re - _y1 * _y1;
+        _fk_t     = (f - e) * tan30 / 2.0f;
+
+        if (_min_segment_len_mm > _max_segment_len_mm) {
+            _min_segment_len_mm = _max_segment_len_mm;
+        }
+    }
+
     void ParallelDelta::init() {
         // print a startup message to show the kinematics are enabled. Print the offset for reference
         log_info("Kinematic system:" << name() << " soft_limits:" << _softLimits);
 
+        precompute();
+        last_valid = false;
+
         auto axes   = config->_axes;
         auto n_axis = Axes::_numberAxis;
 
@@ -151,15 +177,22 @@ namespace Kinematics {
     }
 
     bool ParallelDelta::cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* position) {
-        float dx, dy, dz;  // distances in each cartesian axis
         float motor_angles[3];
+        float motor_cos[3];
+        float motor_sin[3];
 
+        float seg_start[3];                     // The start of the current segment
         float seg_target[3];                    // The target of the current segment
         float feed_rate  = pl_data->feed_rate;  // save original feed rate
         bool  show_error = true;                // shows error once
 
         bool calc_ok = true;
 
+        // A move usually starts where the previous one ended, whose angles are still in last_angle.
+        // Until this move is complete, they are only valid for the segment that was last planned.
+        bool reuse = last_valid && memcmp(position, last_cartesian, 3 * sizeof(float)) == 0;
+        last_valid = false;
+
         if (target[Z_AXIS] > _max_z) {
             log_debug("Kinematics error. Target:" << target[Z_AXIS] << " exceeds max_z:" << _max_z);
             return false;
@@ -167,14 +200,17 @@ namespace Kinematics {
 
         //log_debug("Target (" << target[0] << "," << target[1] << "," << target[2]);
 
-        calc_ok = transform_cartesian_to_motors(last_angle, position);
-        if (!calc_ok) {
-            log_warn("Kinematics error. Start position error (" << position[0] << "," << position[1] << "," << position[2] << ")");
-            return false;
+        if (!reuse) {
+            calc_ok = inverse_kinematics(position, last_cos, last_sin);
+            if (!calc_ok) {
+                log_warn("Kinematics error. Start position error (" << position[0] << "," << position[1] << "," << position[2] << ")");
+                return false;
+            }
+            crank_angles(last_angle, last_cos, last_sin);
         }
 
         // Check the destination to see if it is in work area
-        calc_ok = transform_cartesian_to_motors(motor_angles, target);
+        calc_ok = inverse_kinematics(target, motor_cos, motor_sin);
         if (!calc_ok) {
             log_warn("Kinematics error. Target unreachable (" << target[0] << "," << target[1] << "," << target[2] << ")");
             return false;
@@ -185,43 +221,73 @@ namespace Kinematics {
         position[Z_AXIS] += gc_state.coord_offset[Z_AXIS];
 
         // calculate cartesian move distance for each axis
-        dx         = target[X_AXIS] - position[X_AXIS];
-        dy         = target[Y_AXIS] - position[Y_AXIS];
-        dz         = target[Z_AXIS] - position[Z_AXIS];
-        float dist = sqrt((dx * dx) + (dy * dy) + (dz * dz));
-
-        // determine the number of segments we need	... round up so there is at least 1 (except when dist is 0)
-        uint32_t segment_count = ceil(dist / _kinematic_segment_len_mm);
-
-        float segment_dist = dist / ((float)segment_count);  // distance of each segment...will be used for feedrate conversion
-
-        for (uint32_t segment = 1; segment <= segment_count; segment++) {
+        float delta[3];
+        for (int axis = 0; axis < 3; axis++) {
+            delta[axis]     = target[axis] - position[axis];
+            seg_start[axis] = position[axis];
+        }
+        float dist = sqrtf((delta[0] * delta[0]) + (delta[1] * delta[1]) + (delta[2] * delta[2]));
+        if (dist == 0.0f) {
+            return true;
+        }
+        float inv_dist = 1.0f / dist;
+
+        // Fixed length segments, rounded so there is a whole number of them, unless
+        // kinematic_tolerance_mm is set.  Then the length adapts, from min_segment_len_mm
+        // to max_segment_len_mm, to how far a straight line in motor space strays from
+        // the cartesian line, which is small near the center of the workspace and grows
+        // toward its edges.
+        bool  adaptive = _kinematic_tolerance_mm > 0.0f;
+        float seg_len  = adaptive ? _max_segment_len_mm : dist / ceilf(dist / _kinematic_segment_len_mm);
+        float done     = 0.0f;  // Distance along the move to the start of the segment
+
+        while (done < dist) {
             if (sys.abort) {
                 return true;
             }
-            //log_debug("Segment:" << segment << " of " << segment_count);
-            // determine this segment's target
-            seg_target[X_AXIS] = position[X_AXIS] + (dx / float(segment_count) * segment);
-            seg_target[Y_AXIS] = position[Y_AXIS] + (dy / float(segment_count) * segment);
-            seg_target[Z_AXIS] = position[Z_AXIS] + (dz / float(segment_count) * segment);
+            float len = seg_len;
+            if (dist - done - len < 0.001f) {
+                // Last segment, which ends exactly at the target
+                len = dist - done;
+                for (int axis = 0; axis < 3; axis++) {
+                    seg_target[axis] = target[axis];
+                }
+            } else {
+                float fraction = (done + len) * inv_dist;
+                for (int axis = 0; axis < 3; axis++) {
+                    seg_target[axis] = position[axis] + delta[axis] * fraction;
+                }
+            }
 
             //log_debug("Segment target (" << seg_target[0] << "," << seg_target[1] << "," << seg_target[2] << ")");
 
             // calculate the delta motor angles
-            bool calc_ok = transform_cartesian_to_motors(motor_angles, seg_target);
+            bool calc_ok = inverse_kinematics(seg_target, motor_cos, motor_sin);
 
             if (!calc_ok) {
                 if (show_error) {
-                    log_error("Kinematic error motors (" << motor_angles[0] << "," << motor_angles[1] << "," << motor_angles[2] << ")");
+                    log_error("Kinematic error segment (" << seg_target[0] << "," << seg_target[1] << "," << seg_target[2] << ")");
                     show_error = false;
                 }
                 return false;
             }
+
+            if (adaptive) {
+                // The deviation grows with the square of the segment length
+                float error = segment_error(last_cos, last_sin, motor_cos, motor_sin, seg_start, seg_target);
+                float scale = error > 0.0f ? 0.9f * sqrtf(_kinematic_tolerance_mm / error) : 2.0f;
+                seg_len     = std::clamp(len * std::min(scale, 2.0f), _min_segment_len_mm, _max_segment_len_mm);
+                if (error > _kinematic_tolerance_mm && len > _min_segment_len_mm) {
+                    continue;  // Retry with the shorter length
+                }
+            }
+            crank_angles(motor_angles, motor_cos, motor_sin);
+
             if (pl_data->motion.rapidMotion) {
                 pl_data->feed_rate = feed_rate;
             } else {
                 float delta_distance = three_axis_dist(motor_angles, last_angle);
-                pl_data->feed_rate   = (feed_rate * delta_distance / segment_dist);
+                pl_data->feed_rate   = (feed_rate * delta_distance / len);
             }
 
             // mc_line() returns false if a jog is cancelled.
@@ -234,26 +300,74 @@ namespace Kinematics {
             // This is after mc_line() so that we do not update
             // last_angle if the segment was discarded.
             memcpy(last_angle, motor_angles, sizeof(motor_angles));
+            memcpy(last_cos, motor_cos, sizeof(motor_cos));
+            memcpy(last_sin, motor_sin, sizeof(motor_sin));
+            memcpy(seg_start, seg_target, sizeof(seg_target));
+            done += len;
         }
+        memcpy(last_cartesian, target, 3 * sizeof(float));
+        last_valid = true;
         return true;
     }
 
+    // Distance between the middle of the cartesian segment and where the
+    // machine actually is when the motors are halfway between their angles.
+    // The crank directions halfway between are the normalized sums of the
+    // directions at the ends, so no trig is needed.
+    float ParallelDelta::segment_error(
+        const float* start_cos, const float* start_sin, const float* end_cos, const float* end_sin, const float* start, const float* end) {
+        float mid_cos[3];
+        float mid_sin[3];
+        float mid[3];
+        for (int axis = 0; axis < 3; axis++) {
+            float c = start_cos[axis] + end_cos[axis];
+            float s = start_sin[axis] + end_sin[axis];
+            float n = c * c + s * s;
+            if (n == 0.0f) {
+                return 1e10f;  // Half a turn apart
+            }
+            n             = 1.0f / sqrtf(n);
+            mid_cos[axis] = c * n;
+            mid_sin[axis] = s * n;
+        }
+        if (!forward_kinematics(mid, mid_cos, mid_sin)) {
+            return 1e10f;
+        }
+        float dx = mid[0] - 0.5f * (start[0] + end[0]);
+        float dy = mid[1] - 0.5f * (start[1] + end[1]);
+        float dz = mid[2] - 0.5f * (start[2] + end[2]);
+        return sqrtf(dx * dx + dy * dy + dz * dz);
+    }
+
     void ParallelDelta::motors_to_cartesian(float* cartesian, float* motors, int n_axis) {
         //log_debug("motors_to_cartesian motors: (" << motors[0] << "," << motors[1] << "," << motors[2] << ")");
         //log_info("motors_to_cartesian rf:" << rf << " re:" << re << " f:" << f << " e:" << e);
 
-        float t = (f - e) * tan30 / 2;
+        float cos_t[3];
+        float sin_t[3];
+        for (int axis = 0; axis < 3; axis++) {
+            cos_t[axis] = cosf(motors[axis]);
+            sin_t[axis] = sinf(motors[axis]);
+        }
+        if (!forward_kinematics(cartesian, cos_t, sin_t)) {
+            log_warn("Forward Kinematics Error");
+        }
+    }
+
+    // The crank angles enter only through their cosines and sines
+    bool ParallelDelta::forward_kinematics(float* cartesian, const float* cos_t, const float* sin_t) {
+        float t = _fk_t;
 
-        float y1 = -(t + rf * cos(motors[0]));
-        float z1 = -rf * sin(motors[0]);
+        float y1 = -(t + rf * cos_t[0]);
+        float z1 = -rf * sin_t[0];
 
-        float y2 = (t + rf * cos(motors[1])) * sin30;
+        float y2 = (t + rf * cos_t[1]) * sin30;
         float x2 = y2 * tan60;
-        float z2 = -rf * sin(motors[1]);
+        float z2 = -rf * sin_t[1];
 
-        float y3 = (t + rf * cos(motors[2])) * sin30;
+        float y3 = (t + rf * cos_t[2]) * sin30;
         float x3 = -y3 * tan60;
-        float z3 = -rf * sin(motors[2]);
+        float z3 = -rf * sin_t[2];
 
         float dnm = (y2 - y1) * x3 - (y3 - y1) * x2;
 
@@ -263,11 +377,11 @@ namespace Kinematics {
 
         // x = (a1*z + b1)/dnm
         float a1 = (z2 - z1) * (y3 - y1) - (z3 - z1) * (y2 - y1);
-        float b1 = -((w2 - w1) * (y3 - y1) - (w3 - w1) * (y2 - y1)) / 2.0;
+        float b1 = -((w2 - w1) * (y3 - y1) - (w3 - w1) * (y2 - y1)) / 2.0f;
 
         // y = (a2*z + b2)/dnm;
         float a2 = -(z2 - z1) * x3 + (z3 - z1) * x2;
-        float b2 = ((w2 - w1) * x3 - (w3 - w1) * x2) / 2.0;
+        float b2 = ((w2 - w1) * x3 - (w3 - w1) * x2) / 2.0f;
 
         // a*z^2 + b*z + c = 0
         float a = a1 * a1 + a2 * a2 + dnm * dnm;
@@ -275,14 +389,14 @@ namespace Kinematics {
         float c = (b2 - y1 * dnm) * (b2 - y1 * dnm) + b1 * b1 + dnm * dnm * (z1 * z1 - re * re);
 
         // discriminant
-        float d = b * b - (float)4.0 * a * c;
+        float d = b * b - 4.0f * a * c;
         if (d < 0) {
-            log_warn("Forward Kinematics Error");
-            return;
+            return false;
         }
-        cartesian[Z_AXIS] = -(float)0.5 * (b + sqrt(d)) / a;
+        cartesian[Z_AXIS] = -0.5f * (b + sqrtf(d)) / a;
         cartesian[X_AXIS] = (a1 * cartesian[Z_AXIS] + b1) / dnm;
         cartesian[Y_AXIS] = (a2 * cartesian[Z_AXIS] + b2) / dnm;
+        return true;
     }
 
     bool ParallelDelta::kinematics_homing(AxisMask& axisMask) {
@@ -305,62 +419,80 @@ namespace Kinematics {
         return true;  // signal main code that this handled all homing
     }
 
-    // helper functions, calculates angle theta1 (for YZ-pane)
-    bool ParallelDelta::delta_calcAngleYZ(float x0, float y0, float z0, float& theta) {
-        float y1 = -0.5 * 0.57735 * f;  // f/2 * tg 30
-        y0 -= 0.5 * 0.57735 * e;        // shift center to edge
-        // z = a + b*y
-        float a = (x0 * x0 + y0 * y0 + z0 * z0 + rf * rf - re * re - y1 * y1) / (2 * z0);
-        float b = (y1 - y0) / z0;
+    // helper functions, calculates the cosine and sine of angle theta1 (for YZ-pane)
+    // y0 is the Y coordinate rotated into the plane of the arm.  X only enters the
+    // math as x0^2 + y0^2, which is the same for every arm, so the caller passes the
+    // squared distance from the origin r2, and 1/z, which are shared by all three arms.
+    bool ParallelDelta::delta_calcAngleYZ(float y0, float r2, float inv_z, float& cos_t, float& sin_t) {
+        // z = a + b*y, where x0^2 + (y0 - e_shift)^2 + z0^2 = r2 - 2 * e_shift * y0 + e_shift^2
+        float a = 0.5f * (r2 - 2.0f * _e_shift * y0 + _ik_const) * inv_z;
+        float b = (_y1 - y0 + _e_shift) * inv_z;
         // discriminant
-        float d = -(a + b * y1) * (a + b * y1) + rf * (b * b * rf + rf);
+        float ab  = a + b * _y1;
+        float bb1 = b * b + 1.0f;
+        float d   = _rf2 * bb1 - ab * ab;
         if (d < 0) {
             //log_warn("Kinematics: Target unreachable");
             return false;
-        }                                                 // non-existing point
-        float yj = (y1 - a * b - sqrt(d)) / (b * b + 1);  // choosing outer point
+        }                                            // non-existing point
+        float yj = (_y1 - a * b - sqrtf(d)) / bb1;  // choosing outer point
         float zj = a + b * yj;
 
-        theta = atan(-zj / (y1 - yj)) + ((yj > y1) ? M_PI : 0.0);
-
+        // The crank runs from its axis at y1 to the elbow at (yj, zj)
+        cos_t = (_y1 - yj) * _inv_rf;
+        sin_t = -zj * _inv_rf;
         return true;
     }
 
+    // The angles are left until they are needed because atan2f is slow
+    void ParallelDelta::crank_angles(float* motors, const float* cos_t, const float* sin_t) {
+        for (int axis = 0; axis < 3; axis++) {
+            float theta = atan2f(sin_t[axis], cos_t[axis]);
+            if (cos_t[axis] < 0.0f && theta < 0.0f) {
+                theta += 2.0f * float(M_PI);  // Keep the range of the former atan(-zj / (y1 - yj)) + pi
+            }
+            motors[axis] = theta;
+        }
+    }
+
     void ParallelDelta::releaseMotors(AxisMask axisMask, MotorMask motors) {}
 
     bool ParallelDelta::transform_cartesian_to_motors(float* motors, float* cartesian) {
         motors[0] = motors[1] = motors[2] = 0;
-        bool calc_ok                      = false;
 
-        if (cartesian[Z_AXIS] > _max_z) {
-            log_debug("Kinematics transform error. Target:" << cartesian[Z_AXIS] << " exceeds max_z:" << _max_z);
+        float cos_t[3];
+        float sin_t[3];
+        if (!inverse_kinematics(cartesian, cos_t, sin_t)) {
             return false;
         }
+        crank_angles(motors, cos_t, sin_t);
+        return true;
+    }
 
-        calc_ok = delta_calcAngleYZ(cartesian[X_AXIS], cartesian[Y_AXIS], cartesian[Z_AXIS], motors[0]);
-        if (!calc_ok) {
-            return calc_ok;
-        }
+    bool ParallelDelta::inverse_kinematics(const float* cartesian, float* cos_t, float* sin_t) {
+        float x = cartesian[X_AXIS];
+        float y = cartesian[Y_AXIS];
+        float z = cartesian[Z_AXIS];
 
-        calc_ok = delta_calcAngleYZ(cartesian[X_AXIS] * cos120 + cartesian[Y_AXIS] * sin120,
-                                    cartesian[Y_AXIS] * cos120 - cartesian[X_AXIS] * sin120,
-                                    cartesian[Z_AXIS],
-                                    motors[1]);  // rotate coords to +120 deg
-        if (!calc_ok) {
-            return calc_ok;
+        if (z > _max_z) {
+            log_debug("Kinematics transform error. Target:" << z << " exceeds max_z:" << _max_z);
+            return false;
+        }
+        if (z == 0.0f) {
+            return false;  // In the plane of the crank axes
         }
 
-        calc_ok = delta_calcAngleYZ(cartesian[X_AXIS] * cos120 - cartesian[Y_AXIS] * sin120,
-                                    cartesian[Y_AXIS] * cos120 + cartesian[X_AXIS] * sin120,
-                                    cartesian[Z_AXIS],
-                                    motors[2]);  // rotate coords to -120 deg
+        float r2    = x * x + y * y + z * z;
+        float inv_z = 1.0f / z;
 
-        return calc_ok;
+        return delta_calcAngleYZ(y, r2, inv_z, cos_t[0], sin_t[0]) &&                        // arm 0
+               delta_calcAngleYZ(y * cos120 - x * sin120, r2, inv_z, cos_t[1], sin_t[1]) &&  // rotate coords to +120 deg
+               delta_calcAngleYZ(y * cos120 + x * sin120, r2, inv_z, cos_t[2], sin_t[2]);    // rotate coords to -120 deg
     }
 
     // Determine the unit distance between (2) 3D points
     float ParallelDelta::three_axis_dist(float* point1, float* point2) {
-        return sqrt(((point1[0] - point2[0]) * (point1[0] - point2[0])) + ((point1[1] - point2[1]) * (point1[1] - point2[1])) +
+        return sqrtf(((point1[0] - point2[0]) * (point1[0] - point2[0])) + ((point1[1] - point2[1]) * (point1[1] - point2[1])) +
                     ((point1[2] - point2[2]) * (point1[2] - point2[2])));
     }
 
@@ -37,6 +37,7 @@ namespace Kinematics {
         bool cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* position) override;
         void motors_to_cartesian(float* cartesian, float* motors, int n_axis) override;
         bool transform_cartesian_to_motors(float* motors, float* cartesian) override;
+        bool isCartesian() override { return false; }
         //bool soft_limit_error_exists(float* cartesian) override;
         bool         kinematics_homing(AxisMask& axisMask) override;
         virtual void constrain_jog(float* cartesian, plan_line_data_t* pl_data, float* position) override;
@@ -54,7 +55,7 @@ namespace Kinematics {
         // Configuration handlers:
         //void         validate() const override {}
         virtual void group(Configuration::HandlerBase& handler) override;
-        void         afterParse() override {}
+        void         afterParse() override { precompute(); }
 
         ~ParallelDelta() {}
 
@@ -66,13 +67,30 @@ namespace Kinematics {
         float re = 133.50;
         float e  = 86.603;
 
-        float _kinematic_segment_len_mm = 1.0;  // the maximun segment length the move is broken into
+        float _kinematic_segment_len_mm = 1.0;   // the maximun segment length the move is broken into
+        float _kinematic_tolerance_mm   = 0.0;   // if not 0, segment lengths adapt to keep the path within this
+        float _min_segment_len_mm       = 0.1;   // the shortest adaptive segment
+        float _max_segment_len_mm       = 10.0;  // the longest adaptive segment
         bool  _softLimits               = false;
         float _homing_mpos              = 0.0;
         float _max_z                    = 0.0;
         bool  _use_servos               = true;  // servo use a special homing
 
-        bool  delta_calcAngleYZ(float x0, float y0, float z0, float& theta);
+        // Constants derived from the geometry, computed by init()
+        float _y1;        // Y of the crank axes
+        float _e_shift;   // Y offset from the effector center to its joints
+        float _ik_const;  // Terms of the inverse kinematics that do not depend on the position
+        float _rf2;       // rf squared
+        float _inv_rf;    // 1 / rf
+        float _fk_t;      // Forward kinematics offset of the crank axes from the center
+
+        void  precompute();
+        bool  delta_calcAngleYZ(float y0, float r2, float inv_z, float& cos_t, float& sin_t);
+        bool  inverse_kinematics(const float* cartesian, float* cos_t, float* sin_t);
+        void  crank_angles(float* motors, const float* cos_t, const float* sin_t);
+        bool  forward_kinematics(float* cartesian, const float* cos_t, const float* sin_t);
+        float segment_error(
+            const float* start_cos, const float* start_sin, const float* end_cos, const float* end_sin, const float* start, const float* end);
         float three_axis_dist(float* point1, float* point2);
 
     protected:
@@ -0,0 +1,218 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "Scara.h"
+
+#include "src/Machine/MachineConfig.h"
+#include "src/Limits.h"
+
+#include <cmath>
+
+namespace Kinematics {
+    static const float rad_per_deg = 0.0174532925f;
+    static const float deg_per_rad = 57.2957795f;
+
+    void Scara::group(Configuration::HandlerBase& handler) {
+        handler.item("upper_arm_mm", _upper_arm_mm, 1.0, 10000.0);
+        handler.item("forearm_mm", _forearm_mm, 1.0, 10000.0);
+        handler.item("right_handed", _right_handed);
+        handler.item("segment_len_mm", _segment_len_mm, 0.05, 100.0);
+    }
+
+    void Scara::afterParse() {
+        _geometry.set(_upper_arm_mm, _forearm_mm, _right_handed);
+    }
+
+    void Scara::init() {
+        log_info("Kinematic system: " << name() << " upper arm:" << _upper_arm_mm << " forearm:" << _forearm_mm
+                                      << (_right_handed ? " right" : " left") << " handed");
+        _geometry.set(_upper_arm_mm, _forearm_mm, _right_handed);
+        init_position();
+    }
+
+    // The joint angles that put the tool at cartesian, chosen to be closest to
+    // the last ones so the shoulder does not wrap around
+    bool Scara::transform_cartesian_to_motors(float* motors, float* cartesian) {
+        auto n_axis = Axes::_numberAxis;
+        for (size_t axis = Z_AXIS; axis < n_axis; axis++) {
+            motors[axis] = cartesian[axis];
+        }
+
+        float shoulder, elbow;
+        if (!_geometry.inverse(cartesian[X_AXIS], cartesian[Y_AXIS], shoulder, elbow)) {
+            return false;
+        }
+        motors[X_AXIS] = ScaraGeometry::unwrap(shoulder, _last_shoulder * rad_per_deg) * deg_per_rad;
+        motors[Y_AXIS] = elbow * deg_per_rad;
+        return true;
+    }
+
+    void Scara::motors_to_cartesian(float* cartesian, float* motors, int n_axis) {
+        _geometry.forward(motors[X_AXIS] * rad_per_deg, motors[Y_AXIS] * rad_per_deg, cartesian[X_AXIS], cartesian[Y_AXIS]);
+        for (size_t axis = Z_AXIS; axis < n_axis; axis++) {
+            cartesian[axis] = motors[axis];
+        }
+    }
+
+    bool Scara::joints_in_limits(float* motors) {
+        auto axes = config->_axes;
+        for (size_t axis = X_AXIS; axis <= Y_AXIS; axis++) {
+            if (axes->_axis[axis]->_softLimits && (motors[axis] < limitsMinPosition(axis) || motors[axis] > limitsMaxPosition(axis))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Scara::invalid_line(float* cartesian) {
+        float motors[MAX_N_AXIS];
+        if (!transform_cartesian_to_motors(motors, cartesian)) {
+            log_warn("Kinematics: target out of reach");
+            limit_error();
+            return true;
+        }
+        if (!joints_in_limits(motors)) {
+            limit_error();
+            return true;
+        }
+
+        // The remaining axes are cartesian
+        auto axes   = config->_axes;
+        auto n_axis = Axes::_numberAxis;
+        for (size_t axis = Z_AXIS; axis < n_axis; axis++) {
+            float coordinate = cartesian[axis];
+            if (axes->_axis[axis]->_softLimits && (coordinate < limitsMinPosition(axis) || coordinate > limitsMaxPosition(axis))) {
+                limit_error(axis, coordinate);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // The segments of the arc are checked as they are converted
+    bool Scara::invalid_arc(
+        float* target, plan_line_data_t* pl_data, float* position, float center[3], float radius, size_t caxes[3], bool is_clockwise_arc) {
+        return false;
+    }
+
+    // A jog is rejected as a whole, before any of it is queued, if a joint would pass a limit along it
+    void Scara::constrain_jog(float* target, plan_line_data_t* pl_data, float* position) {
+        if (!path_in_limits(position, target)) {
+            log_warn("Kinematics soft limit jog rejection");
+            copyAxes(target, position);
+        }
+    }
+
+    // If the move does not start where the last one ended, the position was
+    // set from the motors while they were stopped, so they have the angle
+    void Scara::sync_shoulder(float* position) {
+        if (!_last_valid || position[X_AXIS] != _last_xy[X_AXIS] || position[Y_AXIS] != _last_xy[Y_AXIS]) {
+            _last_shoulder = steps_to_mpos(get_motor_steps()[X_AXIS], X_AXIS);
+        }
+    }
+
+    uint32_t Scara::segment_count(float* position, float* target) {
+        return std::max(uint32_t(ceilf(vector_distance(position, target, 2) / _segment_len_mm)), uint32_t(1));
+    }
+
+    void Scara::segment_end(float* end, float* position, float* target, uint32_t segment, uint32_t count) {
+        if (segment == count) {
+            copyAxes(end, target);
+            return;
+        }
+        float fraction = float(segment) / count;
+        for (size_t axis = X_AXIS; axis < Axes::_numberAxis; axis++) {
+            end[axis] = position[axis] + (target[axis] - position[axis]) * fraction;
+        }
+    }
+
+    // Whether the line is in reach and the joints are within their soft limits at the end of every segment
+    bool Scara::path_in_limits(float* position, float* target) {
+        sync_shoulder(position);
+        float    saved_shoulder = _last_shoulder;
+        float    motors[MAX_N_AXIS];
+        float    end[MAX_N_AXIS];
+        uint32_t count     = segment_count(position, target);
+        bool     in_limits = true;
+        for (uint32_t segment = 1; in_limits && segment <= count; segment++) {
+            segment_end(end, position, target, segment, count);
+            in_limits      = transform_cartesian_to_motors(motors, end) && joints_in_limits(motors);
+            _last_shoulder = motors[X_AXIS];
+        }
+        _last_shoulder = saved_shoulder;
+        return in_limits;
+    }
+
+    /*
+      Lines are split into segments of segment_len_mm.  Within a segment the
+      joints move linearly, so the tool follows a slight curve.  The feed rate
+      of each segment is scaled by the ratio of its length in joint space to
+      its length in cartesian space, so the tool moves at the programmed rate.
+    */
+    bool Scara::cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* position) {
+        auto n_axis = Axes::_numberAxis;
+
+        float last_motors[MAX_N_AXIS];
+        float motors[MAX_N_AXIS];
+        float end[MAX_N_AXIS];
+
+        sync_shoulder(position);
+
+        if (!transform_cartesian_to_motors(last_motors, position)) {
+            log_warn("Kinematics error. Start position out of reach (" << position[X_AXIS] << "," << position[Y_AXIS] << ")");
+            return false;
+        }
+
+        float feed_rate = pl_data->feed_rate;
+        float dist      = vector_distance(position, target, n_axis);
+
+        uint32_t count        = segment_count(position, target);
+        float    segment_dist = dist / count;
+
+        for (uint32_t segment = 1; segment <= count; segment++) {
+            if (sys.abort) {
+                return true;
+            }
+            segment_end(end, position, target, segment, count);
+
+            if (!transform_cartesian_to_motors(motors, end)) {
+                log_warn("Kinematics error. Target out of reach (" << end[X_AXIS] << "," << end[Y_AXIS] << ")");
+                pl_data->feed_rate = feed_rate;
+                _last_valid        = false;
+                return false;
+            }
+            // The joints do not move linearly with the tool, so they can pass a limit between the ends
+            // of the line.  Jogs were checked along the line by constrain_jog().
+            if (!pl_data->motion.systemMotion && !pl_data->motion.jogMotion && !joints_in_limits(motors)) {
+                pl_data->feed_rate = feed_rate;
+                _last_valid        = false;
+                limit_error();
+                return false;
+            }
+
+            if (pl_data->motion.inverseTime) {
+                // Each segment takes its share of the time
+                pl_data->feed_rate = feed_rate * count;
+            } else if (!pl_data->motion.rapidMotion && segment_dist > 0) {
+                pl_data->feed_rate = feed_rate * vector_distance(last_motors, motors, n_axis) / segment_dist;
+            }
+
+            if (!mc_move_motors(motors, pl_data)) {
+                pl_data->feed_rate = feed_rate;
+                _last_valid        = false;
+                return false;
+            }
+            copyAxes(last_motors, motors);
+            _last_shoulder = motors[X_AXIS];
+        }
+        pl_data->feed_rate = feed_rate;
+        _last_xy[X_AXIS]   = target[X_AXIS];
+        _last_xy[Y_AXIS]   = target[Y_AXIS];
+        _last_valid        = true;
+        return true;
+    }
+
+    // Configuration registration
+    namespace {
+        KinematicsFactory::InstanceBuilder<Scara> registration("Scara");
+    }
+}
@@ -0,0 +1,73 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+	Scara.h
+
+	A two link SCARA arm.  The X motor turns the shoulder and the Y motor
+	turns the elbow, both in degrees, with the elbow angle measured from the
+	upper arm.  Axes from Z up are passed through unchanged.
+
+	Soft limits on X and Y apply to the joint angles at the end of every
+	segment of a line, and a line is invalid if it leaves the reach of the
+	arm.
+*/
+
+#include "Kinematics.h"
+#include "Cartesian.h"
+#include "ScaraGeometry.h"
+
+namespace Kinematics {
+    class Scara : public Cartesian {
+    public:
+        Scara(const char* name) : Cartesian(name) {}
+
+        Scara(const Scara&)            = delete;
+        Scara(Scara&&)                 = delete;
+        Scara& operator=(const Scara&) = delete;
+        Scara& operator=(Scara&&)      = delete;
+
+        // Kinematic Interface
+        void init() override;
+        bool cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* position) override;
+        void motors_to_cartesian(float* cartesian, float* motors, int n_axis) override;
+        bool transform_cartesian_to_motors(float* motors, float* cartesian) override;
+        bool isCartesian() override { return false; }
+        void constrain_jog(float* cartesian, plan_line_data_t* pl_data, float* position) override;
+        bool invalid_line(float* cartesian) override;
+        bool invalid_arc(float*            target,
+                         plan_line_data_t* pl_data,
+                         float*            position,
+                         float             center[3],
+                         float             radius,
+                         size_t            caxes[3],
+                         bool              is_clockwise_arc) override;
+
+        // Configuration handlers:
+        void group(Configuration::HandlerBase& handler) override;
+        void afterParse() override;
+
+        ~Scara() {}
+
+    private:
+        bool     joints_in_limits(float* motors);
+        void     sync_shoulder(float* position);
+        uint32_t segment_count(float* position, float* target);
+        void     segment_end(float* end, float* position, float* target, uint32_t segment, uint32_t count);
+        bool     path_in_limits(float* position, float* target);
+
+        ScaraGeometry _geometry;
+
+        // The shoulder angle in degrees at the end of the last move, and where that was
+        float _last_shoulder = 0;
+        float _last_xy[2]    = { 0, 0 };
+        bool  _last_valid    = false;
+
+        // Parameters
+        float _upper_arm_mm   = 200;
+        float _forearm_mm     = 200;
+        bool  _right_handed   = false;
+        float _segment_len_mm = 1.0;
+    };
+}  //  namespace Kinematics
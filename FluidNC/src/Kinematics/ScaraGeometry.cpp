@@ -0,0 +1,44 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "ScaraGeometry.h"
+
+#include <cmath>
+
+void ScaraGeometry::set(float upper_arm, float forearm, bool right_handed) {
+    _l1         = upper_arm;
+    _l2         = forearm;
+    _l_sum2     = _l1 * _l1 + _l2 * _l2;
+    _inv_2l1l2  = 0.5f / (_l1 * _l2);
+    _reach2     = (_l1 + _l2) * (_l1 + _l2);
+    _inner2     = (_l1 - _l2) * (_l1 - _l2);
+    _elbow_sign = right_handed ? -1.0f : 1.0f;
+}
+
+// Law of cosines for the elbow.  The shoulder is the direction to the tool
+// minus the angle the forearm adds, folded into a single atan2 by rotating
+// (x, y) by that angle instead of computing it.
+bool ScaraGeometry::inverse(float x, float y, float& shoulder, float& elbow) const {
+    float r2 = x * x + y * y;
+    if (r2 > _reach2 || r2 < _inner2) {
+        return false;
+    }
+    float c2 = (r2 - _l_sum2) * _inv_2l1l2;
+    float s2 = _elbow_sign * sqrtf(fmaxf(0.0f, 1.0f - c2 * c2));
+    elbow    = atan2f(s2, c2);
+
+    float k1 = _l1 + _l2 * c2;
+    float k2 = _l2 * s2;
+    shoulder = atan2f(y * k1 - x * k2, x * k1 + y * k2);
+    return true;
+}
+
+void ScaraGeometry::forward(float shoulder, float elbow, float& x, float& y) const {
+    float forearm = shoulder + elbow;
+    x             = _l1 * cosf(shoulder) + _l2 * cosf(forearm);
+    y             = _l1 * sinf(shoulder) + _l2 * sinf(forearm);
+}
+
+float ScaraGeometry::unwrap(float angle, float reference) {
+    const float two_pi = 6.28318530718f;
+    return angle + two_pi * roundf((reference - angle) / two_pi);
+}
@@ -0,0 +1,35 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  ScaraGeometry.h - closed form kinematics of a two link planar arm.
+
+  The shoulder is at the origin.  The shoulder angle is measured from +X to
+  the upper arm and the elbow angle from the upper arm to the forearm, both
+  counterclockwise and in radians.  Everything is float, so the ESP32 FPU
+  does it in hardware.
+*/
+
+class ScaraGeometry {
+    float _l1 = 1, _l2 = 1;
+
+    float _l_sum2     = 2;    // l1^2 + l2^2
+    float _inv_2l1l2  = 0.5;  // 1 / (2 * l1 * l2)
+    float _reach2     = 4;    // (l1 + l2)^2
+    float _inner2     = 0;    // (l1 - l2)^2
+    float _elbow_sign = 1;
+
+public:
+    // right_handed puts the elbow to the right of the line from the shoulder to
+    // the tool, which makes the elbow angle negative
+    void set(float upper_arm, float forearm, bool right_handed);
+
+    // Returns false if (x, y) is out of reach
+    bool inverse(float x, float y, float& shoulder, float& elbow) const;
+    void forward(float shoulder, float elbow, float& x, float& y) const;
+
+    // Adds multiples of 2*pi to angle to bring it closest to reference, so that
+    // the shoulder does not spin around when a move crosses the -X axis
+    static float unwrap(float angle, float reference);
+};
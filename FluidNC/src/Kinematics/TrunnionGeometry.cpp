@@ -0,0 +1,54 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "TrunnionGeometry.h"
+
+#include <cmath>
+
+void TrunnionGeometry::set_pivot(float x, float y, float z) {
+    _pivot[0] = x;
+    _pivot[1] = y;
+    _pivot[2] = z;
+}
+
+void TrunnionGeometry::to_machine(const float* work, float a, float c, float* machine) const {
+    float sa = sinf(a), ca = cosf(a);
+    float sc = sinf(c), cc = cosf(c);
+
+    float x = work[0] - _pivot[0];
+    float y = work[1] - _pivot[1];
+    float z = work[2] - _pivot[2];
+
+    // Rz(c)
+    float xc = x * cc - y * sc;
+    float yc = x * sc + y * cc;
+
+    // Rx(a)
+    machine[0] = _pivot[0] + xc;
+    machine[1] = _pivot[1] + yc * ca - z * sa;
+    machine[2] = _pivot[2] + yc * sa + z * ca;
+}
+
+void TrunnionGeometry::to_work(const float* machine, float a, float c, float* work) const {
+    float sa = sinf(a), ca = cosf(a);
+    float sc = sinf(c), cc = cosf(c);
+
+    float x = machine[0] - _pivot[0];
+    float y = machine[1] - _pivot[1];
+    float z = machine[2] - _pivot[2];
+
+    // Rx(-a)
+    float ya = y * ca + z * sa;
+    float za = z * ca - y * sa;
+
+    // Rz(-c)
+    work[0] = _pivot[0] + x * cc + ya * sc;
+    work[1] = _pivot[1] + ya * cc - x * sc;
+    work[2] = _pivot[2] + za;
+}
+
+float TrunnionGeometry::radius(const float* work) const {
+    float x = work[0] - _pivot[0];
+    float y = work[1] - _pivot[1];
+    float z = work[2] - _pivot[2];
+    return sqrtf(x * x + y * y + z * z);
+}
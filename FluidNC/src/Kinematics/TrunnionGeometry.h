@@ -0,0 +1,34 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  TrunnionGeometry.h - tool center point transform for a table-tilting
+  5-axis machine.
+
+  The table tilts about an A axis parallel to X and the rotary table on it
+  turns about a C axis that is parallel to Z when A is 0.  Both axes pass
+  through the pivot point.  Positive angles turn the table counterclockwise
+  when looking from the positive end of the axis toward the origin.
+
+  Work coordinates are fixed to the table, so a program can be written as
+  if the part did not move.  The machine position that puts the tool on a
+  work point is
+
+    machine = pivot + Rx(a) * Rz(c) * (work - pivot)
+*/
+
+class TrunnionGeometry {
+    float _pivot[3] = { 0, 0, 0 };
+
+public:
+    void set_pivot(float x, float y, float z);
+
+    // a and c are in radians
+    void to_machine(const float* work, float a, float c, float* machine) const;
+    void to_work(const float* machine, float a, float c, float* work) const;
+
+    // Distance from the work point to the pivot, which is the radius of the
+    // circle it moves on when the table turns
+    float radius(const float* work) const;
+};
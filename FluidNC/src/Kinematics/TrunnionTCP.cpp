@@ -0,0 +1,182 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "TrunnionTCP.h"
+
+#include "src/Machine/MachineConfig.h"
+#include "src/Limits.h"  // limitsMinPosition
+
+#include <cmath>
+
+namespace Kinematics {
+    static const float rad_per_deg = 0.0174532925f;
+
+    void TrunnionTCP::group(Configuration::HandlerBase& handler) {
+        handler.item("tilt_axis", _tilt_axis, A_AXIS, MAX_N_AXIS - 1);
+        handler.item("rotary_axis", _rotary_axis, A_AXIS, MAX_N_AXIS - 1);
+        handler.item("pivot_x_mm", _pivot_x_mm, -10000.0, 10000.0);
+        handler.item("pivot_y_mm", _pivot_y_mm, -10000.0, 10000.0);
+        handler.item("pivot_z_mm", _pivot_z_mm, -10000.0, 10000.0);
+        handler.item("kinematic_tolerance_mm", _kinematic_tolerance_mm, 0.001, 1.0);
+    }
+
+    void TrunnionTCP::afterParse() {
+        _geometry.set_pivot(_pivot_x_mm, _pivot_y_mm, _pivot_z_mm);
+    }
+
+    void TrunnionTCP::validate() {
+        Assert(_tilt_axis != _rotary_axis, "tilt_axis and rotary_axis must be different");
+    }
+
+    void TrunnionTCP::init() {
+        log_info("Kinematic system: " << name() << " pivot:" << _pivot_x_mm << "," << _pivot_y_mm << "," << _pivot_z_mm);
+        if (Axes::_numberAxis <= std::max(_tilt_axis, _rotary_axis)) {
+            log_config_error("TrunnionTCP needs the tilt and rotary axes to be configured");
+        }
+        _geometry.set_pivot(_pivot_x_mm, _pivot_y_mm, _pivot_z_mm);
+        init_position();
+    }
+
+    bool TrunnionTCP::transform_cartesian_to_motors(float* motors, float* cartesian) {
+        copyAxes(motors, cartesian);
+        _geometry.to_machine(cartesian, cartesian[_tilt_axis] * rad_per_deg, cartesian[_rotary_axis] * rad_per_deg, motors);
+        return true;
+    }
+
+    void TrunnionTCP::motors_to_cartesian(float* cartesian, float* motors, int n_axis) {
+        for (size_t axis = Z_AXIS + 1; axis < n_axis; axis++) {
+            cartesian[axis] = motors[axis];
+        }
+        if (n_axis <= std::max(_tilt_axis, _rotary_axis)) {
+            copyAxes(cartesian, motors);
+            return;
+        }
+        _geometry.to_work(motors, motors[_tilt_axis] * rad_per_deg, motors[_rotary_axis] * rad_per_deg, cartesian);
+    }
+
+    bool TrunnionTCP::invalid_line(float* cartesian) {
+        float motors[MAX_N_AXIS];
+        transform_cartesian_to_motors(motors, cartesian);
+        return Cartesian::invalid_line(motors);
+    }
+
+    // The chords of the arc are checked one at a time by cartesian_to_motors()
+    bool TrunnionTCP::invalid_arc(
+        float* target, plan_line_data_t* pl_data, float* position, float center[3], float radius, size_t caxes[3], bool is_clockwise_arc) {
+        return false;
+    }
+
+    bool TrunnionTCP::motors_in_limits(float* motors) {
+        auto axes   = config->_axes;
+        auto n_axis = Axes::_numberAxis;
+        for (size_t axis = X_AXIS; axis < n_axis; axis++) {
+            if (axes->_axis[axis]->_softLimits && (motors[axis] < limitsMinPosition(axis) || motors[axis] > limitsMaxPosition(axis))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint32_t TrunnionTCP::segment_count(float* position, float* target) {
+        float turn = fabsf(target[_tilt_axis] - position[_tilt_axis]) + fabsf(target[_rotary_axis] - position[_rotary_axis]);
+        if (turn == 0) {
+            return 1;
+        }
+        float radius    = std::max(_geometry.radius(position), _geometry.radius(target));
+        float max_angle = radius > 0 ? sqrtf(8 * _kinematic_tolerance_mm / radius) : __FLT_MAX__;
+        return std::max(uint32_t(ceilf(turn * rad_per_deg / max_angle)), uint32_t(1));
+    }
+
+    void TrunnionTCP::segment_end(float* end, float* position, float* target, uint32_t segment, uint32_t count) {
+        if (segment == count) {
+            copyAxes(end, target);
+            return;
+        }
+        float fraction = float(segment) / count;
+        auto  n_axis   = Axes::_numberAxis;
+        for (size_t axis = X_AXIS; axis < n_axis; axis++) {
+            end[axis] = position[axis] + (target[axis] - position[axis]) * fraction;
+        }
+    }
+
+    // A jog is rejected as a whole, before any of it is queued, if a motor would pass a limit
+    // along it while the table turns
+    void TrunnionTCP::constrain_jog(float* target, plan_line_data_t* pl_data, float* position) {
+        float    motors[MAX_N_AXIS];
+        float    end[MAX_N_AXIS];
+        uint32_t count = segment_count(position, target);
+        for (uint32_t segment = 1; segment <= count; segment++) {
+            segment_end(end, position, target, segment, count);
+            transform_cartesian_to_motors(motors, end);
+            if (!motors_in_limits(motors)) {
+                log_warn("Kinematics soft limit jog rejection");
+                copyAxes(target, position);
+                break;
+            }
+        }
+        pl_data->limits_checked = true;
+    }
+
+    /*
+      A move with no rotary motion is a translation in machine space too, so it
+      is sent as one line.  Otherwise the work point moves on circles around the
+      pivot, and a chord of angle d on a circle of radius r is off the arc by
+      r * d^2 / 8.  The move is split so that no segment turns the table by
+      more than the angle that keeps that within kinematic_tolerance_mm.
+      The motors do not move linearly with the work point, so each segment is
+      checked against the soft limits, which also checks each chord of an arc.
+    */
+    bool TrunnionTCP::cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* position) {
+        auto n_axis = Axes::_numberAxis;
+
+        if (n_axis <= std::max(_tilt_axis, _rotary_axis)) {
+            return mc_move_motors(target, pl_data);
+        }
+
+        // Jogs were checked along the whole move by constrain_jog()
+        bool check_limits = !pl_data->motion.systemMotion && !pl_data->motion.jogMotion;
+
+        bool     turns        = target[_tilt_axis] != position[_tilt_axis] || target[_rotary_axis] != position[_rotary_axis];
+        uint32_t count        = segment_count(position, target);
+        float    feed_rate    = pl_data->feed_rate;
+        float    segment_dist = vector_distance(position, target, n_axis) / count;
+
+        float motors[MAX_N_AXIS];
+        float last_motors[MAX_N_AXIS];
+        float end[MAX_N_AXIS];
+        transform_cartesian_to_motors(last_motors, position);
+
+        for (uint32_t segment = 1; segment <= count; segment++) {
+            if (sys.abort) {
+                return true;
+            }
+            segment_end(end, position, target, segment, count);
+            transform_cartesian_to_motors(motors, end);
+            if (check_limits && Cartesian::invalid_line(motors)) {
+                pl_data->feed_rate = feed_rate;
+                return false;
+            }
+
+            // The programmed feed rate is the speed of the tool relative to the part
+            if (turns) {
+                if (pl_data->motion.inverseTime) {
+                    pl_data->feed_rate = feed_rate * count;
+                } else if (!pl_data->motion.rapidMotion) {
+                    pl_data->feed_rate = feed_rate * vector_distance(last_motors, motors, n_axis) / segment_dist;
+                }
+            }
+
+            if (!mc_move_motors(motors, pl_data)) {
+                pl_data->feed_rate = feed_rate;
+                return false;
+            }
+            copyAxes(last_motors, motors);
+        }
+        pl_data->feed_rate = feed_rate;
+        return true;
+    }
+
+    // Configuration registration
+    namespace {
+        KinematicsFactory::InstanceBuilder<TrunnionTCP> registration("TrunnionTCP");
+    }
+}
@@ -0,0 +1,69 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+	TrunnionTCP.h
+
+	Tool center point control for a table-tilting 5-axis machine with an A
+	tilt axis and a C rotary axis on the tilting table.  X, Y and Z are
+	programmed in coordinates fixed to the table, and the linear motors move
+	so the tool stays on that point as the table turns.  See TrunnionGeometry.h
+	for the conventions.
+
+	Soft limits apply to the motor positions.
+*/
+
+#include "Kinematics.h"
+#include "Cartesian.h"
+#include "TrunnionGeometry.h"
+
+namespace Kinematics {
+    class TrunnionTCP : public Cartesian {
+    public:
+        TrunnionTCP(const char* name) : Cartesian(name) {}
+
+        TrunnionTCP(const TrunnionTCP&)            = delete;
+        TrunnionTCP(TrunnionTCP&&)                 = delete;
+        TrunnionTCP& operator=(const TrunnionTCP&) = delete;
+        TrunnionTCP& operator=(TrunnionTCP&&)      = delete;
+
+        // Kinematic Interface
+        void init() override;
+        bool cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* position) override;
+        void motors_to_cartesian(float* cartesian, float* motors, int n_axis) override;
+        bool transform_cartesian_to_motors(float* motors, float* cartesian) override;
+        bool isCartesian() override { return false; }
+        void constrain_jog(float* cartesian, plan_line_data_t* pl_data, float* position) override;
+        bool invalid_line(float* cartesian) override;
+        bool invalid_arc(float*            target,
+                         plan_line_data_t* pl_data,
+                         float*            position,
+                         float             center[3],
+                         float             radius,
+                         size_t            caxes[3],
+                         bool              is_clockwise_arc) override;
+
+        // Configuration handlers:
+        void group(Configuration::HandlerBase& handler) override;
+        void afterParse() override;
+        void validate() override;
+
+        ~TrunnionTCP() {}
+
+    private:
+        TrunnionGeometry _geometry;
+
+        bool     motors_in_limits(float* motors);
+        uint32_t segment_count(float* position, float* target);
+        void     segment_end(float* end, float* position, float* target, uint32_t segment, uint32_t count);
+
+        // Parameters
+        int   _tilt_axis              = 3;  // A
+        int   _rotary_axis            = 5;  // C
+        float _pivot_x_mm             = 0;
+        float _pivot_y_mm             = 0;
+        float _pivot_z_mm             = 0;
+        float _kinematic_tolerance_mm = 0.01;
+    };
+}  //  namespace Kinematics
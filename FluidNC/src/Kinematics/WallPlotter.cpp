@@ -2,6 +2,7 @@
 
 #include "../Machine/MachineConfig.h"
 
+#include <algorithm>
 #include <cmath>
 
 namespace Kinematics {
@@ -15,6 +16,9 @@ namespace Kinematics {
         handler.item("right_anchor_y", _right_anchor_y);
 
         handler.item("segment_length", _segment_length);
+        handler.item("kinematic_tolerance_mm", _kinematic_tolerance_mm, 0.0, 1.0);
+        handler.item("min_segment_length", _min_segment_length, 0.01, 100.0);
+        handler.item("max_segment_length", _max_segment_length, 0.01, 1000.0);
     }
 
     void WallPlotter::init() {
@@ -47,11 +51,63 @@ namespace Kinematics {
         return false;
     }
 
-    bool WallPlotter::transform_cartesian_to_motors(float* cartesian, float* motors) {
-        log_error("WallPlotter::transform_cartesian_to_motors is broken");
+    // The inverse of motors_to_cartesian()
+    bool WallPlotter::transform_cartesian_to_motors(float* motors, float* cartesian) {
+        auto n_axis = Axes::_numberAxis;
+        for (size_t axis = Z_AXIS; axis < n_axis; axis++) {
+            motors[axis] = cartesian[axis];
+        }
+
+        float left_length, right_length;
+        xy_to_lengths(cartesian[X_AXIS], cartesian[Y_AXIS], left_length, right_length);
+
+        // Note that the left motor runs backward.
+        motors[_left_axis]  = zero_left - left_length;
+        motors[_right_axis] = right_length - zero_right;
         return true;
     }
 
+    /*
+      A straight line in motor space is a curve in cartesian space, because the
+      cable lengths are not linear in x and y.  Along a line in unit direction
+      (ux, uy), the second derivative of the length L of a cable is cross^2 / L^3,
+      where cross is the cross product of the direction and the vector from the
+      anchor.  Interpolating the length linearly over a segment of length s is off
+      by at most s^2/8 times that at the midpoint.  The curvature is low when the
+      move is along the cable and at long cable lengths, so segments can be much
+      longer in the middle of the wall than near the anchors.
+    */
+    float WallPlotter::cable_curvature(float x, float y, float ux, float uy) {
+        float curvature = 0;
+
+        const float anchors[2][2] = { { _left_anchor_x, _left_anchor_y }, { _right_anchor_x, _right_anchor_y } };
+        for (auto& anchor : anchors) {
+            float rx      = x - anchor[0];
+            float ry      = y - anchor[1];
+            float length2 = rx * rx + ry * ry;
+            if (length2 < 1e-6f) {
+                return __FLT_MAX__;  // At the anchor
+            }
+            float cross = ux * ry - uy * rx;
+            curvature   = std::max(curvature, cross * cross / (length2 * sqrtf(length2)));
+        }
+        return curvature;
+    }
+
+    // The length of the next segment from (x, y) in unit direction (ux, uy)
+    float WallPlotter::adaptive_segment_length(float x, float y, float ux, float uy) {
+        float limit     = 8 * _kinematic_tolerance_mm;
+        float curvature = cable_curvature(x, y, ux, uy);
+        float length    = curvature * _max_segment_length * _max_segment_length > limit ? sqrtf(limit / curvature) : _max_segment_length;
+
+        // The curvature changes along the segment, so take the worse of its ends
+        curvature = std::max(curvature, cable_curvature(x + ux * length, y + uy * length, ux, uy));
+        if (curvature * length * length > limit) {
+            length = sqrtf(limit / curvature);
+        }
+        return std::clamp(length, _min_segment_length, _max_segment_length);
+    }
+
     /*
       cartesian_to_motors() converts from cartesian coordinates to motor space.
 
@@ -63,7 +119,6 @@ namespace Kinematics {
         position = an n_axis array of where the machine is starting from for this move
     */
     bool WallPlotter::cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* position) {
-        float    dx, dy, dz;     // segment distances in each cartesian axis
         uint32_t segment_count;  // number of segments the move will be broken in to.
 
         auto n_axis = Axes::_numberAxis;
@@ -78,7 +133,9 @@ namespace Kinematics {
 
         // calculate the total X,Y axis move distance
         // Z axis is the same in both coord systems, so it does not undergo conversion
-        float xydist = vector_distance(target, position, 2);  // Only compute distance for both axes. X and Y
+        float xydist   = vector_distance(target, position, 2);  // Only compute distance for both axes. X and Y
+        bool  adaptive = _kinematic_tolerance_mm > 0 && xydist > 0;
+
         // Segment our G1 and G0 moves based on yaml file. If we choose a small enough _segment_length we can hide the nonlinearity
         segment_count = xydist / _segment_length;
         if (segment_count < 1) {  // Make sure there is at least one segment, even if there is no movement
@@ -86,25 +143,36 @@ namespace Kinematics {
             // the planner even if there is no movement??
             segment_count = 1;
         }
-        float cartesian_segment_length = total_cartesian_distance / segment_count;
 
-        // Calc length of each cartesian segment - the same for all segments
-        float cartesian_segment_components[n_axis];
-        for (size_t axis = X_AXIS; axis < n_axis; axis++) {
-            cartesian_segment_components[axis] = (target[axis] - position[axis]) / segment_count;
-        }
+        // Unit direction of the move in the XY plane, for adaptive segments
+        float ux = adaptive ? (target[X_AXIS] - position[X_AXIS]) / xydist : 0;
+        float uy = adaptive ? (target[Y_AXIS] - position[Y_AXIS]) / xydist : 0;
 
         float cartesian_segment_end[n_axis];
         copyAxes(cartesian_segment_end, position);
 
-        // Calculate desired cartesian feedrate distance ratio. Same for each seg.
-        for (uint32_t segment = 1; segment <= segment_count; segment++) {
+        float    fraction = 0;  // How much of the move is done
+        uint32_t segment  = 0;
+        while (fraction < 1) {
             if (sys.abort) {
                 return true;
             }
+            float next;
+            if (adaptive) {
+                float length = adaptive_segment_length(cartesian_segment_end[X_AXIS], cartesian_segment_end[Y_AXIS], ux, uy);
+                next         = fraction + length / xydist;
+                if ((1 - next) * xydist < _min_segment_length) {  // Do not leave a sliver at the end
+                    next = 1;
+                }
+            } else {
+                next = float(++segment) / segment_count;
+            }
+            float cartesian_segment_length = total_cartesian_distance * (next - fraction);
+            fraction                       = next;
+
             // calculate the cartesian end point of the next segment
             for (size_t axis = X_AXIS; axis < n_axis; axis++) {
-                cartesian_segment_end[axis] += cartesian_segment_components[axis];
+                cartesian_segment_end[axis] = fraction == 1 ? target[axis] : position[axis] + (target[axis] - position[axis]) * fraction;
             }
 
             // Convert cartesian space coords to motor space
@@ -28,7 +28,7 @@ namespace Kinematics {
         void init_position() override;
         bool cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* position) override;
         void motors_to_cartesian(float* cartesian, float* motors, int n_axis) override;
-        bool transform_cartesian_to_motors(float* cartesian, float* motors) override;
+        bool transform_cartesian_to_motors(float* motors, float* cartesian) override;
         bool kinematics_homing(AxisMask& axisMask) override;
 
         // Configuration handlers:
@@ -42,6 +42,9 @@ namespace Kinematics {
         void lengths_to_xy(float left_length, float right_length, float& x, float& y);
         void xy_to_lengths(float x, float y, float& left_length, float& right_length);
 
+        float cable_curvature(float x, float y, float ux, float uy);
+        float adaptive_segment_length(float x, float y, float ux, float uy);
+
         // State
         float zero_left;   //  The left cord offset corresponding to cartesian (0, 0).
         float zero_right;  //  The right cord offset corresponding to cartesian (0, 0).
@@ -56,5 +59,11 @@ namespace Kinematics {
         float _right_anchor_x = 100;
         float _right_anchor_y = 100;
         float _segment_length = 10;
+
+        // If not 0, segments are as long as the cable lengths allow while staying
+        // within this distance of a straight line, from min to max_segment_length.
+        float _kinematic_tolerance_mm = 0;
+        float _min_segment_length     = 0.5;
+        float _max_segment_length     = 50;
     };
 }  //  namespace Kinematics
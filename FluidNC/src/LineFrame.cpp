@@ -0,0 +1,80 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "LineFrame.h"
+
+#include <cstring>
+
+namespace LineFrame {
+    uint16_t crc16(const char* data, size_t length, uint16_t crc) {
+        while (length--) {
+            crc ^= uint16_t(uint8_t(*data++)) << 8;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+            }
+        }
+        return crc;
+    }
+
+    static bool parse_hex4(const char* s, uint16_t& value) {
+        value = 0;
+        for (int i = 0; i < 4; i++) {
+            char    c = s[i];
+            uint8_t digit;
+            if (c >= '0' && c <= '9') {
+                digit = c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                digit = c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                digit = c - 'A' + 10;
+            } else {
+                return false;
+            }
+            value = (value << 4) | digit;
+        }
+        return true;
+    }
+
+    static void put_hex4(char* s, uint16_t value) {
+        const char* digits = "0123456789ABCDEF";
+        for (int i = 3; i >= 0; i--) {
+            s[i] = digits[value & 0xf];
+            value >>= 4;
+        }
+    }
+
+    Status decode(char* line, uint16_t& seq) {
+        if (line[0] != start) {
+            // Ordinary input never starts with a control character, but a frame
+            // whose start character was damaged does
+            return uint8_t(line[0]) < ' ' ? Status::Corrupt : Status::NotFramed;
+        }
+        size_t len = strlen(line);
+        if (len < overhead) {
+            return Status::Corrupt;
+        }
+        uint16_t crc;
+        if (!parse_hex4(line + 1, seq) || !parse_hex4(line + len - 4, crc)) {
+            return Status::Corrupt;
+        }
+        size_t payload_len = len - overhead;
+        if (crc16(line + 1, 4 + payload_len) != crc) {
+            return Status::Corrupt;
+        }
+        memmove(line, line + 5, payload_len);
+        line[payload_len] = '\0';
+        return Status::Ok;
+    }
+
+    size_t encode(char* out, uint16_t seq, const char* payload) {
+        size_t payload_len = strlen(payload);
+        if (payload_len > max_payload) {
+            return 0;
+        }
+        out[0] = start;
+        put_hex4(out + 1, seq);
+        memcpy(out + 5, payload, payload_len);
+        put_hex4(out + 5 + payload_len, crc16(out + 1, 4 + payload_len));
+        out[overhead + payload_len] = '\0';
+        return overhead + payload_len;
+    }
+}
@@ -0,0 +1,65 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  LineFrame.h - sequence numbered, CRC checked input lines.
+
+  A framed line is an ordinary line of input with a header and a trailer:
+
+    <STX> SSSS payload CCCC <LF>
+
+  where SSSS is a 16-bit sequence number and CCCC is the CRC-16/CCITT of
+  SSSS and the payload, both as four uppercase or lowercase hex digits.
+  The header and trailer are plain text so that a frame is still a line
+  of input.  The channel's realtime character filter claims '?', '!', '~',
+  Ctrl-X and all bytes from 0x80 up, but from the start character to the
+  line ending only Ctrl-X is taken, so the payload reaches the CRC check
+  intact; Tracker follows the received bytes to tell which are inside a
+  frame.  Other realtime characters must be sent between frames.
+
+  Channel uses these functions when framing is enabled with
+  $Channel/Framing=ON; see Channel::ack() for the acknowledgements.
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+namespace LineFrame {
+    const char   start    = '\x02';  // STX, which never appears in GCode
+    const size_t overhead = 9;       // Start character, sequence number and CRC
+
+    // The longest payload that fits in a line of input (Channel::maxLine less the terminator)
+    const size_t max_payload = 254 - overhead;
+
+    enum class Status {
+        Ok,         // The payload has been moved to the start of the line
+        NotFramed,  // The line is ordinary input
+        Corrupt,    // A damaged start character, too short, not hex, or the CRC does not match
+    };
+
+    uint16_t crc16(const char* data, size_t length, uint16_t crc = 0xffff);
+
+    // Checks a null-terminated line and, if it is a good frame, replaces it with its payload
+    Status decode(char* line, uint16_t& seq);
+
+    // Writes the frame for payload, without the line ending, to out, which must
+    // have room for strlen(payload) + overhead + 1 characters.  Returns the length,
+    // or 0 without writing anything if the payload is longer than max_payload.
+    size_t encode(char* out, uint16_t seq, const char* payload);
+
+    // Given each received byte in turn, returns true if the byte is part of a frame
+    class Tracker {
+        bool _inFrame = false;
+
+    public:
+        bool inFrame(uint8_t ch) {
+            if (ch == uint8_t(start)) {
+                _inFrame = true;
+            } else if (ch == '\n' || ch == '\r') {
+                _inFrame = false;
+            }
+            return _inFrame;
+        }
+    };
+}
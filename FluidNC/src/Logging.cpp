@@ -15,8 +15,53 @@ bool atMsgLevel(MsgLevel level) {
     return message_level == nullptr || message_level->get() >= level;
 }
 
-LogStream::LogStream(Channel& channel, MsgLevel level) : _channel(channel), _level(level) {
-    _line = new std::string();
+// The pool size covers a full message_queue plus lines being built
+// concurrently by the tasks that produce output.
+static const int n_log_buffers = 16;
+
+static LogBuffer    log_buffers[n_log_buffers];
+static xQueueHandle log_buffer_pool = nullptr;
+
+uint32_t log_pool_misses   = 0;
+uint32_t log_sends_blocked = 0;
+
+void log_buffers_init() {
+    log_buffer_pool = xQueueCreate(n_log_buffers, sizeof(LogBuffer*));
+    for (int i = 0; i < n_log_buffers; i++) {
+        LogBuffer* buffer = &log_buffers[i];
+        xQueueSend(log_buffer_pool, &buffer, 0);
+    }
+}
+
+LogBuffer* log_buffer_get() {
+    LogBuffer* buffer;
+    if (log_buffer_pool && xQueueReceive(log_buffer_pool, &buffer, 0)) {
+        buffer->length = 0;
+        return buffer;
+    }
+    return nullptr;
+}
+
+void log_buffer_release(LogBuffer* buffer) {
+    xQueueSend(log_buffer_pool, &buffer, 0);
+}
+
+size_t log_buffers_free() {
+    return log_buffer_pool ? uxQueueMessagesWaiting(log_buffer_pool) : 0;
+}
+
+size_t log_buffers_total() {
+    return n_log_buffers;
+}
+
+LogStream::LogStream(Channel& channel, MsgLevel level) : _channel(channel), _line(nullptr), _level(level) {
+    _buffer = log_buffer_get();
+    if (!_buffer) {
+        if (log_buffer_pool) {
+            ++log_pool_misses;
+        }
+        _line = new std::string();
+    }
 }
 
 LogStream::LogStream(Channel& channel, MsgLevel level, const char* name) : LogStream(channel, level) {
@@ -27,11 +72,31 @@ LogStream::LogStream(Channel& channel, const char* name) : LogStream(channel, Ms
 LogStream::LogStream(MsgLevel level, const char* name) : LogStream(allChannels, level, name) {}
 
 size_t LogStream::write(uint8_t c) {
+    if (_buffer) {
+        // Leave room for the closing ']' and the null terminator
+        if (_buffer->length < LogBuffer::capacity - 2) {
+            _buffer->text[_buffer->length++] = (char)c;
+            return 1;
+        }
+        // The line is too long for the buffer, so move it to the heap
+        ++log_pool_misses;
+        _line = new std::string(_buffer->text, _buffer->length);
+        log_buffer_release(_buffer);
+        _buffer = nullptr;
+    }
     *_line += (char)c;
     return 1;
 }
 
 LogStream::~LogStream() {
+    if (_buffer) {
+        if (_buffer->length && _buffer->text[0] == '[') {
+            _buffer->text[_buffer->length++] = ']';
+        }
+        _buffer->text[_buffer->length] = '\0';
+        _channel.sendLine(_level, _buffer);
+        return;
+    }
     if ((*_line).length() && (*_line)[0] == '[') {
         *_line += ']';
     }
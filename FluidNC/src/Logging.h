@@ -20,11 +20,37 @@ enum MsgLevel {
     MsgLevelVerbose = 5,
 };
 
+// Preallocated line buffer for log and report messages.  LogStream builds its
+// line in one of these, taken from a fixed pool, so that steady-state output
+// does no heap allocation.  A line that is too long for the buffer, or that
+// finds the pool empty, falls back to a heap-allocated std::string.
+struct LogBuffer {
+    static constexpr size_t capacity = 256;
+
+    size_t length;
+    char   text[capacity];
+};
+
+void       log_buffers_init();
+LogBuffer* log_buffer_get();  // nullptr if none are free
+void       log_buffer_release(LogBuffer* buffer);
+size_t     log_buffers_free();
+size_t     log_buffers_total();
+
+extern uint32_t log_pool_misses;    // Lines that had to be allocated from the heap
+extern uint32_t log_sends_blocked;  // Times a sender waited for room in message_queue
+
+enum class LineType : uint8_t {
+    Constant,  // const char*, not freed
+    String,    // std::string*, deleted after sending
+    Buffer,    // LogBuffer*, returned to the pool after sending
+};
+
 struct LogMessage {
     Channel* channel;
     void*    line;
     MsgLevel level;
-    bool     isString;
+    LineType type;
 };
 
 extern TaskHandle_t outputTask;
@@ -59,6 +85,7 @@ public:
 
 private:
     Channel&     _channel;
+    LogBuffer*   _buffer;
     std::string* _line;
     MsgLevel     _level;
 };
@@ -243,7 +243,7 @@ namespace Machine {
         const auto lenNames = strlen(names);
         for (int i = 0; i < lenNames; i++) {
             char  axisName = toupper(names[i]);
-            char* pos      = index(_names, axisName);
+            auto  pos      = strchr(_names, axisName);
             if (!pos) {
                 log_error("Invalid axis name " << names[i]);
                 retval = false;
@@ -5,12 +5,20 @@
 #include <cstring>
 
 namespace Machine {
+    const EnumItem shaperTypes[] = { { InputShaper::None, "None" },
+                                     { InputShaper::ZV, "ZV" },
+                                     { InputShaper::ZVD, "ZVD" },
+                                     { InputShaper::MZV, "MZV" },
+                                     EnumItem(InputShaper::None) };
+
     void Axis::group(Configuration::HandlerBase& handler) {
         handler.item("steps_per_mm", _stepsPerMm, 0.001, 100000.0);
         handler.item("max_rate_mm_per_min", _maxRate, 0.001, 250000.0);
         handler.item("acceleration_mm_per_sec2", _acceleration, 0.001, 100000.0);
         handler.item("max_travel_mm", _maxTravel, 0.1, 10000000.0);
         handler.item("soft_limits", _softLimits);
+        handler.item("shaper", _shaper, shaperTypes);
+        handler.item("shaper_frequency_hz", _shaperFrequency, 1.0, 500.0);
         handler.section("homing", _homing);
 
         char tmp[7];
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "../Configuration/Configurable.h"
+#include "../InputShaper.h"
 // #include "Axes.h"
 #include "Motor.h"
 #include "Homing.h"
@@ -36,6 +37,10 @@ namespace Machine {
         float _maxTravel    = 1000.0f;
         bool  _softLimits   = false;
 
+        // Input shaper that cancels a resonance of the frame along this axis
+        int   _shaper          = InputShaper::None;
+        float _shaperFrequency = 40.0f;
+
         // Configuration system helpers:
         void group(Configuration::HandlerBase& handler) override;
         void afterParse() override;
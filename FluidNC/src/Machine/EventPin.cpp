@@ -1,8 +1,11 @@
 #include "EventPin.h"
 #include "src/Report.h"
+#include "src/Machine/MachineConfig.h"  // config
 
 #include "src/Protocol.h"  // protocol_send_event
 
+#include "Driver/delay_usecs.h"  // getUsecs()
+
 void InputPin::init() {
     if (undefined()) {
         return;
@@ -11,11 +14,27 @@ void InputPin::init() {
     registerEvent(this);
     setAttr(Pin::Attr::Input);
     update(read());
+    if (_edgeCapture && config->_edgeInterrupts) {
+        if (!registerEdge(this)) {
+            log_warn(_legend << " cannot use edge interrupts");
+        }
+    }
+}
+
+void IRAM_ATTR InputPin::edgeISR(void* arg, int active, uint32_t usecs) {
+    auto pin        = static_cast<InputPin*>(arg);
+    pin->_edgeUsecs = usecs;
+    pin->edge(active);
 }
 
 void InputPin::trigger(bool active) {
     update(active);
-    log_debug(_legend << " " << active);
+    if (_edgeUsecs) {
+        log_debug(_legend << " " << active << " " << getUsecs() - _edgeUsecs << "us after edge");
+        _edgeUsecs = 0;
+    } else {
+        log_debug(_legend << " " << active);
+    }
     report_recompute_pin_string();
 }
 
@@ -12,13 +12,21 @@ protected:
 public:
     InputPin(const char* legend) : _legend(legend) {};
 
-    void init();
+    virtual void init();
 
     void update(bool state) { _value = state; };
     bool get() { return _value; }
 
     virtual void trigger(bool active);
 
+    // Pins that set _edgeCapture can act on a change directly from the pin
+    // change interrupt, when edge_interrupts is enabled and the pin supports it.
+    // edge() must be safe to call from an ISR.  trigger() still follows as usual.
+    bool              _edgeCapture = false;
+    volatile uint32_t _edgeUsecs   = 0;  // Time of the last captured change
+    virtual void      edge(bool active) {}
+    static void       edgeISR(void* arg, int active, uint32_t usecs);
+
     const std::string& legend() { return _legend; }
 
     ~InputPin() {}
@@ -85,7 +85,7 @@ namespace Machine {
         plan_data.coolant.Mist          = 0;
         plan_data.coolant.Flood         = 0;
         plan_data.line_number           = REPORT_LINE_NUMBER;
-        plan_data.is_jog                = false;
+        plan_data.motion.jogMotion      = 0;
         plan_data.feed_rate             = rate;  // Magnitude of homing rate vector
 
         config->_kinematics->cartesian_to_motors(target, &plan_data, get_mpos());
@@ -452,7 +452,10 @@ namespace Machine {
         mpos = get_mpos();
         log_debug("mpos transformed " << mpos[0] << "," << mpos[1] << "," << mpos[2]);
 
-        sys.step_control = {};                     // Return step control to normal operation.
+        {
+            Stepper::PrepLock lock;
+            sys.step_control = {};  // Return step control to normal operation.
+        }
         axes->set_homing_mode(_cycleAxes, false);  // tell motors homing is done
     }
 
@@ -40,6 +40,8 @@ namespace Machine {
         _legend += " ";
         _legend += sDir;
         _legend += " Limit";
+
+        _edgeCapture = true;
     }
 
     void LimitPin::init() {
@@ -47,6 +49,17 @@ namespace Machine {
         _pLimited = Stepping::limit_var(_axis, _motorNum);
     }
 
+    // Stop the motors as soon as the switch closes, instead of when the event is
+    // handled.  trigger() repeats this and does the rest.
+    void IRAM_ATTR LimitPin::edge(bool active) {
+        if (active && (Homing::approach() || (!state_is(State::Homing) && _pHardLimits))) {
+            Stepping::limit(_axis, _motorNum);
+            if (_pExtraLimited != nullptr) {
+                *_pExtraLimited = true;
+            }
+        }
+    }
+
     void LimitPin::trigger(bool active) {
         if (active) {
             if (Homing::approach() || (!state_is(State::Homing) && _pHardLimits)) {
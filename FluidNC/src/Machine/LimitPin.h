@@ -28,12 +28,13 @@ namespace Machine {
         LimitPin(int axis, int motorNum, int direction, bool& phardLimits);
 
         void trigger(bool active) override;
+        void edge(bool active) override;
 
         void makeDualMask();  // makes this a mask for motor0 and motor1
         void setExtraMotorLimit(int axis, int motorNum);
 
         bool isHard() { return _pHardLimits; }
-        void init();
+        void init() override;
 
         int _axis;
         int _motorNum;
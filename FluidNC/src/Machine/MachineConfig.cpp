@@ -65,6 +65,7 @@ namespace Machine {
         handler.section("macros", _macros);
         handler.section("start", _start);
         handler.section("parking", _parking);
+        handler.section("height_map", _heightMap);
 
         handler.section("user_outputs", _userOutputs);
         handler.section("user_inputs", _userInputs);
@@ -75,12 +76,15 @@ namespace Machine {
 
         // TODO: Consider putting these under a gcode: hierarchy level? Or motion control?
         handler.item("arc_tolerance_mm", _arcTolerance, 0.001, 1.0);
+        handler.item("arc_adaptive", _arcAdaptive);
         handler.item("junction_deviation_mm", _junctionDeviation, 0.01, 1.0);
+        handler.item("merge_tolerance_mm", _mergeTolerance, 0.0, 1.0);
         handler.item("verbose_errors", _verboseErrors);
         handler.item("report_inches", _reportInches);
         handler.item("enable_parking_override_control", _enableParkingOverrideControl);
         handler.item("use_line_numbers", _useLineNumbers);
-        handler.item("planner_blocks", _planner_blocks, 10, 120);
+        handler.item("planner_blocks", _planner_blocks, 10, 512);
+        handler.item("edge_interrupts", _edgeInterrupts);
     }
 
     void MachineConfig::afterParse() {
@@ -136,6 +140,10 @@ namespace Machine {
             _parking = new Parking();
         }
 
+        if (_heightMap == nullptr) {
+            _heightMap = new HeightMap();
+        }
+
         auto spindles = Spindles::SpindleFactory::objects();
         if (spindles.size() == 0) {
             spindles.push_back(new Spindles::Null("NoSpindle"));
@@ -262,5 +270,6 @@ namespace Machine {
         delete _spi;
         delete _control;
         delete _macros;
+        delete _heightMap;
     }
 }
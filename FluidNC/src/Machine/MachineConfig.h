@@ -13,6 +13,7 @@
 #include "src/Control.h"
 #include "src/Probe.h"
 #include "src/Parking.h"
+#include "src/HeightMap.h"
 #include "src/SDCard.h"
 #include "src/Spindles/Spindle.h"
 #include "src/Stepping.h"
@@ -75,16 +76,20 @@ namespace Machine {
         Macros*         _macros         = nullptr;
         Start*          _start          = nullptr;
         Parking*        _parking        = nullptr;
+        HeightMap*      _heightMap      = nullptr;
 
         UartChannel* _uart_channels[MAX_N_UARTS] = { nullptr };
         Uart*        _uarts[MAX_N_UARTS]         = { nullptr };
 
         float _arcTolerance      = 0.002f;
+        bool  _arcAdaptive       = false;
         float _junctionDeviation = 0.01f;
+        float _mergeTolerance    = 0.0f;
+        bool  _edgeInterrupts    = false;
         bool  _verboseErrors     = true;
         bool  _reportInches      = false;
 
-        size_t _planner_blocks = 16;
+        uint32_t _planner_blocks = 16;
 
         // Enables a special set of M-code commands that enables and disables the parking motion.
         // These are controlled by `M56`, `M56 P1`, or `M56 Px` to enable and `M56 P0` to disable.
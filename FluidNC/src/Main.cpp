@@ -129,6 +129,7 @@ void setup() {
 
             config->_coolant->init();
             config->_probe->init();
+            config->_heightMap->init();
         }
 
         make_proxies();
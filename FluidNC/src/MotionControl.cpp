@@ -92,7 +92,7 @@ bool mc_move_motors(float* target, plan_line_data_t* pl_data) {
 }
 
 void mc_cancel_jog() {
-    if (mc_pl_data_inflight != NULL && ((plan_line_data_t*)mc_pl_data_inflight)->is_jog) {
+    if (mc_pl_data_inflight != NULL && ((plan_line_data_t*)mc_pl_data_inflight)->motion.jogMotion) {
         mc_pl_data_inflight = NULL;
     }
 }
@@ -107,7 +107,7 @@ static bool mc_linear_no_check(float* target, plan_line_data_t* pl_data, float*
     return config->_kinematics->cartesian_to_motors(target, pl_data, position);
 }
 bool mc_linear(float* target, plan_line_data_t* pl_data, float* position) {
-    if (!pl_data->is_jog && !pl_data->limits_checked) {  // soft limits for jogs have already been dealt with
+    if (!pl_data->motion.jogMotion && !pl_data->limits_checked) {  // soft limits for jogs have already been dealt with
         if (config->_kinematics->invalid_line(target)) {
             return false;
         }
@@ -178,6 +178,34 @@ void mc_arc(float*            target,
     // For most uses, this value should not exceed 2000.
     uint16_t segments =
         uint16_t(floorf(fabsf(0.5 * angular_travel * radius) / sqrtf(config->_arcTolerance * (2 * radius - config->_arcTolerance))));
+
+    // Radius scale for the intermediate segment end points
+    float vertex_scale = 1.0f;
+
+    if (config->_arcAdaptive) {
+        // Positions are quantized to motor steps, so a tolerance finer than half
+        // a step in the arc plane only adds planner blocks.
+        auto  axes      = config->_axes->_axis;
+        float tolerance = std::max(config->_arcTolerance, 0.5f / std::min(axes[axis_0]->_stepsPerMm, axes[axis_1]->_stepsPerMm));
+        if (tolerance < radius) {
+            // Instead of putting the segment end points on the arc, with the whole
+            // error band inside it, put the intermediate end points tolerance outside
+            // the arc, so the chords cut up to tolerance inside it.  The first and last
+            // chords, which start or end on the arc, are the limiting ones.  The 0.4
+            // factor keeps their deviation within tolerance, and the chords span about
+            // 18% more angle than chords with both ends on the arc, so fewer blocks
+            // reach the planner.
+            float half_theta = acosf((radius - tolerance) / (radius + 0.4f * tolerance));
+            segments         = uint16_t(ceilf(fabsf(angular_travel) / (2 * half_theta)));
+            vertex_scale     = (radius + tolerance) / radius;
+            // A single chord has both ends on the arc, so its sagitta is up to 1.4 times
+            // tolerance.  Split it at an outer vertex if it exceeds tolerance.
+            if (segments == 1 && radius * (1.0f - cosf(0.5f * fabsf(angular_travel))) > tolerance) {
+                segments = 2;
+            }
+        }
+    }
+
     if (segments) {
         // Multiply inverse feed_rate to compensate for the fact that this movement is approximated
         // by a number of discrete segments. The inverse feed_rate should be correct for the sum of
@@ -243,8 +271,8 @@ void mc_arc(float*            target,
                 count    = 0;
             }
             // Update arc_target location
-            position[axis_0] = center[0] + radii[0];
-            position[axis_1] = center[1] + radii[1];
+            position[axis_0] = center[0] + radii[0] * vertex_scale;
+            position[axis_1] = center[1] + radii[1] * vertex_scale;
             position[axis_linear] += linear_per_segment[axis_linear];
             for (size_t i = A_AXIS; i < n_axis; i++) {
                 position[i] += linear_per_segment[i];
@@ -274,6 +302,7 @@ bool mc_dwell(int32_t milliseconds) {
 }
 
 volatile bool probing;
+volatile bool probe_latched;
 
 bool probe_succeeded = false;
 
@@ -310,7 +339,8 @@ GCUpdatePos mc_probe_cycle(float* target, plan_line_data_t* pl_data, bool away,
     // Setup and queue probing motion. Auto cycle-start should not start the cycle.
     mc_linear(target, pl_data, gc_state.position);
     // Activate the probing state monitor in the stepper module.
-    probing = true;
+    probe_latched = false;
+    probing       = true;
     // Perform probing cycle. Wait here until probe is triggered or motion completes.
     protocol_send_event(&cycleStartEvent);
     do {
@@ -12,7 +12,8 @@
 
 #include <cstdint>
 
-extern volatile bool probing;  // Probing state value.  Used to coordinate the probing cycle with stepper ISR.
+extern volatile bool probing;        // Probing state value.  Used to coordinate the probing cycle with stepper ISR.
+extern volatile bool probe_latched;  // The stepper ISR has latched probe_steps during this probing cycle.
 
 extern bool probe_succeeded;  // Tracks if last probing cycle was successful.
 
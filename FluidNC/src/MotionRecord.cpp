@@ -0,0 +1,134 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "MotionRecord.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace MotionRecord {
+    size_t encode(const Record& record, size_t n_axis, uint8_t* payload) {
+        size_t length = 4;
+        if (record.has_line) {
+            memcpy(payload + length, &record.line, sizeof(record.line));
+            length += sizeof(record.line);
+        }
+        if (record.has_feed) {
+            memcpy(payload + length, &record.feed, sizeof(record.feed));
+            length += sizeof(record.feed);
+        }
+        for (size_t axis = 0; axis < n_axis; axis++) {
+            if (record.axes & (1 << axis)) {
+                memcpy(payload + length, &record.values[axis], sizeof(float));
+                length += sizeof(float);
+            }
+        }
+        if (record.is_arc()) {
+            memcpy(payload + length, record.offsets, sizeof(record.offsets));
+            length += sizeof(record.offsets);
+        }
+        payload[0] = record.motion;
+        payload[1] = record.axes;
+        payload[2] = (record.has_line ? HasLine : 0) | (record.has_feed ? HasFeed : 0) | (record.plane << plane_shift);
+        payload[3] = record.turns;
+        return length;
+    }
+
+    bool decode(const uint8_t* payload, size_t length, size_t n_axis, Record& record) {
+        if (length < 4 || length > max_bytes || n_axis > max_axes) {
+            return false;
+        }
+        record.motion   = payload[0];
+        record.axes     = payload[1];
+        uint8_t flags   = payload[2];
+        record.turns    = payload[3];
+        record.plane    = flags >> plane_shift;
+        record.has_line = flags & HasLine;
+        record.has_feed = flags & HasFeed;
+
+        if (record.motion > 3 || record.plane > 2 || !record.axes || (record.axes >> n_axis)) {
+            return false;
+        }
+        if (!record.is_arc() && record.turns) {
+            return false;
+        }
+
+        // The length must be exactly what the flags and axis words call for
+        size_t expected = 4 + (record.has_line ? sizeof(int32_t) : 0) + (record.has_feed ? sizeof(float) : 0);
+        for (size_t axis = 0; axis < n_axis; axis++) {
+            if (record.axes & (1 << axis)) {
+                expected += sizeof(float);
+            }
+        }
+        if (record.is_arc()) {
+            expected += sizeof(record.offsets);
+        }
+        if (length != expected) {
+            return false;
+        }
+
+        payload += 4;
+        if (record.has_line) {
+            memcpy(&record.line, payload, sizeof(record.line));
+            payload += sizeof(record.line);
+            if (record.line < 0) {
+                return false;
+            }
+        }
+        if (record.has_feed) {
+            memcpy(&record.feed, payload, sizeof(record.feed));
+            payload += sizeof(record.feed);
+            if (!std::isfinite(record.feed) || record.feed < 0) {
+                return false;
+            }
+        }
+        for (size_t axis = 0; axis < n_axis; axis++) {
+            if (record.axes & (1 << axis)) {
+                memcpy(&record.values[axis], payload, sizeof(float));
+                payload += sizeof(float);
+                if (!std::isfinite(record.values[axis])) {
+                    return false;
+                }
+            }
+        }
+        if (record.is_arc()) {
+            memcpy(record.offsets, payload, sizeof(record.offsets));
+            if (!std::isfinite(record.offsets[0]) || !std::isfinite(record.offsets[1])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Status next(const uint8_t*& p, const uint8_t* end, size_t n_axis, Record& record) {
+        if (p >= end) {
+            return Status::End;
+        }
+        if (end - p < 2 || p[0] != uint8_t(Type::Motion) || p[1] > end - p - 2) {
+            return Status::Corrupt;
+        }
+        size_t length = p[1];
+        if (!decode(p + 2, length, n_axis, record)) {
+            return Status::Corrupt;
+        }
+        p += 2 + length;
+        return Status::Ok;
+    }
+
+    bool arc_end_on_circle(const float start[2], const float end[2], const float offset[2]) {
+        // The same arithmetic as gc_execute_line(), so that a compiled arc fails when the source line would
+        float x        = end[0] - start[0] - offset[0];
+        float y        = end[1] - start[1] - offset[1];
+        float target_r = sqrtf(x * x + y * y);
+        float r        = sqrtf(offset[0] * offset[0] + offset[1] * offset[1]);
+        float delta_r  = fabsf(target_r - r);
+        if (delta_r > 0.005) {
+            if (delta_r > 0.5) {
+                return false;  // > 0.5mm
+            }
+            if (delta_r > (0.001 * r)) {
+                return false;  // > 0.005mm AND 0.1% radius
+            }
+        }
+        return true;
+    }
+}
@@ -0,0 +1,68 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+/*
+  MotionRecord.h - the binary motion records of compiled GCode jobs.
+
+  A motion payload starts with four bytes: the motion (0 to 3 for G0 to G3),
+  a mask of the axis words, the flags below and the number of arc turns
+  (P word).  Then come the line number if HasLine, the feed rate in mm/min
+  if HasFeed, one float in mm per axis word and, for arcs, the center
+  offsets along the first two axes of the plane.  Values are in the byte
+  order of the controller.
+
+  A line of motion records is what CompiledFile::pollLine() hands to the
+  protocol loop: the record mark, the number of bytes that follow, then
+  records of a type byte, a length byte and the payload.  decode() and
+  next() check every length and field, so a corrupt file cannot make the
+  controller read past the line or run a move that the parser would reject.
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+namespace MotionRecord {
+    const size_t max_axes = 6;  // MAX_N_AXIS
+
+    enum class Type : uint8_t {
+        Text   = 1,  // A line for the GCode parser
+        Motion = 2,
+    };
+
+    const uint8_t HasLine     = 1;
+    const uint8_t HasFeed     = 2;
+    const int     plane_shift = 2;  // Two bits: XY, ZX or YZ
+
+    const size_t max_bytes = 4 + sizeof(int32_t) + sizeof(float) * (1 + max_axes + 2);
+
+    struct Record {
+        uint8_t motion   = 0;  // 0 to 3 for G0 to G3
+        uint8_t axes     = 0;  // Mask of the axis words
+        uint8_t plane    = 0;  // 0 to 2 for G17 to G19
+        uint8_t turns    = 0;  // P word of an arc
+        bool    has_line = false;
+        bool    has_feed = false;
+        int32_t line     = 0;
+        float   feed     = 0;
+        float   values[max_axes] = {};  // Indexed by axis, valid for the axis words
+        float   offsets[2]       = {};  // Arc center offsets along the first two axes of the plane
+
+        bool is_arc() const { return motion == 2 || motion == 3; }
+    };
+
+    // Returns the number of bytes written to payload, at most max_bytes
+    size_t encode(const Record& record, size_t n_axis, uint8_t* payload);
+
+    // Returns false if payload is not a well-formed motion record for n_axis axes
+    bool decode(const uint8_t* payload, size_t length, size_t n_axis, Record& record);
+
+    enum class Status { Ok, End, Corrupt };
+
+    // Decodes the record at p in a line of records that ends at end, and advances p past it
+    Status next(const uint8_t*& p, const uint8_t* end, size_t n_axis, Record& record);
+
+    // The parser's check that the end of an arc in center format is on the circle.
+    // The start, end and center offset are along the two axes of the plane, in mm.
+    bool arc_end_on_circle(const float start[2], const float end[2], const float offset[2]);
+}
@@ -14,10 +14,14 @@ void Parking::moveto(float* target) {
         return;  // Block during abort.
     }
     if (plan_buffer_line(target, &plan_data)) {
-        sys.step_control.executeSysMotion = true;
-        sys.step_control.endMotion        = false;  // Allow parking motion to execute, if feed hold is active.
-        Stepper::parking_setup_buffer();            // Setup step segment buffer for special parking motion case
-        Stepper::prep_buffer();
+        {
+            // The motion prep task must see the flags and the parking buffer state together
+            Stepper::PrepLock lock;
+            sys.step_control.executeSysMotion = true;
+            sys.step_control.endMotion        = false;  // Allow parking motion to execute, if feed hold is active.
+            Stepper::parking_setup_buffer();            // Setup step segment buffer for special parking motion case
+            Stepper::prep_buffer();
+        }
         Stepper::wake_up();
         do {
             protocol_exec_rt_system();
@@ -27,7 +31,10 @@ void Parking::moveto(float* target) {
         } while (sys.step_control.executeSysMotion);
         Stepper::parking_restore_buffer();  // Restore step segment buffer to normal run state.
     } else {
-        sys.step_control.executeSysMotion = false;
+        {
+            Stepper::PrepLock lock;
+            sys.step_control.executeSysMotion = false;
+        }
         protocol_exec_rt_system();
     }
 }
@@ -64,7 +71,7 @@ void Parking::setup() {
     plan_data.motion.systemMotion   = 1;
     plan_data.motion.noFeedOverride = 1;
     plan_data.line_number           = PARKING_MOTION_LINE_NUMBER;
-    plan_data.is_jog                = false;
+    plan_data.motion.jogMotion      = 0;
     block                           = plan_get_current_block();
 
     if (block) {
@@ -78,8 +85,13 @@ void Parking::setup() {
     }
 }
 
+// moveto() plans motor positions, so the restore position must be one too.  It differs
+// from get_mpos() where the height map offsets Z.
 void Parking::set_target() {
-    copyAxes(parking_target, get_mpos());
+    auto steps = get_motor_steps();
+    for (size_t axis = 0; axis < Axes::_numberAxis; axis++) {
+        parking_target[axis] = steps_to_mpos(steps[axis], axis);
+    }
 }
 
 void Parking::park(bool restart) {
@@ -150,6 +162,7 @@ void Parking::unpark(bool restart) {
         if (!restart) {
             if (spindle->isRateAdjusted()) {
                 // When in laser mode, defer turn on until cycle starts
+                Stepper::PrepLock lock;
                 sys.step_control.updateSpindleSpeed = true;
             } else {
                 log_debug("Spin up");
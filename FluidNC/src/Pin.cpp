@@ -17,7 +17,12 @@
 #include <string_view>
 #include <charconv>
 
-Pins::PinDetail* Pin::undefinedPin = new Pins::VoidPinDetail();
+// The address of a static object is known before any constructor runs, so Pin
+// members of other static objects compare equal to undefinedPin whatever the
+// order in which the toolchain runs static constructors.
+static Pins::VoidPinDetail undefinedPinDetail;
+
+Pins::PinDetail* Pin::undefinedPin = &undefinedPinDetail;
 Pins::PinDetail* Pin::errorPin     = new Pins::ErrorPinDetail("unknown");
 
 static constexpr bool verbose_debugging = false;
@@ -78,7 +83,12 @@ const char* Pin::parse(std::string_view pin_str, Pins::PinDetail*& pinImplementa
         return nullptr;
     }
     if (string_util::equal_ignore_case(prefix, "i2so")) {
+#ifdef ESP32
         pinImplementation = new Pins::I2SOPinDetail(static_cast<pinnum_t>(pin_number), parser);
+#else
+        // Off the ESP32 there is no I2S shift register, so the pin does nothing
+        pinImplementation = new Pins::VoidPinDetail();
+#endif
         return nullptr;
     }
 
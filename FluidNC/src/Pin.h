@@ -133,6 +133,7 @@ public:
     static Pin Error() { return Pin(errorPin); }
 
     void registerEvent(InputPin* obj) { _detail->registerEvent(obj); };
+    bool registerEdge(InputPin* obj) { return _detail->registerEdge(obj); };
 
     // Other functions:
     Capabilities capabilities() const { return _detail->capabilities(); }
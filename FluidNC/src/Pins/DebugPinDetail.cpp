@@ -62,6 +62,27 @@ namespace Pins {
         return _implementation->getAttr();
     }
 
+    bool DebugPinDetail::shouldEvent() {
+        // Limit the rate of messages so that a busy pin does not flood the serial port
+        uint32_t time = millis();
+
+        if (_lastEvent + 1000 < time) {
+            _lastEvent  = time;
+            _eventCount = 1;
+            return true;
+        }
+        _lastEvent = time;
+        if (_eventCount < 10) {
+            ++_eventCount;
+            return true;
+        }
+        if (_eventCount == 10) {
+            ++_eventCount;
+            log_msg_to(Uart0, "Suppressing events...");
+        }
+        return false;
+    }
+
     void DebugPinDetail::CallbackHandler::handle(void* arg) {
         auto handler = static_cast<CallbackHandler*>(arg);
         if (handler->_myPin->shouldEvent()) {
@@ -155,6 +155,11 @@ namespace Pins {
         gpio_set_event(_index, reinterpret_cast<void*>(obj), _attributes.has(Pin::Attr::ActiveLow));
     }
 
+    bool GPIOPinDetail::registerEdge(InputPin* obj) {
+        gpio_set_edge_callback(_index, InputPin::edgeISR);
+        return true;
+    }
+
     std::string GPIOPinDetail::toString() {
         std::string s("gpio.");
         s += std::to_string(_index);
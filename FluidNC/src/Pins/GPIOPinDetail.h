@@ -45,6 +45,7 @@ namespace Pins {
         bool canStep() override { return true; }
 
         void registerEvent(InputPin* obj) override;
+        bool registerEdge(InputPin* obj) override;
 
         std::string toString() override;
 
@@ -45,6 +45,9 @@ namespace Pins {
 
         virtual void registerEvent(InputPin* obj);
 
+        // Calls obj->edge() from a pin change interrupt.  Returns false if the pin cannot do that.
+        virtual bool registerEdge(InputPin* obj) { return false; }
+
         virtual std::string toString() = 0;
 
         inline int number() const { return _index; }
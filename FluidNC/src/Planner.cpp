@@ -10,21 +10,29 @@
 
 #include "Planner.h"
 #include "Machine/MachineConfig.h"
+#include "Driver/psram.h"
+#include "Driver/delay_usecs.h"  // getCpuTicks
 
 #include <cstdlib>  // PSoc Required for labs
 #include <cmath>
 
 static plan_block_t* block_buffer = nullptr;  // A ring buffer for motion instructions
-static uint8_t       block_buffer_tail;       // Index of the block to process now
-static uint8_t       block_buffer_head;       // Index of the next block to be pushed
-static uint8_t       next_buffer_head;        // Index of the next buffer head
-static uint8_t       block_buffer_planned;    // Index of the optimally planned block
+static plan_index_t  block_buffer_tail;       // Index of the block to process now
+static plan_index_t  block_buffer_head;       // Index of the next block to be pushed
+static plan_index_t  next_buffer_head;        // Index of the next buffer head
+static plan_index_t  block_buffer_planned;    // Index of the optimally planned block
 
 void plan_init() {
     if (block_buffer) {
-        delete[] block_buffer;
+        psram_free(block_buffer);
     }
-    block_buffer = new plan_block_t[config->_planner_blocks];
+    // A long lookahead buffer can be tens of kilobytes, so put it in PSRAM if the board has it.
+    // The planner and segment generator run in task context, so PSRAM access latency does not
+    // affect step timing.
+    size_t size  = config->_planner_blocks * sizeof(plan_block_t);
+    block_buffer = static_cast<plan_block_t*>(psram_alloc(size));
+    Assert(block_buffer, "Cannot allocate %d planner blocks", int(config->_planner_blocks));
+    log_info("Planner blocks:" << config->_planner_blocks << " using " << size << " bytes");
 }
 
 // Define planner variables
@@ -37,8 +45,42 @@ typedef struct {
 } planner_t;
 static planner_t pl;
 
+// Lines that continue the newest block within pl_data->path_tolerance are merged into it instead
+// of taking a new block, as long as that block is still waiting in the buffer. The vertices that
+// it has absorbed are remembered so every one of them can be checked against the extended line.
+const int MAX_MERGED_VERTICES = 8;
+
+typedef struct {
+    bool    active;                                      // True if the newest block can be extended
+    int32_t start[MAX_N_AXIS];                           // Start of the newest block in steps
+    float   entry_unit_vec[MAX_N_AXIS];                  // Unit vector of the block before it
+    float   entry_nominal_speed;                         // Nominal speed of the block before it
+    float   feed_rate;                                   // Programmed feed rate of the newest block
+    int32_t vertices[MAX_MERGED_VERTICES][MAX_N_AXIS];  // Absorbed vertices in steps
+    int     n_vertices;
+} merge_t;
+static merge_t merge;
+
+// An override change recomputes the speed limits of every block, which can take a while with a
+// long buffer, so the work is done a few blocks at a time from the executing block forward.
+// Blocks beyond the cursor keep their old limits until it reaches them, but their entry speeds
+// are clamped to the new nominal speeds right away, which is cheap.  Otherwise the segment
+// generator could load a block whose exit speed is above its nominal speed.
+const int PLANNER_REPLAN_BLOCKS = 16;  // Blocks recomputed per call of plan_replan_step()
+
+typedef struct {
+    bool         active;
+    plan_index_t cursor;              // Next block whose limits are stale
+    float        prev_nominal_speed;  // Nominal speed of the block before the cursor
+} replan_t;
+static replan_t replan;
+
+plan_replan_stats_t plan_replan_stats;
+
+uint32_t plan_blocks_added = 0;
+
 // Returns the index of the next block in the ring buffer. Also called by stepper segment buffer.
-static uint8_t plan_next_block_index(uint8_t block_index) {
+static plan_index_t plan_next_block_index(plan_index_t block_index) {
     block_index++;
     if (block_index == config->_planner_blocks) {
         block_index = 0;
@@ -47,7 +89,7 @@ static uint8_t plan_next_block_index(uint8_t block_index) {
 }
 
 // Returns the index of the previous block in the ring buffer
-static uint8_t plan_prev_block_index(uint8_t block_index) {
+static plan_index_t plan_prev_block_index(plan_index_t block_index) {
     if (block_index == 0) {
         block_index = config->_planner_blocks;
     }
@@ -120,58 +162,62 @@ static uint8_t plan_prev_block_index(uint8_t block_index) {
   ARM versions should have enough memory and speed for look-ahead blocks numbering up to a hundred or more.
 
 */
-static void planner_recalculate() {
+// planner_recalculate_to() plans the blocks before end, with the entry speed of the block at end as
+// their exit speed.  The forward pass continues past end only as long as it has to lower speeds.
+static void planner_recalculate_to(plan_index_t end) {
     if (block_buffer_head == block_buffer_tail) {
         // Nothing to do; planner buffer is empty.
         return;
     }
-    // Initialize block index to the last block in the planner buffer.
-    uint8_t block_index = plan_prev_block_index(block_buffer_head);
-    // Bail. Can't do anything with one only one plan-able block.
-    if (block_index == block_buffer_planned) {
-        return;
-    }
     // Reverse Pass: Coarsely maximize all possible deceleration curves back-planning from the last
-    // block in buffer. Cease planning when the last optimal planned or tail pointer is reached.
+    // block to plan. Blocks up to the last optimal planned pointer are only revisited while their
+    // entry speeds have to come down, which happens when replanning lowers the speeds after them.
+    // The tail block is executing, so its entry speed is left alone.
     // NOTE: Forward pass will later refine and correct the reverse pass to create an optimal plan.
     float         entry_speed_sqr;
     plan_block_t* next;
-    plan_block_t* current = &block_buffer[block_index];
-    // Calculate maximum entry speed for last block in buffer, where the exit speed is always zero.
-    current->entry_speed_sqr = MIN(current->max_entry_speed_sqr, 2 * current->acceleration * current->millimeters);
-    block_index              = plan_prev_block_index(block_index);
-    if (block_index == block_buffer_planned) {  // Only two plannable blocks in buffer. Reverse pass complete.
-        // Check if the first block is the tail. If so, notify stepper to update its current parameters.
-        if (block_index == block_buffer_tail) {
-            Stepper::update_plan_block_parameters();
+    plan_block_t* current;
+    // The exit speed is zero at the end of the buffer.
+    float        exit_speed_sqr = end == block_buffer_head ? 0.0f : block_buffer[end].entry_speed_sqr;
+    plan_index_t block_index    = plan_prev_block_index(end);
+    plan_index_t planned        = block_buffer_planned;
+    bool         optimal        = false;
+    while (block_index != block_buffer_tail) {
+        current         = &block_buffer[block_index];
+        entry_speed_sqr = MIN(current->max_entry_speed_sqr, exit_speed_sqr + 2 * current->acceleration * current->millimeters);
+        if (block_index == block_buffer_planned) {
+            optimal = true;
         }
-    } else {  // Three or more plan-able blocks
-        while (block_index != block_buffer_planned) {
-            next        = current;
-            current     = &block_buffer[block_index];
-            block_index = plan_prev_block_index(block_index);
-            // Check if next block is the tail block(=planned block). If so, update current stepper parameters.
-            if (block_index == block_buffer_tail) {
-                Stepper::update_plan_block_parameters();
-            }
-            // Compute maximum entry speed decelerating over the current block from its exit speed.
-            if (current->entry_speed_sqr != current->max_entry_speed_sqr) {
-                entry_speed_sqr = next->entry_speed_sqr + 2 * current->acceleration * current->millimeters;
-                if (entry_speed_sqr < current->max_entry_speed_sqr) {
-                    current->entry_speed_sqr = entry_speed_sqr;
-                } else {
-                    current->entry_speed_sqr = current->max_entry_speed_sqr;
-                }
+        if (optimal) {
+            if (entry_speed_sqr >= current->entry_speed_sqr) {
+                break;
             }
+            planned = plan_prev_block_index(block_index);  // The forward pass must start before this block
+        }
+        current->entry_speed_sqr = entry_speed_sqr;
+        exit_speed_sqr           = entry_speed_sqr;
+        block_index              = plan_prev_block_index(block_index);
+        // Check if this was the block after the tail. If so, update current stepper parameters.
+        if (block_index == block_buffer_tail) {
+            Stepper::update_plan_block_parameters();
         }
     }
+    block_buffer_planned = planned;
+
     // Forward Pass: Forward plan the acceleration curve from the planned pointer onward.
     // Also scans for optimal plan breakpoints and appropriately updates the planned pointer.
-    next        = &block_buffer[block_buffer_planned];  // Begin at buffer planned pointer
-    block_index = plan_next_block_index(block_buffer_planned);
+    // The pointer stays before blocks whose limits an override replan has not reached yet, so
+    // that a later replan step recomputes them.
+    plan_index_t stale      = replan.active ? replan.cursor : block_buffer_head;
+    next                    = &block_buffer[block_buffer_planned];  // Begin at buffer planned pointer
+    block_index             = plan_next_block_index(block_buffer_planned);
+    bool         past_end   = false;
+    bool         past_stale = false;
     while (block_index != block_buffer_head) {
-        current = next;
-        next    = &block_buffer[block_index];
+        current      = next;
+        next         = &block_buffer[block_index];
+        bool lowered = false;
+        past_stale   = past_stale || block_index == stale;
         // Any acceleration detected in the forward pass automatically moves the optimal planned
         // pointer forward, since everything before this is all optimal. In other words, nothing
         // can improve the plan from the buffer tail to the planned pointer by logic.
@@ -180,40 +226,63 @@ static void planner_recalculate() {
             // If true, current block is full-acceleration and we can move the planned pointer forward.
             if (entry_speed_sqr < next->entry_speed_sqr) {
                 next->entry_speed_sqr = entry_speed_sqr;  // Always <= max_entry_speed_sqr. Backward pass sets this.
-                block_buffer_planned  = block_index;      // Set optimal plan pointer.
+                lowered               = true;
+                if (!past_stale) {
+                    block_buffer_planned = block_index;  // Set optimal plan pointer.
+                }
             }
         }
         // Any block set at its maximum entry speed also creates an optimal plan up to this
         // point in the buffer. When the plan is bracketed by either the beginning of the
         // buffer and a maximum entry speed or two maximum entry speeds, every block in between
         // cannot logically be further improved. Hence, we don't have to recompute them anymore.
-        if (next->entry_speed_sqr == next->max_entry_speed_sqr) {
+        if (next->entry_speed_sqr == next->max_entry_speed_sqr && !past_stale) {
             block_buffer_planned = block_index;
         }
+        // From the end on, the existing plan stands unless an entry speed had to come down.
+        if (past_end || block_index == end) {
+            if (!lowered) {
+                break;
+            }
+            past_end = true;
+        }
         block_index = plan_next_block_index(block_index);
     }
 }
 
+static void planner_recalculate() {
+    planner_recalculate_to(block_buffer_head);
+}
+
 void plan_reset() {
+    Stepper::PrepLock lock;
     memset(&pl, 0, sizeof(planner_t));  // Clear planner struct
     plan_reset_buffer();
 }
 
 void plan_reset_buffer() {
+    Stepper::PrepLock lock;
+    merge.active         = false;
     block_buffer_tail    = 0;
     block_buffer_head    = 0;  // Empty = tail
     next_buffer_head     = 1;  // plan_next_block_index(block_buffer_head)
     block_buffer_planned = 0;  // = block_buffer_tail;
+    replan.active        = false;
 }
 
 // Called from stepper pulse function when the block is complete
 void plan_discard_current_block() {
     if (block_buffer_head != block_buffer_tail) {  // Discard non-empty buffer.
-        uint8_t block_index = plan_next_block_index(block_buffer_tail);
+        plan_index_t block_index = plan_next_block_index(block_buffer_tail);
         // Push block_buffer_planned pointer, if encountered.
         if (block_buffer_tail == block_buffer_planned) {
             block_buffer_planned = block_index;
         }
+        // Likewise the replan cursor.  The new first block has no junction limit from before.
+        if (replan.active && block_buffer_tail == replan.cursor) {
+            replan.cursor             = block_index;
+            replan.prev_nominal_speed = SOME_LARGE_VALUE;
+        }
         block_buffer_tail = block_index;
     }
 }
@@ -232,13 +301,23 @@ plan_block_t* plan_get_current_block() {
 }
 
 float plan_get_exec_block_exit_speed_sqr() {
-    uint8_t block_index = plan_next_block_index(block_buffer_tail);
+    plan_index_t block_index = plan_next_block_index(block_buffer_tail);
     if (block_index == block_buffer_head) {
         return 0.0f;
     }
     return block_buffer[block_index].entry_speed_sqr;
 }
 
+plan_block_t* plan_get_exec_next_block(float& exit_speed_sqr) {
+    plan_index_t block_index = plan_next_block_index(block_buffer_tail);
+    if (block_index == block_buffer_head) {
+        return NULL;
+    }
+    plan_index_t after = plan_next_block_index(block_index);
+    exit_speed_sqr     = after == block_buffer_head ? 0.0f : block_buffer[after].entry_speed_sqr;
+    return &block_buffer[block_index];
+}
+
 // Returns the availability status of the block ring buffer. True, if full.
 uint8_t plan_check_full_buffer() {
     return block_buffer_tail == next_buffer_head;
@@ -280,25 +359,348 @@ static void plan_compute_profile_parameters(plan_block_t* block, float nominal_s
 }
 
 // Re-calculates buffered motions profile parameters upon a motion-based override change.
+// The first blocks are done now and the rest by plan_replan_step().
 void plan_update_velocity_profile_parameters() {
-    uint8_t       block_index = block_buffer_tail;
+    Stepper::PrepLock lock;
+    plan_replan_stats.overrides++;
+    replan.active             = true;
+    replan.cursor             = block_buffer_tail;
+    replan.prev_nominal_speed = SOME_LARGE_VALUE;   // Set high for first block nominal speed calculation.
+    merge.active              = false;              // Its entry nominal speed is stale now
+    block_buffer_planned      = block_buffer_tail;  // Every limit changes
+
+    if (block_buffer_tail != block_buffer_head) {
+        // The executing block continues from its current speed with the new nominal speed
+        Stepper::update_plan_block_parameters();
+
+        // No later block may enter faster than the new nominal speeds allow, even before its
+        // limits are recomputed, and new blocks must see the new nominal speed of the last one.
+        float prev_nominal_speed = plan_compute_profile_nominal_speed(&block_buffer[block_buffer_tail]);
+        for (plan_index_t block_index = plan_next_block_index(block_buffer_tail); block_index != block_buffer_head;
+             block_index              = plan_next_block_index(block_index)) {
+            plan_block_t* block         = &block_buffer[block_index];
+            float         nominal_speed = plan_compute_profile_nominal_speed(block);
+            float         limit         = MIN(nominal_speed, prev_nominal_speed);
+            block->entry_speed_sqr      = MIN(block->entry_speed_sqr, limit * limit);
+            prev_nominal_speed          = nominal_speed;
+        }
+        pl.previous_nominal_speed = prev_nominal_speed;
+    }
+    plan_replan_step();
+}
+
+void plan_replan_step() {
+    if (!replan.active) {
+        return;
+    }
+    Stepper::PrepLock lock;
+    int32_t           start = getCpuTicks();
+
     plan_block_t* block;
     float         nominal_speed;
-    float         prev_nominal_speed = SOME_LARGE_VALUE;  // Set high for first block nominal speed calculation.
-    while (block_index != block_buffer_head) {
-        block         = &block_buffer[block_index];
+    int           n_blocks = 0;
+    while (replan.cursor != block_buffer_head && n_blocks < PLANNER_REPLAN_BLOCKS) {
+        block         = &block_buffer[replan.cursor];
         nominal_speed = plan_compute_profile_nominal_speed(block);
-        plan_compute_profile_parameters(block, nominal_speed, prev_nominal_speed);
-        prev_nominal_speed = nominal_speed;
-        block_index        = plan_next_block_index(block_index);
+        plan_compute_profile_parameters(block, nominal_speed, replan.prev_nominal_speed);
+        replan.prev_nominal_speed = nominal_speed;
+        replan.cursor             = plan_next_block_index(replan.cursor);
+        n_blocks++;
+    }
+    if (replan.cursor == block_buffer_head) {
+        pl.previous_nominal_speed = replan.prev_nominal_speed;  // Update prev nominal speed for next incoming block.
+        replan.active             = false;
     }
-    pl.previous_nominal_speed = prev_nominal_speed;  // Update prev nominal speed for next incoming block.
+
+    // Re-plan the updated blocks.  The blocks up to the planned pointer were planned with their
+    // new limits by an earlier step, so they are revisited only if their speeds must come down.
     if (block_buffer_tail != block_buffer_head) {
-        plan_cycle_reinitialize();
+        planner_recalculate_to(replan.cursor);
+    }
+
+    uint32_t ticks = getCpuTicks() - start;
+    plan_replan_stats.passes++;
+    plan_replan_stats.blocks += n_blocks;
+    plan_replan_stats.total_ticks += ticks;
+    if (ticks > plan_replan_stats.max_ticks) {
+        plan_replan_stats.max_ticks = ticks;
     }
 }
 
-bool plan_buffer_line(float* target, plan_line_data_t* pl_data) {
+// True if the segment generator will turn the ramps of the block into S-curves, either because
+// S-curves are on or because a moving axis has an input shaper
+static bool plan_ramps_smoothed(const plan_block_t* block) {
+    if (Stepping::_sCurve) {
+        return true;
+    }
+    auto n_axis = Axes::_numberAxis;
+    for (size_t axis = 0; axis < n_axis; axis++) {
+        if (block->steps[axis] && Axes::_axis[axis]->_shaper != InputShaper::None) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Fills in the step counts, direction bits and axis-limited rates of a block that runs from
+// position_steps to target_steps, and leaves its unit vector in unit_vec.
+static void plan_compute_block_geometry(plan_block_t* block, const int32_t* position_steps, const int32_t* target_steps, float* unit_vec) {
+    block->step_event_count = 0;
+    block->direction_bits   = 0;
+    auto n_axis             = Axes::_numberAxis;
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        // Calculate the number of steps for each axis, and determine max step events.
+        // Also, compute individual axes distance for move and prep unit vector calculations.
+        // NOTE: Computes true distance from converted step values.
+        block->steps[idx]       = labs(target_steps[idx] - position_steps[idx]);
+        block->step_event_count = MAX(block->step_event_count, block->steps[idx]);
+        float delta_mm          = steps_to_mpos((target_steps[idx] - position_steps[idx]), idx);
+        unit_vec[idx]           = delta_mm;  // Store unit vector numerator
+        // Set direction bits. Bit enabled always means direction is negative.
+        if (delta_mm < 0.0) {
+            block->direction_bits |= bitnum_to_mask(idx);
+        }
+    }
+    if (block->step_event_count == 0) {
+        return;
+    }
+
+    // Calculate the unit vector of the line move and the block maximum feed rate and acceleration scaled
+    // down such that no individual axes maximum values are exceeded with respect to the line direction.
+    // NOTE: This calculation assumes all axes are orthogonal (Cartesian) and works with ABC-axes,
+    // if they are also orthogonal/independent. Operates on the absolute value of the unit vector.
+    block->millimeters  = convert_delta_vector_to_unit_vector(unit_vec);
+    block->acceleration = limit_acceleration_by_axis_maximum(unit_vec);
+    block->rapid_rate   = limit_rate_by_axis_maximum(unit_vec);
+    // S-curve and input shaped ramps pass through the junction speeds planned here, so the reverse
+    // and forward passes are unchanged, but their acceleration peaks above the average. Plan with
+    // the average that keeps the peak within the axis limits.  Junction speeds are not derated.
+    if (plan_ramps_smoothed(block)) {
+        block->acceleration /= Stepping::sCurvePeakRatio;
+    }
+}
+
+// Computes the maximum junction speed between lines along prev_unit_vec and unit_vec.
+static float plan_compute_junction_speed_sqr(const float* prev_unit_vec, const float* unit_vec) {
+    // Compute maximum allowable entry speed at junction by centripetal acceleration approximation.
+    // Let a circle be tangent to both previous and current path line segments, where the junction
+    // deviation is defined as the distance from the junction to the closest edge of the circle,
+    // colinear with the circle center. The circular segment joining the two paths represents the
+    // path of centripetal acceleration. Solve for max velocity based on max acceleration about the
+    // radius of the circle, defined indirectly by junction deviation. This may be also viewed as
+    // path width or max_jerk in the previous Grbl version. This approach does not actually deviate
+    // from path, but used as a robust way to compute cornering speeds, as it takes into account the
+    // nonlinearities of both the junction angle and junction velocity.
+    //
+    // NOTE: This is the cornering speed in exact path mode (G61). Exact stop mode (G61.1) sets it
+    // to zero instead. In continuous mode (G64), plan_blend_corner() replaces the corner with a
+    // real arc within the G64 P tolerance, whose chords meet at nearly straight junctions.
+    //
+    // NOTE: The max junction speed is a fixed value, since machine acceleration limits cannot be
+    // changed dynamically during operation nor can the line move geometry. This must be kept in
+    // memory in the event of a feedrate override changing the nominal speeds of blocks, which can
+    // change the overall maximum entry speed conditions of all blocks.
+    float junction_unit_vec[MAX_N_AXIS];
+    float junction_cos_theta = 0.0;
+    auto  n_axis             = Axes::_numberAxis;
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        junction_cos_theta -= prev_unit_vec[idx] * unit_vec[idx];
+        junction_unit_vec[idx] = unit_vec[idx] - prev_unit_vec[idx];
+    }
+    // NOTE: Computed without any expensive trig, sin() or acos(), by trig half angle identity of cos(theta).
+    if (junction_cos_theta > 0.999999) {
+        //  For a 0 degree acute junction, just set minimum junction speed.
+        return MINIMUM_JUNCTION_SPEED * MINIMUM_JUNCTION_SPEED;
+    }
+    if (junction_cos_theta < -0.999999) {
+        // Junction is a straight line or 180 degrees. Junction speed is infinite.
+        return SOME_LARGE_VALUE;
+    }
+    convert_delta_vector_to_unit_vector(junction_unit_vec);
+    float junction_acceleration = limit_acceleration_by_axis_maximum(junction_unit_vec);
+    float sin_theta_d2          = sqrtf(0.5f * (1.0f - junction_cos_theta));  // Trig half angle identity. Always positive.
+    return MAX(MINIMUM_JUNCTION_SPEED * MINIMUM_JUNCTION_SPEED,
+               (junction_acceleration * config->_junctionDeviation * sin_theta_d2) / (1.0f - sin_theta_d2));
+}
+
+// Tries to extend the newest block to target_steps. That is possible if the block has not started
+// to execute, the motion conditions match, and the start of the block, the vertices it has already
+// absorbed, and its current end all lie within pl_data->path_tolerance of the extended line.
+// Lines are only merged with Cartesian kinematics, where a straight line in motor space is one
+// in machine space too.
+static bool plan_merge_line(int32_t* target_steps, plan_line_data_t* pl_data) {
+    float tolerance = pl_data->path_tolerance;
+    if (tolerance <= 0.0f || !merge.active || merge.n_vertices == MAX_MERGED_VERTICES) {
+        return false;
+    }
+    if (!config->_kinematics->isCartesian()) {
+        return false;
+    }
+    if (block_buffer_head == block_buffer_tail) {
+        return false;
+    }
+    plan_index_t block_index = plan_prev_block_index(block_buffer_head);
+    if (block_index == block_buffer_tail) {
+        return false;  // The stepper segment generator may already be working on it.
+    }
+    plan_block_t* block = &block_buffer[block_index];
+    if (block->motion.exactStop || pl_data->motion.rapidMotion != block->motion.rapidMotion || pl_data->motion.noFeedOverride != block->motion.noFeedOverride ||
+        pl_data->motion.jogMotion != block->motion.jogMotion || pl_data->motion.inverseTime || pl_data->feed_rate != merge.feed_rate ||
+        pl_data->spindle != block->spindle || pl_data->spindle_speed != block->spindle_speed ||
+        pl_data->coolant.Mist != block->coolant.Mist || pl_data->coolant.Flood != block->coolant.Flood) {
+        return false;
+    }
+
+    // Check the vertices against the line from the block start to the new target, in mm.
+    // Each one must be within tolerance of that line and further along it than the one before.
+    auto  n_axis = Axes::_numberAxis;
+    float chord[MAX_N_AXIS];
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        chord[idx] = steps_to_mpos(target_steps[idx] - merge.start[idx], idx);
+    }
+    float length = convert_delta_vector_to_unit_vector(chord);
+    copyAxes(merge.vertices[merge.n_vertices], pl.position);  // The current end of the block
+    float along = 0.0f;
+    for (int i = 0; i <= merge.n_vertices; i++) {
+        float offset_sqr = 0.0f, t = 0.0f;
+        for (size_t idx = 0; idx < n_axis; idx++) {
+            float d = steps_to_mpos(merge.vertices[i][idx] - merge.start[idx], idx);
+            t += d * chord[idx];
+            offset_sqr += d * d;
+        }
+        if (t <= along || t >= length || offset_sqr - t * t > tolerance * tolerance) {
+            return false;
+        }
+        along = t;
+    }
+
+    // Rebuild the block along the extended line. The junction at its start changes a little, so
+    // its entry speed limit is recomputed. If that would cut below the entry speed that the plan
+    // already relies on, keep the block as it was.
+    plan_block_t saved = *block;
+    float        unit_vec[MAX_N_AXIS];
+    plan_compute_block_geometry(block, merge.start, target_steps, unit_vec);
+    block->programmed_rate        = block->motion.rapidMotion ? block->rapid_rate : pl_data->feed_rate;
+    block->max_junction_speed_sqr = plan_compute_junction_speed_sqr(merge.entry_unit_vec, unit_vec);
+    float nominal_speed           = plan_compute_profile_nominal_speed(block);
+    plan_compute_profile_parameters(block, nominal_speed, merge.entry_nominal_speed);
+    if (block->entry_speed_sqr > block->max_entry_speed_sqr || block->entry_speed_sqr > 2 * block->acceleration * block->millimeters) {
+        *block = saved;
+        return false;
+    }
+
+    ++merge.n_vertices;
+    pl.previous_nominal_speed = nominal_speed;
+    copyAxes(pl.previous_unit_vec, unit_vec);
+    copyAxes(pl.position, target_steps);
+    planner_recalculate();
+    return true;
+}
+
+// Rounds the corner between the newest block and a new line along unit_vec (G64). The newest block
+// is cut back from the corner, and arc chords tangent to both lines are queued, leaving the planner
+// position at the point where the new line should start. The arc stays within path_tolerance of the
+// corner, chord sag included. Returns false if the corner is left sharp, because the newest block
+// has started to execute, there is not enough room in the buffer for the arc chords, or the sharp
+// corner is already as fast as the rounded one would be.  Corners are only blended with Cartesian
+// kinematics, since the arc is built in motor space.
+static bool plan_blend_corner(plan_line_data_t* pl_data, const float* unit_vec, plan_block_t* block) {
+    if (!merge.active || block_buffer_head == block_buffer_tail || block->motion.rapidMotion || block->motion.inverseTime) {
+        return false;
+    }
+    if (!config->_kinematics->isCartesian()) {
+        return false;
+    }
+    plan_index_t block_index = plan_prev_block_index(block_buffer_head);
+    if (block_index == block_buffer_tail) {
+        return false;
+    }
+    plan_block_t* prev = &block_buffer[block_index];
+    if (prev->motion.rapidMotion) {
+        return false;
+    }
+    float tolerance = pl_data->path_tolerance - config->_arcTolerance;
+    if (tolerance <= 0.0f || block->max_junction_speed_sqr >= block->programmed_rate * block->programmed_rate) {
+        return false;
+    }
+
+    auto  n_axis  = Axes::_numberAxis;
+    float cos_phi = 0.0f;  // The angle between the directions
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        cos_phi += pl.previous_unit_vec[idx] * unit_vec[idx];
+    }
+    if (cos_phi < -0.99f) {
+        return false;  // Nearly a reversal, which leaves no room for an arc
+    }
+
+    // An arc of radius r tangent to both lines passes r * (1 / cos(phi/2) - 1) from the corner and
+    // touches the lines r * tan(phi/2) from it. Use at most half of either line, since the other
+    // end of the line might be rounded too.
+    float phi    = acosf(cos_phi);
+    float c      = cosf(0.5f * phi);
+    float radius = tolerance * c / (1.0f - c);
+    float trim   = radius * tanf(0.5f * phi);
+    float limit  = 0.5f * MIN(prev->millimeters, block->millimeters);
+    if (trim > limit) {
+        trim   = limit;
+        radius = trim / tanf(0.5f * phi);
+    }
+    if (MIN(prev->acceleration, block->acceleration) * radius <= block->max_junction_speed_sqr) {
+        return false;
+    }
+    uint32_t segments = 1;
+    if (radius > config->_arcTolerance) {
+        segments = uint32_t(ceilf(phi / (2.0f * acosf(1.0f - config->_arcTolerance / radius))));
+    }
+    // The arc chords and the new line each need a block
+    if (segments + 1 > plan_get_block_buffer_available()) {
+        return false;
+    }
+
+    // The arc runs from the corner minus trim along the old line, curving toward the part of the
+    // new direction that is normal to the old one, which works for lines in any number of axes.
+    float tangent[MAX_N_AXIS], arc_start[MAX_N_AXIS], normal[MAX_N_AXIS];
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        tangent[idx]   = pl.previous_unit_vec[idx];
+        arc_start[idx] = steps_to_mpos(pl.position[idx], idx) - trim * tangent[idx];
+        normal[idx]    = unit_vec[idx] - cos_phi * tangent[idx];
+    }
+    convert_delta_vector_to_unit_vector(normal);
+
+    // Cut the newest block back to the start of the arc. Its entry speed must still be reachable.
+    int32_t      arc_start_steps[MAX_N_AXIS];
+    float        prev_unit_vec[MAX_N_AXIS];
+    plan_block_t saved = *prev;
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        arc_start_steps[idx] = mpos_to_steps(arc_start[idx], idx);
+    }
+    plan_compute_block_geometry(prev, merge.start, arc_start_steps, prev_unit_vec);
+    if (prev->step_event_count == 0 || prev->entry_speed_sqr > 2 * prev->acceleration * prev->millimeters) {
+        *prev = saved;
+        return false;
+    }
+    merge.active = false;
+    copyAxes(pl.position, arc_start_steps);
+    copyAxes(pl.previous_unit_vec, prev_unit_vec);
+
+    plan_line_data_t arc_data   = *pl_data;
+    arc_data.motion.blendCorner = 0;
+    arc_data.path_tolerance     = 0.0f;
+    float point[MAX_N_AXIS];
+    for (uint32_t i = 1; i <= segments; i++) {
+        float theta = phi * i / segments;
+        float rise  = 1.0f - cosf(theta);
+        float sin_t = sinf(theta);
+        for (size_t idx = 0; idx < n_axis; idx++) {
+            point[idx] = arc_start[idx] + radius * (rise * normal[idx] + sin_t * tangent[idx]);
+        }
+        plan_buffer_line(point, &arc_data);
+    }
+    merge.active = false;  // Keep the new line from being merged into the last chord
+    return true;
+}
+
+static bool plan_buffer_block(float* target, plan_line_data_t* pl_data) {
     // Prepare and initialize new block. Copy relevant pl_data for block execution.
     plan_block_t* block = &block_buffer[block_buffer_head];
     memset(block, 0, sizeof(plan_block_t));  // Zero all block values.
@@ -307,16 +709,15 @@ bool plan_buffer_line(float* target, plan_line_data_t* pl_data) {
     block->spindle       = pl_data->spindle;
     block->spindle_speed = pl_data->spindle_speed;
     block->line_number   = pl_data->line_number;
-    block->is_jog        = pl_data->is_jog;
 
     // Compute and store initial move distance data.
     int32_t target_steps[MAX_N_AXIS], position_steps[MAX_N_AXIS];
-    float   unit_vec[MAX_N_AXIS], delta_mm;
+    float   unit_vec[MAX_N_AXIS];
     // Copy position data based on type of motion being planned.
     if (block->motion.systemMotion) {
         get_motor_steps(position_steps);
     } else {
-        if (!block->is_jog && Homing::unhomed_axes()) {
+        if (!block->motion.jogMotion && Homing::unhomed_axes()) {
             log_info("Unhomed axes: " << Axes::maskToNames(Homing::unhomed_axes()));
             send_alarm(ExecAlarm::Unhomed);
             return false;
@@ -325,31 +726,24 @@ bool plan_buffer_line(float* target, plan_line_data_t* pl_data) {
     }
     auto n_axis = Axes::_numberAxis;
     for (size_t idx = 0; idx < n_axis; idx++) {
-        // Calculate target position in absolute steps, number of steps for each axis, and determine max step events.
-        // Also, compute individual axes distance for move and prep unit vector calculations.
-        // NOTE: Computes true distance from converted step values.
-        target_steps[idx]       = mpos_to_steps(target[idx], idx);
-        block->steps[idx]       = labs(target_steps[idx] - position_steps[idx]);
-        block->step_event_count = MAX(block->step_event_count, block->steps[idx]);
-        delta_mm                = steps_to_mpos((target_steps[idx] - position_steps[idx]), idx);
-        unit_vec[idx]           = delta_mm;  // Store unit vector numerator
-        // Set direction bits. Bit enabled always means direction is negative.
-        if (delta_mm < 0.0) {
-            block->direction_bits |= bitnum_to_mask(idx);
-        }
+        // Calculate target position in absolute steps.
+        target_steps[idx] = mpos_to_steps(target[idx], idx);
     }
+    plan_compute_block_geometry(block, position_steps, target_steps, unit_vec);
     // Bail if this is a zero-length block. Highly unlikely to occur.
     if (block->step_event_count == 0) {
         return false;
     }
 
-    // Calculate the unit vector of the line move and the block maximum feed rate and acceleration scaled
-    // down such that no individual axes maximum values are exceeded with respect to the line direction.
-    // NOTE: This calculation assumes all axes are orthogonal (Cartesian) and works with ABC-axes,
-    // if they are also orthogonal/independent. Operates on the absolute value of the unit vector.
-    block->millimeters  = convert_delta_vector_to_unit_vector(unit_vec);
-    block->acceleration = limit_acceleration_by_axis_maximum(unit_vec);
-    block->rapid_rate   = limit_rate_by_axis_maximum(unit_vec);
+    // From here on, merging, blending and replanning change blocks that the motion prep task
+    // may be executing, so it must not load or discard blocks until the plan is consistent.
+    Stepper::PrepLock lock;
+
+    if (!block->motion.systemMotion && plan_merge_line(target_steps, pl_data)) {
+        Stepper::notify_prep();
+        return true;
+    }
+
     // Store programmed rate.
     if (block->motion.rapidMotion) {
         block->programmed_rate = block->rapid_rate;
@@ -366,53 +760,26 @@ bool plan_buffer_line(float* target, plan_line_data_t* pl_data) {
         block->entry_speed_sqr        = 0.0;
         block->max_junction_speed_sqr = 0.0;  // Starting from rest. Enforce start from zero velocity.
     } else {
-        // Compute maximum allowable entry speed at junction by centripetal acceleration approximation.
-        // Let a circle be tangent to both previous and current path line segments, where the junction
-        // deviation is defined as the distance from the junction to the closest edge of the circle,
-        // colinear with the circle center. The circular segment joining the two paths represents the
-        // path of centripetal acceleration. Solve for max velocity based on max acceleration about the
-        // radius of the circle, defined indirectly by junction deviation. This may be also viewed as
-        // path width or max_jerk in the previous Grbl version. This approach does not actually deviate
-        // from path, but used as a robust way to compute cornering speeds, as it takes into account the
-        // nonlinearities of both the junction angle and junction velocity.
-        //
-        // NOTE: If the junction deviation value is finite, the motions are executed in exact path
-        // mode (G61). If the junction deviation value is zero, the motions are executed in exact
-        // stop mode (G61.1) manner. In the future, if continuous mode (G64) is desired, the math here
-        // is exactly the same. Instead of motioning all the way to junction point, the machine will
-        // just follow the arc circle defined here. The Arduino doesn't have the CPU cycles to perform
-        // a continuous mode path, but ARM-based microcontrollers most certainly do.
-        //
-        // NOTE: The max junction speed is a fixed value, since machine acceleration limits cannot be
-        // changed dynamically during operation nor can the line move geometry. This must be kept in
-        // memory in the event of a feedrate override changing the nominal speeds of blocks, which can
-        // change the overall maximum entry speed conditions of all blocks.
-        float junction_unit_vec[MAX_N_AXIS];
-        float junction_cos_theta = 0.0;
-        for (size_t idx = 0; idx < n_axis; idx++) {
-            junction_cos_theta -= pl.previous_unit_vec[idx] * unit_vec[idx];
-            junction_unit_vec[idx] = unit_vec[idx] - pl.previous_unit_vec[idx];
-        }
-        // NOTE: Computed without any expensive trig, sin() or acos(), by trig half angle identity of cos(theta).
-        if (junction_cos_theta > 0.999999) {
-            //  For a 0 degree acute junction, just set minimum junction speed.
-            block->max_junction_speed_sqr = MINIMUM_JUNCTION_SPEED * MINIMUM_JUNCTION_SPEED;
-        } else {
-            if (junction_cos_theta < -0.999999) {
-                // Junction is a straight line or 180 degrees. Junction speed is infinite.
-                block->max_junction_speed_sqr = SOME_LARGE_VALUE;
-            } else {
-                convert_delta_vector_to_unit_vector(junction_unit_vec);
-                float junction_acceleration = limit_acceleration_by_axis_maximum(junction_unit_vec);
-                float sin_theta_d2          = sqrtf(0.5f * (1.0f - junction_cos_theta));  // Trig half angle identity. Always positive.
-                block->max_junction_speed_sqr =
-                    MAX(MINIMUM_JUNCTION_SPEED * MINIMUM_JUNCTION_SPEED,
-                        (junction_acceleration * config->_junctionDeviation * sin_theta_d2) / (1.0f - sin_theta_d2));
-            }
+        block->max_junction_speed_sqr = plan_compute_junction_speed_sqr(pl.previous_unit_vec, unit_vec);
+        if (block->motion.exactStop) {
+            block->max_junction_speed_sqr = 0.0;
+        } else if (block->motion.blendCorner && plan_blend_corner(pl_data, unit_vec, block)) {
+            // The arc ends where the new line now starts
+            plan_line_data_t line_data   = *pl_data;
+            line_data.motion.blendCorner = 0;
+            return plan_buffer_line(target, &line_data);
         }
     }
     // Block system motion from updating this data to ensure next g-code motion is computed correctly.
     if (!(block->motion.systemMotion)) {
+        // Remember how the block starts in case the next lines can be merged into it.
+        merge.active              = !block->motion.inverseTime;
+        merge.entry_nominal_speed = pl.previous_nominal_speed;
+        merge.feed_rate           = pl_data->feed_rate;
+        merge.n_vertices          = 0;
+        copyAxes(merge.start, position_steps);
+        copyAxes(merge.entry_unit_vec, pl.previous_unit_vec);
+
         float nominal_speed = plan_compute_profile_nominal_speed(block);
         plan_compute_profile_parameters(block, nominal_speed, pl.previous_nominal_speed);
         pl.previous_nominal_speed = nominal_speed;
@@ -422,12 +789,25 @@ bool plan_buffer_line(float* target, plan_line_data_t* pl_data) {
         // New block is all set. Update buffer head and next buffer head indices.
         block_buffer_head = next_buffer_head;
         next_buffer_head  = plan_next_block_index(block_buffer_head);
+        plan_blocks_added++;
         // Finish up by recalculating the plan with the new block.
         planner_recalculate();
     }
+    Stepper::notify_prep();
     return true;
 }
 
+bool plan_buffer_line(float* target, plan_line_data_t* pl_data) {
+    // The head block is not visible to the motion prep task until the head advances, so
+    // plan_buffer_block() fills it in before taking the lock.  A system motion is executed
+    // in place at the head, so it is planned entirely under the lock.
+    if (pl_data->motion.systemMotion) {
+        Stepper::PrepLock lock;
+        return plan_buffer_block(target, pl_data);
+    }
+    return plan_buffer_block(target, pl_data);
+}
+
 // Reset the planner position vectors. Called by the system abort/initialization routine.
 void plan_sync_position() {
     // TODO: For motor configurations not in the same coordinate frame as the machine position,
@@ -435,11 +815,12 @@ void plan_sync_position() {
     if (config->_axes) {
         get_motor_steps(pl.position);
     }
+    merge.active = false;
 }
 
 // Returns the number of available blocks are in the planner buffer.
 // Called from report_realtime_status
-uint8_t plan_get_block_buffer_available() {
+plan_index_t plan_get_block_buffer_available() {
     if (block_buffer_head >= block_buffer_tail) {
         return (config->_planner_blocks - 1) - (block_buffer_head - block_buffer_tail);
     } else {
@@ -450,6 +831,8 @@ uint8_t plan_get_block_buffer_available() {
 // Re-initialize buffer plan with a partially completed block, assumed to exist at the buffer tail.
 // Called after a steppers have come to a complete stop for a feed hold and the cycle is stopped.
 void plan_cycle_reinitialize() {
+    Stepper::PrepLock lock;
+
     // Re-plan from a complete stop. Reset planner entry speeds and buffer planned pointer.
     Stepper::update_plan_block_parameters();
     block_buffer_planned = block_buffer_tail;
@@ -22,23 +22,26 @@ struct PlMotion {
     uint8_t systemMotion : 1;    // Single motion. Circumvents planner state. Used by home/park.
     uint8_t noFeedOverride : 1;  // Motion does not honor feed override.
     uint8_t inverseTime : 1;     // Interprets feed rate value as inverse time when set.
+    uint8_t jogMotion : 1;       // Motion was generated by a jog command.
+    uint8_t exactStop : 1;       // Motion starts from a stop (G61.1).
+    uint8_t blendCorner : 1;     // Round the corner at the start of the motion within path_tolerance (G64).
 };
 
+// Index into the planner ring buffer, whose size is set by the planner_blocks config item.
+typedef uint16_t plan_index_t;
+
 // This struct stores a linear movement of a g-code block motion with its critical "nominal" values
 // are as specified in the source g-code.
+// NOTE: The planner buffer can hold hundreds of these, so keep the layout compact: the word-sized
+// fields come first and the byte-sized ones are packed together at the end, leaving no padding.
 struct plan_block_t {
     // Fields used by the bresenham algorithm for tracing the line
     // NOTE: Used by stepper algorithm to execute the block correctly. Do not alter these values.
 
     uint32_t steps[MAX_N_AXIS];  // Step count along each axis
     uint32_t step_event_count;   // The maximum step axis count and number of steps required to complete this block.
-    uint8_t  direction_bits;     // The direction bit set for this block (refers to *_DIRECTION_BIT in config.h)
 
-    // Block condition data to ensure correct execution depending on states and overrides.
-    PlMotion     motion;       // Block bitflag motion conditions. Copied from pl_line_data.
-    SpindleState spindle;      // Spindle enable state
-    CoolantState coolant;      // Coolant state
-    int32_t      line_number;  // Block line number for real-time reporting. Copied from pl_line_data.
+    int32_t line_number;  // Block line number for real-time reporting. Copied from pl_line_data.
 
     // Fields used by the motion planner to manage acceleration. Some of these values may be updated
     // by the stepper module during execution of special motion cases for replanning purposes.
@@ -57,7 +60,12 @@ struct plan_block_t {
     // Stored spindle speed data used by spindle overrides and resuming methods.
     SpindleSpeed spindle_speed;  // Block spindle speed. Copied from pl_line_data.
 
-    bool is_jog;
+    uint8_t direction_bits;  // The direction bit set for this block (refers to *_DIRECTION_BIT in config.h)
+
+    // Block condition data to ensure correct execution depending on states and overrides.
+    PlMotion     motion;   // Block bitflag motion conditions. Copied from pl_line_data.
+    SpindleState spindle;  // Spindle enable state
+    CoolantState coolant;  // Coolant state
 };
 
 // Planner data prototype. Must be used when passing new motions to the planner.
@@ -68,8 +76,8 @@ struct plan_line_data_t {
     SpindleState spindle;         // Spindle enable state
     CoolantState coolant;         // Coolant state
     int32_t      line_number;     // Desired line number to report when executing.
-    bool         is_jog;          // true if this was generated due to a jog command
     bool         limits_checked;  // true if soft limits already checked
+    float        path_tolerance;  // Distance in mm that merged lines may deviate from this one. 0 plans it exactly.
 };
 
 void plan_init();
@@ -81,7 +89,8 @@ void plan_reset_buffer();  // Reset buffer only.
 // Add a new linear movement to the buffer. target[MAX_N_AXIS] is the signed, absolute target position
 // in millimeters. Feed rate specifies the speed of the motion. If feed rate is inverted, the feed
 // rate is taken to mean "frequency" and would complete the operation in 1/feed_rate minutes.
-// Returns true on success.
+// Returns true on success. If the line continues the newest block within pl_data->path_tolerance,
+// and that block has not started to execute, the block is extended instead of adding a new one.
 bool plan_buffer_line(float* target, plan_line_data_t* pl_data);
 
 // Called when the current block is no longer needed. Discards the block and makes the memory
@@ -95,17 +104,39 @@ plan_block_t* plan_get_system_motion_block();
 plan_block_t* plan_get_current_block();
 
 // Increment block index with wrap-around
-static uint8_t plan_next_block_index(uint8_t block_index);
+static plan_index_t plan_next_block_index(plan_index_t block_index);
 
 // Called by step segment buffer when computing executing block velocity profile.
 float plan_get_exec_block_exit_speed_sqr();
 
+// Called by step segment buffer to look at the block after the executing one, which exits at exit_speed_sqr.
+// Returns NULL if there is none.
+plan_block_t* plan_get_exec_next_block(float& exit_speed_sqr);
+
 // Called by main program during planner calculations and step segment buffer during initialization.
 float plan_compute_profile_nominal_speed(plan_block_t* block);
 
 // Re-calculates buffered motions profile parameters upon a motion-based override change.
 void plan_update_velocity_profile_parameters();
 
+// Continues the work of plan_update_velocity_profile_parameters() on a bounded number of blocks.
+// Called from protocol_execute_realtime().
+void plan_replan_step();
+
+// The cost of override replanning, for $Planner/Stats
+struct plan_replan_stats_t {
+    uint32_t overrides;    // Override changes
+    uint32_t passes;       // Calls to plan_replan_step() that had work to do
+    uint32_t blocks;       // Blocks whose limits were recomputed
+    uint64_t total_ticks;  // CPU ticks spent in those calls
+    uint32_t max_ticks;    // Longest single call
+};
+extern plan_replan_stats_t plan_replan_stats;
+
+// Blocks added to the ring buffer.  Lines merged into an existing block are not
+// counted, and the chords of a blended corner are each counted.
+extern uint32_t plan_blocks_added;
+
 // Reset the planner position vector (in steps)
 void plan_sync_position();
 
@@ -113,7 +144,7 @@ void plan_sync_position();
 void plan_cycle_reinitialize();
 
 // Returns the number of available blocks are in the planner buffer.
-uint8_t plan_get_block_buffer_available();
+plan_index_t plan_get_block_buffer_available();
 
 // Returns the status of the block ring buffer. True, if buffer is full.
 uint8_t plan_check_full_buffer();
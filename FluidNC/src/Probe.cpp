@@ -5,12 +5,27 @@
 #include "Probe.h"
 #include "Machine/EventPin.h"
 #include "Machine/MachineConfig.h"
+#include "MotionControl.h"  // probing, probe_latched
+#include "Stepping.h"
+#include "Driver/fluidnc_gpio.h"
 
 extern void    protocol_do_probe(void* arg);
 const ArgEvent probeEvent { protocol_do_probe };
 
 Probe::ProbeEventPin::ProbeEventPin(const char* legend) : EventPin(&probeEvent, legend) {}
 
+void Probe::ProbeEventPin::init() {
+    InputPin::init();
+    if (defined() && capabilities().has(Pin::Capabilities::Native)) {
+        _gpio         = index();
+        _gpioInverted = inverted();
+    }
+}
+
+bool IRAM_ATTR Probe::ProbeEventPin::read_from_ISR() {
+    return _gpio < 0 ? _value : (gpio_read(_gpio) ^ _gpioInverted);
+}
+
 void Probe::init() {
     _probePin.init();
     _toolsetterPin.init();
@@ -30,6 +45,17 @@ bool Probe::tripped() {
     return get_state() ^ _away;
 }
 
+void IRAM_ATTR Probe::monitor_from_ISR() {
+    if (probe_latched || !((_probePin.read_from_ISR() || _toolsetterPin.read_from_ISR()) ^ _away)) {
+        return;
+    }
+    for (int axis = 0; axis < Axes::_numberAxis; axis++) {
+        probe_steps[axis] = Stepping::getSteps(axis);
+    }
+    probe_latched = true;
+    protocol_send_event_from_ISR(&probeEvent, this);
+}
+
 void Probe::validate() {}
 
 void Probe::group(Configuration::HandlerBase& handler) {
@@ -40,13 +66,16 @@ void Probe::group(Configuration::HandlerBase& handler) {
 }
 void protocol_do_probe(void* arg) {
     Probe* p = config->_probe;
-    if (p->tripped() && probing) {
+    if ((probe_latched || p->tripped()) && probing) {
         probing = false;
-        get_motor_steps(probe_steps);
+        // Prefer the position latched by the step ISR at the moment of contact
+        if (!probe_latched) {
+            get_motor_steps(probe_steps);
+        }
         if (p->_hard_stop) {
             Stepper::reset();
             plan_reset();
-            sys.state = State::Idle;
+            set_state(State::Idle);
         } else {
             protocol_do_motion_cancel();
         }
@@ -14,9 +14,19 @@ class Probe : public Configuration::Configurable {
     bool _away = false;
 
     class ProbeEventPin : public EventPin {
+        // GPIO number of a natively connected pin, which the step ISR reads directly, or -1
+        int  _gpio         = -1;
+        bool _gpioInverted = false;
+
     public:
         ProbeEventPin(const char* legend);
 
+        void init() override;
+
+        // Pin state as seen from the step ISR.  Pins that are not native GPIOs
+        // fall back to the value last reported by the pin event.
+        bool IRAM_ATTR read_from_ISR();
+
         // Differs from the EventPin version by sending the event on either edge
         void trigger(bool active) override {
             InputPin::trigger(active);
@@ -51,6 +61,11 @@ public:
     // Returns true if the probe pin is tripped, depending on the direction (away or not)
     bool IRAM_ATTR tripped();
 
+    // Called from the step ISR while probing.  On the first step that finds the
+    // probe tripped, latches the motor positions into probe_steps and sends the
+    // probe event, so the contact point does not depend on event latency.
+    void IRAM_ATTR monitor_from_ISR();
+
     ProbeEventPin& probePin() { return _probePin; }
     ProbeEventPin& toolsetterPin() { return _toolsetterPin; }
 
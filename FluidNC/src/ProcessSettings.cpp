@@ -21,7 +21,11 @@
 #include "FileStream.h"           // FileStream()
 #include "StartupLog.h"           // startupLog
 #include "Driver/gpio_dump.h"     // gpio_dump()
+#include "Driver/delay_usecs.h"   // ticks_per_us
+#include "Stepper.h"              // Stepper::stats
 #include "FileCommands.h"         // make_file_commands()
+#include "CompiledFile.h"         // CompiledFile::execute()
+#include "Job.h"                  // Job::channel()
 
 #include "FluidPath.h"
 #include "HashFS.h"
@@ -881,6 +885,53 @@ static Error setReportInterval(const char* value, AuthenticationLevel auth_level
     return Error::Ok;
 }
 
+// Selects the status report format for the channel that issued the command.
+// "compact" sends positions in motor steps and only the changed fields;
+// see report_compact_status().
+static Error setReportFormat(const char* value, AuthenticationLevel auth_level, Channel& out) {
+    if (!value) {
+        log_info_to(out, out.name() << " report format is " << (out.compactStatus() ? "compact" : "text"));
+        return Error::Ok;
+    }
+    if (!strcasecmp(value, "compact")) {
+        out.setCompactStatus(true);
+    } else if (!strcasecmp(value, "text")) {
+        out.setCompactStatus(false);
+    } else {
+        return Error::InvalidValue;
+    }
+    log_info_to(out, out.name() << " report format set to " << value);
+
+    // Send a full status report immediately so the client has all the data
+    out.notifyWco();
+    out.notifyOvr();
+
+    return Error::Ok;
+}
+
+// Turns framed input on or off for the channel that issued the command.
+// The reply gives the initial window for the sender; see Channel.h.
+// Send it as an ordinary line, since it restarts the frame sequence.
+static Error setChannelFraming(const char* value, AuthenticationLevel auth_level, Channel& out) {
+    if (!value) {
+        log_info_to(out, out.name() << " framing is " << (out.framing() ? "ON" : "OFF"));
+        return Error::Ok;
+    }
+    bool on;
+    if (!strcasecmp(value, "ON")) {
+        on = true;
+    } else if (!strcasecmp(value, "OFF")) {
+        on = false;
+    } else {
+        return Error::InvalidValue;
+    }
+    out.setFraming(on);
+    if (on) {
+        log_stream(out, "[FRAMING:" << out.frameWindow() << "]");
+    }
+    return Error::Ok;
+}
+
 static Error sendAlarm(const char* value, AuthenticationLevel auth_level, Channel& out) {
     int       intValue = value ? atoi(value) : 0;
     ExecAlarm alarm    = static_cast<ExecAlarm>(intValue);
@@ -889,8 +940,77 @@ static Error sendAlarm(const char* value, AuthenticationLevel auth_level, Channe
     return Error::Ok;
 }
 
+// $Probe/Grid=<xmin>,<ymin>,<xmax>,<ymax>,<nx>,<ny> probes an nx by ny grid
+// over that rectangle in machine coordinates, starting and retracting at the
+// current Z, and activates height map compensation.
+static Error probe_grid(const char* value, AuthenticationLevel auth_level, Channel& out) {
+    if (!value) {
+        config->_heightMap->show(out);
+        return Error::Ok;
+    }
+    float            bounds[4];
+    int32_t          counts[2];
+    std::string_view rest(value);
+    std::string_view item;
+    for (auto& bound : bounds) {
+        if (!string_util::split_prefix(rest, item, ',') || !string_util::is_float(item, bound)) {
+            log_error_to(out, "Expected xmin,ymin,xmax,ymax,nx,ny");
+            return Error::InvalidValue;
+        }
+    }
+    for (auto& count : counts) {
+        if (!string_util::split_prefix(rest, item, ',') || !string_util::is_int(item, count)) {
+            log_error_to(out, "Expected xmin,ymin,xmax,ymax,nx,ny");
+            return Error::InvalidValue;
+        }
+    }
+    return config->_heightMap->probe(bounds[0], bounds[1], bounds[2], bounds[3], counts[0], counts[1]);
+}
+
+static Error clear_grid(const char* value, AuthenticationLevel auth_level, Channel& out) {
+    config->_heightMap->clear();
+    return Error::Ok;
+}
+
 static Error showHeap(const char* value, AuthenticationLevel auth_level, Channel& out) {
     log_info("Heap free: " << xPortGetFreeHeapSize() << " min: " << heapLowWater);
+    log_info("Log buffers free: " << log_buffers_free() << "/" << log_buffers_total() << " heap lines: " << log_pool_misses
+                                  << " blocked sends: " << log_sends_blocked);
+    return Error::Ok;
+}
+
+static Error showPlannerStats(const char* value, AuthenticationLevel auth_level, Channel& out) {
+    if (value && *value) {
+        if (!string_util::equal_ignore_case(value, "clear")) {
+            return Error::InvalidValue;
+        }
+        plan_replan_stats = {};
+        return Error::Ok;
+    }
+    auto& stats = plan_replan_stats;
+    log_info_to(out,
+                "Override replans: " << stats.overrides << " passes: " << stats.passes << " blocks: " << stats.blocks
+                                     << " total us: " << stats.total_ticks / ticks_per_us << " max us: " << stats.max_ticks / ticks_per_us);
+    return Error::Ok;
+}
+
+static Error showMotionStats(const char* value, AuthenticationLevel auth_level, Channel& out) {
+    if (value && *value) {
+        if (!string_util::equal_ignore_case(value, "clear")) {
+            return Error::InvalidValue;
+        }
+        Stepper::clear_stats();
+        return Error::Ok;
+    }
+    auto& stats = Stepper::stats;
+    if (stats.low_water == UINT32_MAX) {
+        log_info_to(out, "Segment buffer low water: none of " << Stepping::_segments);
+    } else {
+        log_info_to(out, "Segment buffer low water: " << stats.low_water << " of " << Stepping::_segments);
+    }
+    log_info_to(out,
+                "Underruns: " << stats.underruns << " planner empty while moving: " << stats.planner_empty
+                              << " prep max us: " << stats.prep_max_ticks / ticks_per_us);
     return Error::Ok;
 }
 
@@ -926,6 +1046,9 @@ void make_user_commands() {
 
     new UserCommand("RM", "Macros/Run", macros_run, nullptr);
 
+    new UserCommand("PG", "Probe/Grid", probe_grid, notIdleOrAlarm);
+    new UserCommand("PGC", "Probe/Grid/Clear", clear_grid, notIdleOrAlarm);
+
     new UserCommand("H", "Home", home_all, allowConfigStates);
     new UserCommand("HX", "Home/X", home_x, allowConfigStates);
     new UserCommand("HY", "Home/Y", home_y, allowConfigStates);
@@ -949,10 +1072,14 @@ void make_user_commands() {
 
     new UserCommand("SA", "Alarm/Send", sendAlarm, anyState);
     new UserCommand("Heap", "Heap/Show", showHeap, anyState);
+    new UserCommand("PS", "Planner/Stats", showPlannerStats, anyState);
+    new UserCommand("MS", "Stats/Motion", showMotionStats, anyState);
     new UserCommand("SS", "Startup/Show", showStartupLog, anyState);
     new UserCommand("UP", "Uart/Passthrough", uartPassthrough, notIdleOrAlarm);
 
     new UserCommand("RI", "Report/Interval", setReportInterval, anyState);
+    new UserCommand("RF", "Report/Format", setReportFormat, anyState);
+    new UserCommand("CF", "Channel/Framing", setChannelFraming, anyState);
 
     new UserCommand("13", "Report/Inches", switchInchMM, notIdleOrAlarm);
 
@@ -1162,6 +1289,14 @@ Error execute_line(char* line, Channel& channel, AuthenticationLevel auth_level)
     if (state_is(State::Alarm) || state_is(State::ConfigAlarm) || state_is(State::Jog)) {
         return Error::SystemGcLock;
     }
+    // Motion records from a compiled job, which are already parsed.  Job lines are
+    // handed over one at a time, so the line came from the job that is running.
+    if (line[0] == CompiledFile::record_mark) {
+        if (!(Job::active() && CompiledFile::is_playing(Job::channel()))) {
+            return Error::InvalidStatement;
+        }
+        return CompiledFile::execute(line);
+    }
     Error result = gc_execute_line(line);
     if (result != Error::Ok && result != Error::Reset) {
         log_debug_to(channel, "Bad GCode: " << line);
@@ -20,8 +20,11 @@
 #include "SettingsDefinitions.h"  // gcode_echo
 #include "Machine/LimitPin.h"
 #include "Job.h"
+#include "CompiledFile.h"  // CompiledFile::record_mark
 #include "Driver/restart.h"
 
+#include <atomic>
+
 volatile ExecAlarm lastAlarm;  // The most recent alarm code
 
 volatile const char* unwind_cause = nullptr;
@@ -76,6 +79,7 @@ static SpindleStop spindle_stop_ovr;
 
 void protocol_reset() {
     probing                = false;
+    probe_latched          = false;
     soft_limit             = false;
     rtSafetyDoor           = false;
     spindle_stop_ovr.value = 0;
@@ -105,26 +109,92 @@ void output_loop(void* unused) {
         // Block until a message is received
         LogMessage message;
         if (xQueueReceive(message_queue, &message, portMAX_DELAY)) {
-            if (message.isString) {
-                std::string* s = static_cast<std::string*>(message.line);
-                message.channel->print_msg(message.level, s->c_str());
-                delete s;
-            } else {
-                const char* cp = static_cast<const char*>(message.line);
-                message.channel->print_msg(message.level, cp);
+            switch (message.type) {
+                case LineType::Buffer: {
+                    LogBuffer* buffer = static_cast<LogBuffer*>(message.line);
+                    message.channel->print_msg(message.level, buffer->text);
+                    log_buffer_release(buffer);
+                    break;
+                }
+                case LineType::String: {
+                    std::string* s = static_cast<std::string*>(message.line);
+                    message.channel->print_msg(message.level, s->c_str());
+                    delete s;
+                    break;
+                }
+                case LineType::Constant: {
+                    const char* cp = static_cast<const char*>(message.line);
+                    message.channel->print_msg(message.level, cp);
+                    break;
+                }
             }
         }
     }
 }
 
-Channel* activeChannel = nullptr;  // Channel associated with the input line
-
 TaskHandle_t pollingTask = nullptr;
 
-char activeLine[Channel::maxLine];
+// Input lines go from the polling task to the protocol task through a ring of
+// slots.  The poller reads a line directly into the slot at lineHead and hands
+// it over by advancing lineHead.  protocol_main_loop() executes the slot at
+// lineTail and frees it by advancing lineTail.  Each index is advanced by only
+// one task, so no lock is needed, and the channel of each slot is acked in
+// the order its lines were read.
+//
+// After a reset, the protocol task cannot drop the unexecuted lines itself,
+// because the poller may be about to hand over a line that it read before
+// the reset.  flush_lines() bumps flushRequest instead, and the poller drops
+// the lines and acknowledges by copying flushRequest to flushDone.  Until
+// then the protocol task sees no lines.
+struct LineSlot {
+    Channel* channel;
+    char     line[Channel::maxLine];
+};
+static_assert((INPUT_LINE_SLOTS & (INPUT_LINE_SLOTS - 1)) == 0, "INPUT_LINE_SLOTS must be a power of 2");
+
+static LineSlot              lineSlots[INPUT_LINE_SLOTS];
+static std::atomic<uint32_t> lineHead(0);
+static std::atomic<uint32_t> lineTail(0);
+static std::atomic<uint32_t> flushRequest(0);
+static std::atomic<uint32_t> flushDone(0);
+
+static uint32_t lines_pending() {
+    if (flushDone.load() != flushRequest.load()) {
+        return 0;
+    }
+    return lineHead.load() - lineTail.load();
+}
+
+// Drops the lines that have been read but not executed, after a reset
+static void flush_lines() {
+    ++flushRequest;
+}
+
+// Polling task side of flush_lines().  The protocol task does not advance
+// lineTail while a flush is pending, so lineHead can be moved back to it.
+static bool lines_flushed() {
+    uint32_t request = flushRequest.load();
+    if (request == flushDone.load()) {
+        return false;
+    }
+    lineHead.store(lineTail.load());
+    flushDone.store(request);
+    return true;
+}
+
+// $ and [ESP] commands can start a job or change how a channel reads its
+// input, so the lines after them must not be read until they have executed
+static bool is_barrier(const char* line) {
+    while (isspace(*line)) {
+        ++line;
+    }
+    return *line == '$' || *line == '[';
+}
 
 bool pollingPaused = false;
 void polling_loop(void* unused) {
+    bool barrier = false;  // The last line handed over is a barrier
+
     // Poll the input sources waiting for a complete line to arrive
     for (; true; /*feedLoopWDT(), */ vTaskDelay(0)) {
         // Polling is paused when xmodem is using a channel for binary upload
@@ -141,54 +211,74 @@ void polling_loop(void* unused) {
             module->poll();
         }
 
-        // If activeChannel is non-null, it means that we have recieved a line
-        // but the task running protocol_main_loop() has not yet picked it up.
-        // activeChannel is thus a form of flow control between the protocol
-        // task that processes GCode lines and other events and this task that
-        // handles IO from channels.
-        if (!activeChannel) {
-            // Job channels have priority
-            if (!Job::active()) {
+        if (lines_flushed()) {
+            barrier = false;
+        }
+
+        // The ring is flow control between the protocol task that processes
+        // GCode lines and other events and this task that handles IO from
+        // channels.  While it has room, lines are read ahead of the parser.
+        uint32_t pending = lineHead.load() - lineTail.load();
+        if (!pending) {
+            barrier = false;
+        }
+        if (barrier || pending == INPUT_LINE_SLOTS) {
+            continue;
+        }
+        LineSlot& slot = lineSlots[lineHead.load() % INPUT_LINE_SLOTS];
+
+        // Job channels have priority
+        if (!Job::active()) {
+            unwind_cause = nullptr;
+            // No job channel is active, so poll all of the serial-style
+            // channels to see if one has a line ready.
+            slot.channel = pollChannels(slot.line);
+            if (slot.channel) {
+                barrier = is_barrier(slot.line);
+                ++lineHead;
+            }
+        } else {
+            // Job lines are handed over one at a time, because executing a
+            // line can move the job's read position, nest a job or end it
+            if (pending) {
+                continue;
+            }
+            if (state_is(State::Alarm) || state_is(State::ConfigAlarm) || state_is(State::Critical)) {
+                log_debug("Unwinding from Alarm");
+                Job::abort();
                 unwind_cause = nullptr;
-                // No job channel is active, so poll all of the serial-style
-                // channels to see if one has a line ready.
-                activeChannel = pollChannels(activeLine);
-            } else {
-                if (state_is(State::Alarm) || state_is(State::ConfigAlarm) || state_is(State::Critical)) {
-                    log_debug("Unwinding from Alarm");
-                    Job::abort();
-                    unwind_cause = nullptr;
-                    continue;
-                }
-                if (unwind_cause) {
+                continue;
+            }
+            if (unwind_cause) {
+                Job::abort();
+                unwind_cause = nullptr;
+                continue;
+            }
+            // A job channel is active, so accept line-oriented input only
+            // from the job channel on top of the job stack.
+            auto channel = Job::channel();
+            auto status  = channel->pollLine(slot.line);
+            switch (status) {
+                case Error::Ok:
+                    slot.channel = channel;
+                    barrier      = true;
+                    ++lineHead;
+                    break;
+                case Error::NoData:
+                    break;
+                case Error::Eof:
+                    notifyf("Job done", "%s job sent", channel->name());
+                    log_debug(channel->name() << " job sent");
+                    Job::unnest();
+                    break;
+                default:
+                    if (Job::leader) {
+                        log_error_to(*Job::leader,
+                                     static_cast<int>(status) << " (" << errorString(status) << ") in " << channel->name()
+                                                              << " at line " << channel->lineNumber());
+                    }
                     Job::abort();
-                    unwind_cause = nullptr;
-                    continue;
-                }
-                // A job channel is active, so accept line-oriented input only
-                // from the job channel on top of the job stack.
-                auto channel = Job::channel();
-                auto status  = channel->pollLine(activeLine);
-                switch (status) {
-                    case Error::Ok:
-                        activeChannel = channel;
-                        break;
-                    case Error::NoData:
-                        break;
-                    case Error::Eof:
-                        notifyf("Job done", "%s job sent", channel->name());
-                        log_debug(channel->name() << " job sent");
-                        Job::unnest();
-                        break;
-                    default:
-                        if (Job::leader) {
-                            log_error_to(*Job::leader,
-                                         static_cast<int>(status) << " (" << errorString(status) << ") in " << channel->name()
-                                                                  << " at line " << channel->lineNumber());
-                        }
-                        Job::abort();
-                        break;
-                }
+                    break;
             }
         }
     }
@@ -280,24 +370,27 @@ void protocol_main_loop() {
     // This is also where the system idles while waiting for something to do.
     // ---------------------------------------------------------------------------------
     for (;; vTaskDelay(0)) {
-        if (activeChannel) {
+        if (lines_pending()) {
             // The input polling task has collected a line of input
-            if (gcode_echo->get()) {
-                report_echo_line_received(activeLine, allChannels);
+            LineSlot& slot = lineSlots[lineTail.load() % INPUT_LINE_SLOTS];
+            if (gcode_echo->get() && slot.line[0] != CompiledFile::record_mark) {
+                report_echo_line_received(slot.line, allChannels);
             }
 
-            Channel* out_channel = Job::leader ? Job::leader : activeChannel;
-            Error    status_code = execute_line(activeLine, *out_channel, AuthenticationLevel::LEVEL_GUEST);
+            Channel* out_channel = Job::leader ? Job::leader : slot.channel;
+            Error    status_code = execute_line(slot.line, *out_channel, AuthenticationLevel::LEVEL_GUEST);
 
             // Tell the channel that the line has been processed.
-            // If the line was aborted, the channel could be invalid
-            if (!sys.abort) {
-                activeChannel->ack(status_code);
-            }
+            // If the line was aborted, the channel could be invalid,
+            // and the lines read after it belong to the aborted stream.
+            if (sys.abort) {
+                flush_lines();
+            } else {
+                slot.channel->ack(status_code);
 
-            // Tell the input polling task that the line has been processed,
-            // so it can give us another one when available
-            activeChannel = nullptr;
+                // Tell the input polling task that the slot is free
+                ++lineTail;
+            }
         }
 
         // Auto-cycle start any queued moves.
@@ -382,6 +475,7 @@ void protocol_auto_cycle_start() {
 // limit switches, or the main program.
 void protocol_execute_realtime() {
     protocol_exec_rt_system();
+    plan_replan_step();  // Finish any override replanning a few blocks at a time
     if (sys.suspend.value) {
         protocol_exec_rt_suspend();
     }
@@ -420,6 +514,7 @@ static void protocol_do_soft_restart() {
     plan_sync_position();
     gc_sync_position();
     allChannels.flushRx();
+    flush_lines();
     report_init_message(allChannels);
     mc_init();
 
@@ -465,7 +560,7 @@ static void protocol_do_start() {
 }
 
 static void protocol_do_alarm(void* alarmVoid) {
-    lastAlarm = (ExecAlarm)((int)alarmVoid);
+    lastAlarm = (ExecAlarm)((intptr_t)alarmVoid);
     if (spindle->_off_on_alarm) {
         spindle->stop();
     }
@@ -497,6 +592,7 @@ static void protocol_do_alarm(void* alarmVoid) {
 }
 
 static void protocol_start_holding() {
+    Stepper::PrepLock lock;
     if (!(sys.suspend.bit.motionCancel || sys.suspend.bit.jogCancel)) {  // Block, if already holding.
         sys.step_control = {};
         Stepper::update_plan_block_parameters();
@@ -505,6 +601,7 @@ static void protocol_start_holding() {
 }
 
 static void protocol_cancel_jogging() {
+    Stepper::PrepLock lock;
     if (!(sys.suspend.bit.motionCancel || sys.suspend.bit.jogCancel)) {  // Block, if already holding.
         sys.step_control = {};
         Stepper::update_plan_block_parameters();
@@ -617,6 +714,7 @@ static void protocol_do_safety_door() {
             if (!sys.suspend.bit.jogCancel && sys.suspend.bit.initiateRestore) {  // Actively restoring
                 // Set hold and reset appropriate control flags to restart parking sequence.
                 if (sys.step_control.executeSysMotion) {
+                    Stepper::PrepLock lock;
                     Stepper::update_plan_block_parameters();  // Notify stepper module to recompute for hold deceleration.
                     sys.step_control                  = {};
                     sys.step_control.executeHold      = true;
@@ -687,11 +785,12 @@ void protocol_cancel_disable_steppers() {
 static void protocol_do_initiate_cycle() {
     // log_debug("protocol_do_initiate_cycle " << state_name());
     // Start cycle only if queued motions exist in planner buffer and the motion is not canceled.
+    Stepper::PrepLock lock;
     sys.step_control = {};  // Restore step control to normal operation
     plan_block_t* pb;
     if ((pb = plan_get_current_block()) && !sys.suspend.bit.motionCancel) {
         sys.suspend.value = 0;  // Break suspend state.
-        set_state(pb->is_jog ? State::Jog : State::Cycle);
+        set_state(pb->motion.jogMotion ? State::Jog : State::Cycle);
         Stepper::prep_buffer();  // Initialize step segment buffer before beginning cycle.
         Stepper::wake_up();
     } else {                    // Otherwise, do nothing. Set and resume IDLE state.
@@ -701,6 +800,7 @@ static void protocol_do_initiate_cycle() {
 }
 static void protocol_initiate_homing_cycle() {
     // log_debug("protocol_initiate_homing_cycle " << state_name());
+    Stepper::PrepLock lock;
     sys.step_control                  = {};    // Restore step control to normal operation
     sys.suspend.value                 = 0;     // Break suspend state.
     sys.step_control.executeSysMotion = true;  // Set to execute homing motion and clear existing flags.
@@ -794,6 +894,7 @@ void protocol_do_cycle_stop() {
             if (!soft_limit && !sys.suspend.bit.jogCancel) {
                 // Hold complete. Set to indicate ready to resume.  Remain in HOLD or DOOR states until user
                 // has issued a resume command or reset.
+                Stepper::PrepLock lock;
                 plan_cycle_reinitialize();
                 if (sys.step_control.executeHold) {
                     sys.suspend.bit.holdComplete = true;
@@ -813,6 +914,7 @@ void protocol_do_cycle_stop() {
             // Motion complete. Includes CYCLE/JOG/HOMING states and jog cancel/motion cancel/soft limit events.
             // NOTE: Motion and jog cancel both immediately return to idle after the hold completes.
             if (sys.suspend.bit.jogCancel) {  // For jog cancel, flush buffers and sync positions.
+                Stepper::PrepLock lock;
                 sys.step_control = {};
                 plan_reset();
                 Stepper::reset();
@@ -878,7 +980,9 @@ void protocol_exec_rt_system() {
         case State::SafetyDoor:
         case State::Homing:
         case State::Jog:
-            Stepper::prep_buffer();
+            if (!Stepper::prep_task_running()) {
+                Stepper::prep_buffer();
+            }
             break;
     }
 }
@@ -903,6 +1007,7 @@ static void protocol_manage_spindle() {
                 report_feedback_message(Message::SpindleRestore);
                 if (spindle->isRateAdjusted()) {
                     // When in laser mode, defer turn on until cycle starts
+                    Stepper::PrepLock lock;
                     sys.step_control.updateSpindleSpeed = true;
                 } else {
                     config->_parking->restore_spindle();
@@ -917,6 +1022,7 @@ static void protocol_manage_spindle() {
     } else {
         // Handles spindle state during hold. NOTE: Spindle speed overrides may be altered during hold state.
         // NOTE: sys.step_control.updateSpindleSpeed is automatically reset upon resume in step generator.
+        Stepper::PrepLock lock;
         if (sys.step_control.updateSpindleSpeed) {
             config->_parking->restore_spindle();
             sys.step_control.updateSpindleSpeed = false;
@@ -1000,7 +1106,7 @@ static void protocol_exec_rt_suspend() {
 }
 
 static void protocol_do_feed_override(void* incrementvp) {
-    int increment = int(incrementvp);
+    int increment = int(intptr_t(incrementvp));
     int percent;
     if (increment == FeedOverride::Default) {
         percent = FeedOverride::Default;
@@ -1020,7 +1126,7 @@ static void protocol_do_feed_override(void* incrementvp) {
 }
 
 static void protocol_do_rapid_override(void* percentvp) {
-    int percent = int(percentvp);
+    int percent = int(intptr_t(percentvp));
     if (percent != sys.r_override) {
         sys.r_override = percent;
         update_velocities();
@@ -1030,7 +1136,7 @@ static void protocol_do_rapid_override(void* percentvp) {
 
 static void protocol_do_spindle_override(void* incrementvp) {
     int percent;
-    int increment = int(incrementvp);
+    int increment = int(intptr_t(incrementvp));
     if (increment == SpindleSpeedOverride::Default) {
         percent = SpindleSpeedOverride::Default;
     } else {
@@ -1042,8 +1148,11 @@ static void protocol_do_spindle_override(void* incrementvp) {
         }
     }
     if (percent != sys.spindle_speed_ovr) {
-        sys.spindle_speed_ovr               = percent;
-        sys.step_control.updateSpindleSpeed = true;
+        {
+            Stepper::PrepLock lock;
+            sys.spindle_speed_ovr               = percent;
+            sys.step_control.updateSpindleSpeed = true;
+        }
         gc_ovr_changed();
 
         // If spindle is on, tell it the RPM has been overridden
@@ -1056,7 +1165,7 @@ static void protocol_do_spindle_override(void* incrementvp) {
 }
 
 static void protocol_do_accessory_override(void* type) {
-    switch (int(type)) {
+    switch (int(intptr_t(type))) {
         case AccessoryOverride::SpindleStopOvr:
             // Spindle stop override allowed only while in HOLD state.
             if (state_is(State::Hold)) {
@@ -1174,6 +1283,7 @@ xQueueHandle event_queue;
 void protocol_init() {
     event_queue   = xQueueCreate(10, sizeof(EventItem));
     message_queue = xQueueCreate(10, sizeof(LogMessage));
+    log_buffers_init();
 }
 
 void IRAM_ATTR protocol_send_event_from_ISR(const Event* evt, void* arg) {
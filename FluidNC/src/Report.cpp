@@ -30,11 +30,13 @@
 #include "WebUI/NotificationsService.h"  // WebUI::notificationsService
 #include "InputFile.h"
 #include "Job.h"
+#include "Driver/delay_usecs.h"  // ticks_per_us
 
 #include <map>
 #include <freertos/task.h>
 #include <cstring>
 #include <cstdio>
+#include <cmath>
 #include <cstdarg>
 #include <sstream>
 #include <iomanip>
@@ -79,27 +81,30 @@ Counter report_wco_counter = 0;
 static const int coordStringLen = 20;
 static const int axesStringLen  = coordStringLen * MAX_N_AXIS;
 
+// Returns the number of decimal places for reporting an axis value,
+// converting the value to inches if necessary
+static int report_util_axis_decimals(size_t idx, float& value) {
+    if (idx >= A_AXIS && idx <= C_AXIS) {
+        // Rotary axes are in degrees so mm vs inch is not
+        // relevant.  Three decimal places is probably overkill
+        // for rotary axes but we use 3 in case somebody wants
+        // to use ABC as linear axes in mm.
+        return 3;
+    }
+    if (config->_reportInches) {
+        value /= MM_PER_INCH;
+        return 4;  // Report inches to 4 decimal places
+    }
+    return 3;  // Report mm to 3 decimal places
+}
+
 // Sends the axis values to the output channel
 static std::string report_util_axis_values(const float* axis_value) {
     std::ostringstream msg;
     auto               n_axis = Axes::_numberAxis;
     for (size_t idx = 0; idx < n_axis; idx++) {
-        int   decimals;
-        float value = axis_value[idx];
-        if (idx >= A_AXIS && idx <= C_AXIS) {
-            // Rotary axes are in degrees so mm vs inch is not
-            // relevant.  Three decimal places is probably overkill
-            // for rotary axes but we use 3 in case somebody wants
-            // to use ABC as linear axes in mm.
-            decimals = 3;
-        } else {
-            if (config->_reportInches) {
-                value /= MM_PER_INCH;
-                decimals = 4;  // Report inches to 4 decimal places
-            } else {
-                decimals = 3;  // Report mm to 3 decimal places
-            }
-        }
+        float value    = axis_value[idx];
+        int   decimals = report_util_axis_decimals(idx, value);
         msg << std::fixed << std::setprecision(decimals) << value;
         if (idx < (n_axis - 1)) {
             msg << ",";
@@ -108,6 +113,20 @@ static std::string report_util_axis_values(const float* axis_value) {
     return msg.str();
 }
 
+// Writes the axis values directly to a stream, without building a
+// temporary string.  Used by the frequent status reports.
+static void report_util_axis_values(Print& out, const float* axis_value) {
+    auto n_axis = Axes::_numberAxis;
+    for (size_t idx = 0; idx < n_axis; idx++) {
+        float value    = axis_value[idx];
+        int   decimals = report_util_axis_decimals(idx, value);
+        out.print(value, decimals);
+        if (idx < (n_axis - 1)) {
+            out.print(',');
+        }
+    }
+}
+
 std::map<Message, const char*> MessageText = {
     { Message::CriticalEvent, "Reset to continue" },
     { Message::AlarmLock, "'$H'|'$X' to unlock" },
@@ -317,6 +336,22 @@ void report_gcode_modes(Channel& channel) {
             break;
     }
 
+    // G61 is the default and is not reported, which keeps the report the same as before
+    switch (gc_state.modal.control) {
+        case ControlMode::ExactStop:
+            msg << " G61.1";
+            break;
+        case ControlMode::Continuous:
+            if (gc_state.modal.units == Units::Inches) {
+                msg << " G64 P" << std::fixed << std::setprecision(4) << gc_state.path_tolerance / MM_PER_INCH;
+            } else {
+                msg << " G64 P" << std::fixed << std::setprecision(3) << gc_state.path_tolerance;
+            }
+            break;
+        default:
+            break;
+    }
+
     //report_util_gcode_modes_M();
     switch (gc_state.modal.program_flow) {
         case ProgramFlow::Running:
@@ -505,12 +540,169 @@ void report_recompute_pin_string() {
 // Define this to do something if a debug request comes in over serial
 void report_realtime_debug() {}
 
+// A key frame, containing every field, is sent at this interval so that a client
+// that missed a report, or has just connected, can resynchronize.
+static const uint32_t compactKeyFrameInterval = 50;
+
+// Sends a comma-separated list of per-axis values if any of them changed,
+// leaving out the values that did not change, and updates the last values.
+static void report_compact_axes(Print& msg, const char* tag, const int32_t* values, int32_t* last, bool key) {
+    auto n_axis  = Axes::_numberAxis;
+    bool changed = key;
+    for (size_t axis = 0; axis < n_axis && !changed; axis++) {
+        changed = values[axis] != last[axis];
+    }
+    if (!changed) {
+        return;
+    }
+    msg << "|" << tag << ":";
+    for (size_t axis = 0; axis < n_axis; axis++) {
+        if (axis) {
+            msg << ",";
+        }
+        if (key || values[axis] != last[axis]) {
+            msg << values[axis];
+            last[axis] = values[axis];
+        }
+    }
+}
+
+// Sends a list of integer values if any of them changed
+static void report_compact_values(Print& msg, const char* tag, const int32_t* values, int32_t* last, size_t n, bool key) {
+    if (!key && !memcmp(values, last, n * sizeof(*values))) {
+        return;
+    }
+    msg << "|" << tag << ":";
+    for (size_t i = 0; i < n; i++) {
+        if (i) {
+            msg << ",";
+        }
+        msg << values[i];
+    }
+    memcpy(last, values, n * sizeof(*values));
+}
+
+// Segment buffer low water mark (-1 if not measured yet), underruns, planner empty events
+// and the longest prep_buffer() time in microseconds, as in $Stats/Motion
+static void motion_stats(int32_t* ms) {
+    auto& stats = Stepper::stats;
+    ms[0]       = stats.low_water == UINT32_MAX ? -1 : int32_t(stats.low_water);
+    ms[1]       = stats.underruns;
+    ms[2]       = stats.planner_empty;
+    ms[3]       = stats.prep_max_ticks / ticks_per_us;
+}
+
+// Compact status report, for clients that poll at high rates.  Positions are
+// integer counts of axis steps, with no float formatting, and delta frames
+// contain only the fields that changed:
+//
+//   <K|Run|S:800,-1600,0|W:0,0,-400|Bf:15,128|FS:1500,12000|Ov:100,100,100|A:SF>
+//   <D|S:812,-1624,>
+//
+// K marks a key frame with every field, D a delta frame.  An empty list entry
+// means that axis did not change.  The field names follow the text report:
+// S is MPos in steps, W is WCO in steps, and Bf, Ln, FS, Pn, Ov, A and Ms are
+// as usual, except that FS values are integers.  With Cartesian kinematics S is
+// read straight from the motor step counts.  Otherwise those are in motor space,
+// so S is MPos converted to steps, like W.
+static void report_compact_status(Channel& channel) {
+    auto& last = channel._lastStatus;
+    bool  key  = channel._statusFrames == 0;
+    if (++channel._statusFrames == compactKeyFrameInterval) {
+        channel._statusFrames = 0;
+    }
+
+    LogStream msg(channel, key ? "<K" : "<D");
+
+    const char* state = state_name();
+    if (key || state != last.state) {
+        msg << "|" << state;
+        last.state = state;
+    }
+
+    auto    n_axis = Axes::_numberAxis;
+    int32_t values[MAX_N_AXIS];
+
+    if (config->_kinematics->isCartesian()) {
+        get_motor_steps(values);
+    } else {
+        float* mpos = get_mpos();
+        for (size_t axis = 0; axis < n_axis; axis++) {
+            values[axis] = lroundf(mpos[axis] * config->_axes->_axis[axis]->_stepsPerMm);
+        }
+    }
+    report_compact_axes(msg, "S", values, last.steps, key);
+
+    float* wco = get_wco();
+    for (size_t axis = 0; axis < n_axis; axis++) {
+        values[axis] = lroundf(wco[axis] * config->_axes->_axis[axis]->_stepsPerMm);
+    }
+    report_compact_axes(msg, "W", values, last.wco, key);
+
+    if (bits_are_true(status_mask->get(), RtStatus::Buffer)) {
+        int32_t bf[2] = { plan_get_block_buffer_available(), channel.rx_buffer_available() };
+        report_compact_values(msg, "Bf", bf, last.bf, 2, key);
+    }
+
+    if (bits_are_true(status_mask->get(), RtStatus::MotionStats)) {
+        int32_t ms[4];
+        motion_stats(ms);
+        report_compact_values(msg, "Ms", ms, last.ms, 4, key);
+    }
+
+    if (config->_useLineNumbers) {
+        plan_block_t* cur_block = plan_get_current_block();
+        int32_t       ln        = cur_block ? cur_block->line_number : 0;
+        report_compact_values(msg, "Ln", &ln, &last.ln, 1, key);
+    }
+
+    float rate = Stepper::get_realtime_rate();
+    if (config->_reportInches) {
+        rate /= MM_PER_INCH;
+    }
+    int32_t fs[2] = { int32_t(rate), int32_t(sys.spindle_speed) };
+    report_compact_values(msg, "FS", fs, last.fs, 2, key);
+
+    if (key || report_pin_string != last.pins) {
+        msg << "|Pn:" << report_pin_string;
+        last.pins = report_pin_string;
+    }
+
+    int32_t ov[3] = { sys.f_override, sys.r_override, sys.spindle_speed_ovr };
+    report_compact_values(msg, "Ov", ov, last.ov, 3, key);
+
+    char         accessories[4] = { 0 };
+    char*        ap             = accessories;
+    SpindleState sp_state       = spindle->get_state();
+    CoolantState coolant        = config->_coolant->get_state();
+    if (sp_state == SpindleState::Cw) {
+        *ap++ = 'S';
+    } else if (sp_state == SpindleState::Ccw) {
+        *ap++ = 'C';
+    }
+    if (coolant.Flood) {
+        *ap++ = 'F';
+    }
+    if (coolant.Mist) {
+        *ap++ = 'M';
+    }
+    if (key || last.accessories != accessories) {
+        msg << "|A:" << accessories;
+        last.accessories = accessories;
+    }
+    msg << ">";
+}
+
 // Prints real-time data. This function grabs a real-time snapshot of the stepper subprogram
 // and the actual location of the CNC machine. Users may change the following function to their
 // specific needs, but the desired real-time data report must be as short as possible. This is
 // requires as it minimizes the computational overhead to keep running smoothly,
 // especially during g-code programs with fast, short line segments and high frequency reports (5-20Hz).
 void report_realtime_status(Channel& channel) {
+    if (channel.compactStatus()) {
+        report_compact_status(channel);
+        return;
+    }
     LogStream msg(channel, "<");
     msg << state_name();
 
@@ -522,7 +714,7 @@ void report_realtime_status(Channel& channel) {
         msg << "|WPos:";
         mpos_to_wpos(print_position);
     }
-    msg << report_util_axis_values(print_position).c_str();
+    report_util_axis_values(msg, print_position);
 
     // Returns planner and serial read buffer states.
 
@@ -530,6 +722,13 @@ void report_realtime_status(Channel& channel) {
         msg << "|Bf:" << plan_get_block_buffer_available() << "," << channel.rx_buffer_available();
     }
 
+    // Segment buffer health, to tell a slow sender from a busy CPU
+    if (bits_are_true(status_mask->get(), RtStatus::MotionStats)) {
+        int32_t ms[4];
+        motion_stats(ms);
+        msg << "|Ms:" << ms[0] << "," << ms[1] << "," << ms[2] << "," << ms[3];
+    }
+
     if (config->_useLineNumbers) {
         // Report current line number
         plan_block_t* cur_block = plan_get_current_block();
@@ -569,7 +768,8 @@ void report_realtime_status(Channel& channel) {
         if (report_ovr_counter == 0) {
             report_ovr_counter = 1;  // Set override on next report.
         }
-        msg << "|WCO:" << report_util_axis_values(get_wco()).c_str();
+        msg << "|WCO:";
+        report_util_axis_values(msg, get_wco());
     }
 
     if (report_ovr_counter > 0) {
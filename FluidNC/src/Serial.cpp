@@ -115,7 +115,11 @@ void AllChannels::listChannels(Channel& out) {
     _mutex_general.lock();
     std::string retval;
     for (auto channel : _channelq) {
-        log_stream(out, channel->name());
+        if (channel->rxOverruns()) {
+            log_stream(out, channel->name() << " rx overruns: " << channel->rxOverruns());
+        } else {
+            log_stream(out, channel->name());
+        }
     }
     _mutex_general.unlock();
 }
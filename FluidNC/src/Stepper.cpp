@@ -15,12 +15,23 @@
 #include "StepperPrivate.h"
 #include "Planner.h"
 #include "Protocol.h"
+#include "InputShaper.h"
+#include "Driver/delay_usecs.h"  // getCpuTicks
 #include <esp_attr.h>  // IRAM_ATTR
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include <cmath>
+#include <mutex>
+#include <algorithm>
 
 using namespace Stepper;
 
-static bool awake = false;
+static bool awake           = false;
+static bool prepped_at_rest = true;  // The last prepped segment ends with the motion stopped
+
+// Speeds below this at the end of a block count as stopped, since deceleration computed in
+// floating point may not reach exactly zero
+const float REST_SPEED = MINIMUM_FEED_RATE;  // mm/min
 
 // Stores the planner block Bresenham algorithm execution data for the segments in the segment
 // buffer. Normally, this buffer is partially in-use, but, for the worst case scenario, it will
@@ -47,9 +58,38 @@ struct segment_t {
     uint8_t      amass_level;        // AMASS level for the ISR to execute this segment
     uint32_t     spindle_dev_speed;  // Spindle speed scaled to the device
     SpindleSpeed spindle_speed;      // Spindle speed in GCode units
+    bool         at_rest;            // The motion is planned to be stopped at the end of this segment
 };
 static segment_t* segment_buffer = nullptr;
 
+static TaskHandle_t         prepTask = nullptr;
+static std::recursive_mutex prepMutex;
+
+// The states in which the step segment buffer is reloaded
+static bool prep_state() {
+    switch (sys.state) {
+        case State::Cycle:
+        case State::Hold:
+        case State::SafetyDoor:
+        case State::Homing:
+        case State::Jog:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Runs above the main loop on the same core.  It wakes when the planner adds a block and
+// otherwise every tick, which is well inside the time the segment buffer holds.
+static void prep_loop(void* unused) {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, 1);
+        if (awake && prep_state()) {
+            Stepper::prep_buffer();
+        }
+    }
+}
+
 void Stepper::init() {
     if (st_block_buffer) {
         delete[] st_block_buffer;
@@ -59,6 +99,39 @@ void Stepper::init() {
         delete[] segment_buffer;
     }
     segment_buffer = new segment_t[Stepping::_segments];
+
+    if (Stepping::_prepTask && !prepTask) {
+        xTaskCreatePinnedToCore(prep_loop,        // task
+                                "motionPrep",     // name for task
+                                8192,             // size of task stack
+                                0,                // parameters
+                                3,                // priority, above the main loop and the output task
+                                &prepTask,        // task handle
+                                MOTION_TASK_CORE  // core
+        );
+    }
+}
+
+bool Stepper::prep_task_running() {
+    return prepTask != nullptr;
+}
+
+void Stepper::notify_prep() {
+    if (prepTask) {
+        xTaskNotifyGive(prepTask);
+    }
+}
+
+void Stepper::lock() {
+    if (prepTask) {
+        prepMutex.lock();
+    }
+}
+
+void Stepper::unlock() {
+    if (prepTask) {
+        prepMutex.unlock();
+    }
 }
 
 // Stepper ISR data struct. Contains the running data for the main stepper ISR.
@@ -77,6 +150,7 @@ typedef struct {
     uint8_t              exec_block_index;  // Tracks the current st_block index. Change indicates new block.
     volatile st_block_t* exec_block;        // Pointer to the block data for the segment being executed
     volatile segment_t*  exec_segment;      // Pointer to the segment being executed
+    bool                 moving;            // The last executed segment did not end at rest
 } stepper_t;
 static stepper_t st;
 
@@ -115,12 +189,31 @@ typedef struct {
     float accelerate_until;  // Acceleration ramp end measured from end of block (mm)
     float decelerate_after;  // Deceleration ramp start measured from end of block (mm)
 
+    bool  s_curve;        // Acceleration and deceleration ramps of this profile are S-curves
+    float ramp_v0;        // Speed at start of the S-curve ramp (mm/min)
+    float ramp_dv;        // Speed change over the S-curve ramp (mm/min)
+    float ramp_start_mm;  // S-curve ramp start measured from end of block (mm)
+    float ramp_mm;        // Length of the S-curve ramp (mm)
+    float ramp_duration;  // Duration of the S-curve ramp (min)
+    float ramp_time;      // Time elapsed in the S-curve ramp (min)
+    float ramp_a0;        // Acceleration at the start of the S-curve ramp (mm/min^2)
+    float ramp_a1;        // Acceleration at the end of the S-curve ramp (mm/min^2)
+    float ramp_peak;      // Acceleration between the jerk phases of the S-curve ramp (mm/min^2)
+    float ramp_rise;      // Duration of each jerk phase of the S-curve ramp (min)
+    bool  ramp_shaped;    // The S-curve ramp is shaped by the input shaper instead of jerk phases
+    float exit_accel;     // Acceleration at the end of the last block, which the next one continues (mm/min^2)
+
+    AxisMask shaper_axes;  // Moving axes that the input shaper was built for
+
     float        inv_rate;  // Used by PWM laser mode to speed up segment calculations.
     SpindleSpeed current_spindle_speed;
 
 } st_prep_t;
 static st_prep_t prep;
 
+// Cascade of the input shapers of the axes that move in the block being prepped
+static InputShaper shaper;
+
 /* "The Stepper Driver Interrupt" - This timer interrupt is the workhorse, employing
    the venerable Bresenham line algorithm to manage and exactly synchronize multi-axis moves.
    Unlike the popular DDA algorithm, the Bresenham algorithm is not susceptible to numerical
@@ -181,10 +274,120 @@ void IRAM_ATTR Stepper::stop_stepping() {
     st.step_outbits = 0;
 }
 
+// The critical section masks interrupts up to the step timer's level on this core.  The pin
+// interrupts and the step timer are both allocated from setup(), so they share a core and
+// the step ISR can neither preempt this nor be part way through a batch.  With awake clear,
+// a step interrupt that was already pending does nothing.
+static portMUX_TYPE stop_mux = portMUX_INITIALIZER_UNLOCKED;
+
+void IRAM_ATTR Stepper::stop_from_ISR() {
+    portENTER_CRITICAL_ISR(&stop_mux);
+    awake = false;
+    Stepping::stopTimer();
+    stop_stepping();
+    portEXIT_CRITICAL_ISR(&stop_mux);
+}
+
 #ifdef DEBUG_STEPPER_ISR
 uint32_t Stepper::isr_count;  // for debugging only
 #endif
 
+Stepper::Stats Stepper::stats = { UINT32_MAX, 0, 0, 0 };
+
+void Stepper::clear_stats() {
+    stats.low_water      = UINT32_MAX;
+    stats.underruns      = 0;
+    stats.planner_empty  = 0;
+    stats.prep_max_ticks = 0;
+}
+
+// The per-step code below is templated on the number of axes so that the
+// axis loops can be unrolled for the common machine configurations.  N is
+// the axis count, or 0 to use Axes::_numberAxis at run time.
+// select_pulse_func() picks the instance once at startup.
+
+// If there is no step segment, attempt to pop one from the stepper buffer.
+// Returns false if the segment buffer is empty.
+template <int N>
+static bool IRAM_ATTR load_segment() {
+    if (st.exec_segment != NULL) {
+        return true;
+    }
+    // Anything in the buffer? If so, load and initialize next step segment.
+    if (segment_buffer_head == segment_buffer_tail) {
+        if (st.moving) {
+            // prep_buffer() did not keep up, so the motors stop abruptly
+            Stepper::stats.underruns++;
+            st.moving = false;
+        }
+        return false;
+    }
+    const int n_axis = N ? N : Axes::_numberAxis;
+
+    // Initialize new step segment and load number of steps to execute
+    st.exec_segment = &segment_buffer[segment_buffer_tail];
+    // Initialize step segment timing per step and load number of steps to execute.
+    Stepping::setTimerPeriod(st.exec_segment->isrPeriod);
+    st.step_count = st.exec_segment->n_step;  // NOTE: Can sometimes be zero when moving slow.
+    // If the new segment starts a new planner block, initialize stepper variables and counters.
+    // NOTE: When the segment data index changes, this indicates a new planner block.
+    if (st.exec_block_index != st.exec_segment->st_block_index) {
+        st.exec_block_index = st.exec_segment->st_block_index;
+        st.exec_block       = &st_block_buffer[st.exec_block_index];
+        // Initialize Bresenham line and distance counters
+        for (int axis = 0; axis < n_axis; axis++) {
+            st.counter[axis] = st.exec_block->step_event_count >> 1;
+        }
+    }
+
+    st.dir_outbits = st.exec_block->direction_bits;
+    // Adjust Bresenham axis increment counters according to AMASS level.
+    for (int axis = 0; axis < n_axis; axis++) {
+        st.steps[axis] = st.exec_block->steps[axis] >> st.exec_segment->amass_level;
+    }
+    // Set real-time spindle output as segment is loaded, just prior to the first step.
+    spindle->setSpeedfromISR(st.exec_segment->spindle_dev_speed);
+    return true;
+}
+
+// Segment buffer empty. Shutdown.
+static void IRAM_ATTR end_of_motion() {
+    Stepper::stop_stepping();
+    if (!state_is(State::Jog)) {  // added to prevent ... jog after probing crash
+        // Ensure pwm is set properly upon completion of rate-controlled motion.
+        if (st.exec_block != NULL && st.exec_block->is_pwm_rate_adjusted) {
+            spindle->setSpeedfromISR(0);
+        }
+    }
+
+    protocol_send_event_from_ISR(&cycleStopEvent);
+    awake = false;
+    Stepping::unstep();
+}
+
+// Execute step displacement profile by Bresenham line algorithm
+template <int N>
+static uint8_t IRAM_ATTR next_step_bits() {
+    const int      n_axis           = N ? N : Axes::_numberAxis;
+    const uint32_t step_event_count = st.exec_block->step_event_count;
+    uint8_t        bits             = 0;
+    for (int axis = 0; axis < n_axis; axis++) {
+        st.counter[axis] += st.steps[axis];
+        if (st.counter[axis] > step_event_count) {
+            set_bitnum(bits, axis);
+            st.counter[axis] -= step_event_count;
+        }
+    }
+    return bits;
+}
+
+// Segment is complete. Discard current segment and advance segment indexing.
+static void IRAM_ATTR end_of_segment() {
+    st.moving           = !st.exec_segment->at_rest;
+    st.exec_segment     = NULL;
+    segment_buffer_tail = segment_buffer_tail >= (Stepping::_segments - 1) ? 0 : segment_buffer_tail + 1;
+}
+
 /**
  * This phase of the ISR should ONLY create the pulses for the steppers.
  * This prevents jitter caused by the interval between the start of the
@@ -193,7 +396,8 @@ uint32_t Stepper::isr_count;  // for debugging only
  * is to keep pulse timing as regular as possible.
  * Returns true if step interrupts should continue
  */
-bool IRAM_ATTR Stepper::pulse_func() {
+template <int N>
+static bool IRAM_ATTR pulse_n() {
 #ifdef DEBUG_STEPPER_ISR
     isr_count++;
 #endif
@@ -201,75 +405,105 @@ bool IRAM_ATTR Stepper::pulse_func() {
     if (!awake) {
         return false;
     }
-    auto n_axis = Axes::_numberAxis;
+
+    if (probing) {
+        config->_probe->monitor_from_ISR();
+    }
 
     Stepping::step(st.step_outbits, st.dir_outbits);
     st.step_outbits = 0;
 
-    // If there is no step segment, attempt to pop one from the stepper buffer
-    if (st.exec_segment == NULL) {
-        // Anything in the buffer? If so, load and initialize next step segment.
-        if (segment_buffer_head != segment_buffer_tail) {
-            // Initialize new step segment and load number of steps to execute
-            st.exec_segment = &segment_buffer[segment_buffer_tail];
-            // Initialize step segment timing per step and load number of steps to execute.
-            Stepping::setTimerPeriod(st.exec_segment->isrPeriod);
-            st.step_count = st.exec_segment->n_step;  // NOTE: Can sometimes be zero when moving slow.
-            // If the new segment starts a new planner block, initialize stepper variables and counters.
-            // NOTE: When the segment data index changes, this indicates a new planner block.
-            if (st.exec_block_index != st.exec_segment->st_block_index) {
-                st.exec_block_index = st.exec_segment->st_block_index;
-                st.exec_block       = &st_block_buffer[st.exec_block_index];
-                // Initialize Bresenham line and distance counters
-                for (int axis = 0; axis < n_axis; axis++) {
-                    st.counter[axis] = st.exec_block->step_event_count >> 1;
-                }
-            }
+    if (!load_segment<N>()) {
+        end_of_motion();
+        return false;  // Nothing to do but exit.
+    }
 
-            st.dir_outbits = st.exec_block->direction_bits;
-            // Adjust Bresenham axis increment counters according to AMASS level.
-            for (int axis = 0; axis < n_axis; axis++) {
-                st.steps[axis] = st.exec_block->steps[axis] >> st.exec_segment->amass_level;
-            }
-            // Set real-time spindle output as segment is loaded, just prior to the first step.
-            spindle->setSpeedfromISR(st.exec_segment->spindle_dev_speed);
-        } else {
-            // Segment buffer empty. Shutdown.
-            stop_stepping();
-            if (!state_is(State::Jog)) {  // added to prevent ... jog after probing crash
-                // Ensure pwm is set properly upon completion of rate-controlled motion.
-                if (st.exec_block != NULL && st.exec_block->is_pwm_rate_adjusted) {
-                    spindle->setSpeedfromISR(0);
-                }
-            }
+    st.step_outbits = next_step_bits<N>();
 
-            protocol_send_event_from_ISR(&cycleStopEvent);
-            awake = false;
-            Stepping::unstep();
-            return false;  // Nothing to do but exit.
-        }
+    st.step_count--;  // Decrement step events count
+    if (st.step_count == 0) {
+        end_of_segment();
     }
 
-    for (int axis = 0; axis < n_axis; axis++) {
-        // Execute step displacement profile by Bresenham line algorithm
-        st.counter[axis] += st.steps[axis];
-        if (st.counter[axis] > st.exec_block->step_event_count) {
-            set_bitnum(st.step_outbits, axis);
-            st.counter[axis] -= st.exec_block->step_event_count;
-        }
+    Stepping::unstep();
+    return true;
+}
+
+/**
+ * Batched version of pulse_func() for engines that time the pulses in
+ * hardware (RMT, I2S streaming).  One call hands the engine up to
+ * startBatch() step events, which the engine emits one step period apart.
+ * Computing the Bresenham bits for a whole batch at once avoids taking an
+ * interrupt per step, which is what limits the step rate of those engines.
+ * A batch never extends past the end of the current segment, so the
+ * step period is constant within a batch.
+ * Returns true if step interrupts should continue
+ */
+template <int N>
+static bool IRAM_ATTR pulse_batch_n() {
+#ifdef DEBUG_STEPPER_ISR
+    isr_count++;
+#endif
+    if (!awake) {
+        return false;
     }
 
-    st.step_count--;  // Decrement step events count
+    if (!load_segment<N>()) {
+        end_of_motion();
+        return false;
+    }
+
+    // The probe state at the start of a batch corresponds to the position
+    // reached by the previous batch, so sample it before adding more steps.
+    if (probing) {
+        config->_probe->monitor_from_ISR();
+    }
+
+    // While probing, each batch is a single step event so that the probe is
+    // sampled, and can stop motion, at every step.  Homing is not affected.
+    uint32_t n_events = Stepping::startBatch();
+    if (probing && n_events > 1) {
+        n_events = 1;
+    }
+    if (n_events > st.step_count) {
+        n_events = st.step_count;
+    }
+    for (uint32_t i = 0; i < n_events; i++) {
+        Stepping::step(next_step_bits<N>(), st.dir_outbits);
+    }
+
+    st.step_count -= n_events;
     if (st.step_count == 0) {
-        // Segment is complete. Discard current segment and advance segment indexing.
-        st.exec_segment     = NULL;
-        segment_buffer_tail = segment_buffer_tail >= (Stepping::_segments - 1) ? 0 : segment_buffer_tail + 1;
+        end_of_segment();
     }
 
-    Stepping::unstep();
+    Stepping::finishBatch(n_events);
     return true;
 }
 
+bool IRAM_ATTR Stepper::pulse_func() {
+    return pulse_n<0>();
+}
+
+bool IRAM_ATTR Stepper::pulse_batch_func() {
+    return pulse_batch_n<0>();
+}
+
+Stepper::pulse_func_t Stepper::select_pulse_func(bool batched) {
+    switch (Axes::_numberAxis) {
+        case 3:
+            return batched ? pulse_batch_n<3> : pulse_n<3>;
+        case 4:
+            return batched ? pulse_batch_n<4> : pulse_n<4>;
+        case 5:
+            return batched ? pulse_batch_n<5> : pulse_n<5>;
+        case 6:
+            return batched ? pulse_batch_n<6> : pulse_n<6>;
+        default:
+            return batched ? pulse_batch_func : pulse_func;
+    }
+}
+
 // enabled. Startup init and limits call this function but shouldn't start the cycle.
 void Stepper::wake_up() {
     if (awake) {
@@ -293,6 +527,8 @@ void Stepper::go_idle() {
 
 // Reset and clear stepper subsystem variables
 void Stepper::reset() {
+    PrepLock lock;
+
     // Initialize Stepping driver idle state.
     Stepping::reset();
 
@@ -306,6 +542,7 @@ void Stepper::reset() {
     segment_buffer_tail = 0;
     segment_buffer_head = 0;  // empty = tail
     segment_next_head   = 1;
+    prepped_at_rest     = true;
     st.step_outbits     = 0;
     st.dir_outbits      = 0;  // Initialize direction bits to default.
     // TODO do we need to turn step pins off?
@@ -313,6 +550,7 @@ void Stepper::reset() {
 
 // Called by planner_recalculate() when the executing block is updated by the new plan.
 bool Stepper::update_plan_block_parameters() {
+    PrepLock lock;
     if (pl_block != NULL) {  // Ignore if at start of a new block.
         prep.recalculate_flag.recalculate = 1;
         pl_block->entry_speed_sqr         = prep.current_speed * prep.current_speed;  // Update entry speed.
@@ -324,6 +562,8 @@ bool Stepper::update_plan_block_parameters() {
 
 // Changes the run state of the step segment buffer to execute the special parking motion.
 void Stepper::parking_setup_buffer() {
+    PrepLock lock;
+
     // Store step execution data of partially completed block, if necessary.
     if (prep.recalculate_flag.holdPartialBlock) {
         prep.last_st_block_index  = prep.st_block_index;
@@ -339,6 +579,8 @@ void Stepper::parking_setup_buffer() {
 
 // Restores the step segment buffer to the normal run state after a parking motion.
 void Stepper::parking_restore_buffer() {
+    PrepLock lock;
+
     // Restore step execution data and flags of partially completed block, if necessary.
     if (prep.recalculate_flag.holdPartialBlock) {
         st_prep_block                          = &st_block_buffer[prep.last_st_block_index];
@@ -362,6 +604,167 @@ static uint8_t next_block_index(uint8_t block_index) {
     return block_index == (Stepping::_segments - 1) ? 0 : block_index;
 }
 
+/* S-curve ramps.  Acceleration changes linearly from a0 to a peak over the first
+   S_RAMP_RISE of the ramp time T, holds the peak, and changes linearly to a1 over the last
+   S_RAMP_RISE.  A ramp that starts and ends at rest acceleration, a0 = a1 = 0, has an average
+   speed of (v0 + v1) / 2, the same as a constant-acceleration ramp, so a ramp fitted to the
+   distance of a planned ramp takes the same time and ends at the same place, and its peak is
+   1 / (1 - S_RAMP_RISE) = Stepping::sCurvePeakRatio times the planned acceleration.  Where the
+   next block continues a ramp, the ramp keeps the planned acceleration through the junction
+   instead of letting it fall to zero: a1 of this ramp and a0 of the next are both that
+   acceleration.  A block whose ramp continues at both ends then accelerates at a constant rate,
+   and only the ends of a run of such blocks are rounded.  Either way the stepper traces the
+   planner's junction speeds and ramp boundaries exactly.
+   When the moving axes have input shapers, a ramp that starts at zero acceleration is instead
+   shaped by them (see InputShaper.h), which has the same average speed.  Ramps shorter than
+   four times the shaper keep the jerk phases, since squeezing the shaped acceleration into them
+   would raise its peak further.
+*/
+const float S_RAMP_RISE = 1.0f - 1.0f / Stepping::sCurvePeakRatio;
+
+// Fits the S-curve ramp between its speeds to its length, with accelerations a0 and a1 at its
+// ends.  Returns false if that needs the acceleration to reverse in the middle of the ramp.
+static bool fit_s_ramp(float a0, float a1) {
+    float mean_speed = prep.ramp_v0 + 0.5f * prep.ramp_dv;
+    if (mean_speed <= 0.0f || prep.ramp_mm <= 0.0f) {
+        prep.ramp_duration = 0.0f;
+        prep.ramp_a0 = prep.ramp_a1 = prep.ramp_peak = prep.ramp_rise = 0.0f;
+        return true;
+    }
+    // The length is T * mean_speed + T^2 * S_RAMP_RISE * (a0 - a1) * (1/4 - S_RAMP_RISE/6)
+    float c2   = S_RAMP_RISE * (0.25f - S_RAMP_RISE / 6.0f) * (a0 - a1);
+    float disc = mean_speed * mean_speed + 4.0f * c2 * prep.ramp_mm;
+    if (disc < 0.0f) {
+        return false;
+    }
+    float duration = 2.0f * prep.ramp_mm / (mean_speed + sqrtf(disc));
+    float peak     = (prep.ramp_dv / duration - 0.5f * S_RAMP_RISE * (a0 + a1)) / (1.0f - S_RAMP_RISE);
+    if (peak * prep.ramp_dv < 0.0f) {
+        return false;
+    }
+    prep.ramp_duration = duration;
+    prep.ramp_a0       = a0;
+    prep.ramp_a1       = a1;
+    prep.ramp_peak     = peak;
+    prep.ramp_rise     = S_RAMP_RISE * duration;
+    return true;
+}
+
+// The sign of the acceleration at the start of the profile that prep_buffer() computes for block,
+// if it exits at exit_speed_sqr: 1 for acceleration, -1 for deceleration, 0 for cruise or override
+static int profile_start(plan_block_t* block, float exit_speed_sqr) {
+    float nominal_speed = plan_compute_profile_nominal_speed(block);
+    float entry_sqr     = block->entry_speed_sqr;
+    if (entry_sqr > nominal_speed * nominal_speed) {
+        return 0;
+    }
+    float intersect_distance = 0.5f * (block->millimeters + 0.5f * (entry_sqr - exit_speed_sqr) / block->acceleration);
+    if (intersect_distance >= block->millimeters) {
+        return -1;
+    }
+    return entry_sqr < nominal_speed * nominal_speed ? 1 : 0;
+}
+
+// The acceleration that a ramp changing speed by dv can keep at the end of the block, because the
+// next block continues the ramp.  The smaller of the two block accelerations, so that neither
+// ramp exceeds its own.  0 if there is no next block or it does not continue the ramp.
+static float s_ramp_exit_accel(float dv) {
+    float         exit_speed_sqr;
+    plan_block_t* next = plan_get_exec_next_block(exit_speed_sqr);
+    if (next == NULL || dv == 0.0f || profile_start(next, exit_speed_sqr) != (dv > 0.0f ? 1 : -1)) {
+        return 0.0f;
+    }
+    float accel = std::min(pl_block->acceleration, next->acceleration);
+    return dv > 0.0f ? accel : -accel;
+}
+
+// Starts an S-curve ramp from the current speed at start_accel.  A ramp to the end of the block
+// ends at the acceleration that the next block continues with.
+static void start_s_ramp(float end_speed, float start_mm, float end_mm, float start_accel = 0.0f) {
+    prep.ramp_v0       = prep.current_speed;
+    prep.ramp_dv       = end_speed - prep.current_speed;
+    prep.ramp_start_mm = start_mm;
+    prep.ramp_mm       = start_mm - end_mm;
+    prep.ramp_time     = 0.0f;
+    fit_s_ramp(0.0f, 0.0f);
+    prep.ramp_shaped = start_accel == 0.0f && shaper.active() &&
+                       prep.ramp_duration * 60.0f >= shaper.min_ramp_duration(Stepping::sCurvePeakRatio);
+    if (prep.ramp_shaped) {
+        return;
+    }
+    float end_accel = end_mm == 0.0f && end_speed > 0.0f ? s_ramp_exit_accel(prep.ramp_dv) : 0.0f;
+    if (!fit_s_ramp(start_accel, end_accel) && !fit_s_ramp(start_accel, 0.0f)) {
+        fit_s_ramp(0.0f, 0.0f);
+    }
+}
+
+// The shaper works in seconds, the segment generator in minutes
+static float s_ramp_speed(float t) {
+    if (prep.ramp_shaped) {
+        return prep.ramp_v0 + prep.ramp_dv * shaper.speed_fraction(t * 60.0f, prep.ramp_duration * 60.0f);
+    }
+    float rise = prep.ramp_rise;
+    float peak = prep.ramp_peak;
+    if (t < rise) {
+        return prep.ramp_v0 + t * (prep.ramp_a0 + 0.5f * (peak - prep.ramp_a0) * t / rise);
+    }
+    float w = prep.ramp_duration - t;  // Time to the end of the ramp
+    if (w < rise) {
+        return prep.ramp_v0 + prep.ramp_dv - w * (prep.ramp_a1 + 0.5f * (peak - prep.ramp_a1) * w / rise);
+    }
+    return prep.ramp_v0 + 0.5f * rise * (prep.ramp_a0 + peak) + peak * (t - rise);
+}
+
+// Position at time t in the ramp, measured from end of block
+static float s_ramp_mm(float t) {
+    if (prep.ramp_shaped) {
+        float shaped = shaper.distance_fraction(t * 60.0f, prep.ramp_duration * 60.0f) / 60.0f;
+        return prep.ramp_start_mm - t * prep.ramp_v0 - prep.ramp_dv * shaped;
+    }
+    float rise = prep.ramp_rise;
+    float peak = prep.ramp_peak;
+    float mm;
+    float w = prep.ramp_duration - t;
+    if (t < rise) {
+        mm = t * (prep.ramp_v0 + t * (0.5f * prep.ramp_a0 + (peak - prep.ramp_a0) * t / (6.0f * rise)));
+    } else if (w < rise) {
+        float end_speed = prep.ramp_v0 + prep.ramp_dv;
+        mm              = prep.ramp_mm - w * (end_speed - w * (0.5f * prep.ramp_a1 + (peak - prep.ramp_a1) * w / (6.0f * rise)));
+    } else {
+        float rise_speed = prep.ramp_v0 + 0.5f * rise * (prep.ramp_a0 + peak);
+        float rise_mm    = rise * (prep.ramp_v0 + rise * (2.0f * prep.ramp_a0 + peak) / 6.0f);
+        float u          = t - rise;
+        mm               = rise_mm + u * (rise_speed + 0.5f * peak * u);
+    }
+    return prep.ramp_start_mm - mm;
+}
+
+// Cascades the shapers of the given axes
+static void select_shaper(AxisMask axes) {
+    prep.shaper_axes = axes;
+    shaper.reset();
+    auto n_axis = Axes::_numberAxis;
+    for (int axis = 0; axis < n_axis; axis++) {
+        auto a = Axes::_axis[axis];
+        if (bitnum_is_true(axes, axis) && !shaper.add(InputShaper::Type(a->_shaper), a->_shaperFrequency)) {
+            log_warn("Too many input shaper impulses, axis " << Axes::axisName(axis) << " is not shaped");
+        }
+    }
+}
+
+// Position of the end of the ramp, measured from end of block
+static float s_ramp_end_mm() {
+    return prep.ramp_start_mm - prep.ramp_mm;
+}
+
+// Speeds that the planner recomputes for the same junction can differ in the last bits
+static bool same_speed(float a, float b) {
+    return fabsf(a - b) <= 1e-4f * (a + b) + 1e-3f;
+}
+
+static bool planner_empty  = false;  // prep_buffer() has counted the planner running out
+static bool segments_added = false;  // The current prep_buffer() call has added a segment
+
 /* Prepares step segment buffer. Continuously called from main program.
 
    The segment buffer is an intermediary buffer interface between the execution of steps
@@ -375,12 +778,7 @@ static uint8_t next_block_index(uint8_t block_index) {
    Currently, the segment buffer conservatively holds roughly up to 40-50 msec of steps.
    NOTE: Computation units are in steps, millimeters, and minutes.
 */
-void Stepper::prep_buffer() {
-    // Block step prep buffer, while in a suspend state and there is no suspend motion to execute.
-    if (sys.step_control.endMotion) {
-        return;
-    }
-
+static void fill_segment_buffer() {
     while (segment_buffer_tail != segment_next_head) {  // Check if we need to fill the buffer.
         // Determine if we need to load a new planner block or if the block needs to be recomputed.
         if (pl_block == NULL) {
@@ -392,10 +790,19 @@ void Stepper::prep_buffer() {
             }
 
             if (pl_block == NULL) {
+                // Running out after a planned stop is the normal end of a motion
+                if (awake && !planner_empty && !prepped_at_rest) {
+                    planner_empty = true;
+                    Stepper::stats.planner_empty++;
+                }
                 return;  // No planner blocks. Exit.
             }
+            planner_empty = false;
 
             // Check if we need to only recompute the velocity profile or load a new block.
+            bool  recalculating  = prep.recalculate_flag.recalculate && !prep.recalculate_flag.parking;
+            int   last_ramp_type = prep.ramp_type;
+            float carry_accel    = 0.0f;  // Acceleration that the last block ended with
             if (prep.recalculate_flag.recalculate) {
                 if (prep.recalculate_flag.parking) {
                     prep.recalculate_flag.recalculate = 0;
@@ -403,6 +810,9 @@ void Stepper::prep_buffer() {
                     prep.recalculate_flag = {};
                 }
             } else {
+                carry_accel     = prep.exit_accel;
+                prep.exit_accel = 0.0f;
+
                 // Load the Bresenham stepping data for the block.
                 prep.st_block_index = next_block_index(prep.st_block_index);
                 // Prepare and copy Bresenham algorithm segment data from the new planner block, so that
@@ -416,10 +826,17 @@ void Stepper::prep_buffer() {
                 // Bit-shift multiply all Bresenham data by the max AMASS level so that
                 // we never divide beyond the original data anywhere in the algorithm.
                 // If the original data is divided, we can lose a step from integer roundoff.
+                AxisMask moving = 0;
                 for (idx = 0; idx < n_axis; idx++) {
                     st_prep_block->steps[idx] = pl_block->steps[idx] << maxAmassLevel;
+                    if (pl_block->steps[idx]) {
+                        set_bitnum(moving, idx);
+                    }
                 }
                 st_prep_block->step_event_count = pl_block->step_event_count << maxAmassLevel;
+                if (moving != prep.shaper_axes) {
+                    select_shaper(moving);
+                }
 
                 // Initialize segment buffer data for generating the segments.
                 prep.steps_remaining  = (float)pl_block->step_event_count;
@@ -453,6 +870,7 @@ void Stepper::prep_buffer() {
              hold, override the planner velocities and decelerate to the target exit speed.
             */
             prep.mm_complete  = 0.0;  // Default velocity profile complete at 0.0mm from end of block.
+            prep.s_curve      = false;
             float inv_2_accel = 0.5f / pl_block->acceleration;
             if (sys.step_control.executeHold) {  // [Forced Deceleration to Zero Velocity]
                 // Compute velocity profile parameters for a feed hold in-progress. This profile overrides
@@ -529,11 +947,43 @@ void Stepper::prep_buffer() {
                     // prep.decelerate_after = 0.0;
                     prep.maximum_speed = prep.exit_speed;
                 }
+
+                // Shape the ramps as S-curves. If the planner updated the block in the middle of a ramp
+                // that the new profile still reaches, continue that ramp so acceleration stays continuous.
+                prep.s_curve = (Stepping::_sCurve || shaper.active()) && prep.ramp_type != RAMP_DECEL_OVERRIDE;
+                if (prep.s_curve) {
+                    bool  in_ramp     = recalculating && prep.ramp_time < prep.ramp_duration;
+                    float ramp_target = prep.ramp_v0 + prep.ramp_dv;
+                    float decel_mm    = inv_2_accel * (prep.maximum_speed * prep.maximum_speed - exit_speed_sqr);
+                    if (in_ramp && last_ramp_type == RAMP_DECEL && same_speed(ramp_target, prep.exit_speed)) {
+                        prep.ramp_type = RAMP_DECEL;
+                    } else if (in_ramp && last_ramp_type == RAMP_ACCEL && same_speed(ramp_target, prep.maximum_speed) &&
+                               s_ramp_end_mm() >= decel_mm) {
+                        prep.ramp_type        = RAMP_ACCEL;
+                        prep.accelerate_until = s_ramp_end_mm();
+                        prep.decelerate_after = decel_mm;
+                    } else if (prep.ramp_type == RAMP_ACCEL) {
+                        // A ramp that starts the block continues the one that ended the last block
+                        start_s_ramp(prep.maximum_speed, pl_block->millimeters, prep.accelerate_until, std::max(carry_accel, 0.0f));
+                    } else if (prep.ramp_type == RAMP_DECEL) {
+                        start_s_ramp(prep.exit_speed, pl_block->millimeters, prep.mm_complete, std::min(carry_accel, 0.0f));
+                    }
+                }
             }
 
             sys.step_control.updateSpindleSpeed = true;  // Force update whenever updating block.
         }
 
+        if (!segments_added) {
+            segments_added = true;
+            if (awake) {
+                uint32_t queued = (segment_buffer_head + Stepping::_segments - segment_buffer_tail) % Stepping::_segments;
+                if (queued < Stepper::stats.low_water) {
+                    Stepper::stats.low_water = queued;
+                }
+            }
+        }
+
         // Initialize new segment
         volatile segment_t* prep_segment = &segment_buffer[segment_buffer_head];
 
@@ -555,6 +1005,10 @@ void Stepper::prep_buffer() {
           such as from a feed hold.
         */
         float dt_max   = DT_SEGMENT;                                // Maximum segment time
+        if (prep.s_curve && prep.ramp_shaped && prep.ramp_type != RAMP_CRUISE) {
+            // Finer speed steps in shaped ramps, so the segments themselves do not excite the resonance
+            dt_max /= SHAPED_SEGMENT_DIVISOR;
+        }
         float dt       = 0.0;                                       // Initialize segment time
         float time_var = dt_max;                                    // Time worker variable
         float mm_var;                                               // mm-Distance worker variable
@@ -583,6 +1037,31 @@ void Stepper::prep_buffer() {
                     }
                     break;
                 case RAMP_ACCEL:
+                    if (prep.s_curve) {
+                        float t = prep.ramp_time + time_var;
+                        if (t < prep.ramp_duration) {
+                            mm_var = s_ramp_mm(t);
+                            if (mm_var > prep.accelerate_until) {  // Mid-acceleration ramp.
+                                prep.ramp_time     = t;
+                                mm_remaining       = mm_var;
+                                prep.current_speed = s_ramp_speed(t);
+                                break;
+                            }
+                        }
+                        // End of acceleration ramp.
+                        time_var           = prep.ramp_duration - prep.ramp_time;
+                        prep.ramp_time     = prep.ramp_duration;
+                        mm_remaining       = prep.accelerate_until;  // NOTE: 0.0 at EOB
+                        prep.current_speed = prep.maximum_speed;
+                        prep.exit_accel    = prep.ramp_a1;  // Not 0 only at EOB
+                        if (mm_remaining == prep.decelerate_after) {
+                            prep.ramp_type = RAMP_DECEL;
+                            start_s_ramp(prep.exit_speed, mm_remaining, prep.mm_complete);
+                        } else {
+                            prep.ramp_type = RAMP_CRUISE;
+                        }
+                        break;
+                    }
                     // NOTE: Acceleration ramp only computes during first do-while loop.
                     speed_var = pl_block->acceleration * time_var;
                     mm_remaining -= time_var * (prep.current_speed + 0.5f * speed_var);
@@ -610,11 +1089,33 @@ void Stepper::prep_buffer() {
                         time_var       = (mm_remaining - prep.decelerate_after) / prep.maximum_speed;
                         mm_remaining   = prep.decelerate_after;  // NOTE: 0.0 at EOB
                         prep.ramp_type = RAMP_DECEL;
+                        if (prep.s_curve) {
+                            start_s_ramp(prep.exit_speed, mm_remaining, prep.mm_complete);
+                        }
                     } else {  // Cruising only.
                         mm_remaining = mm_var;
                     }
                     break;
                 default:  // case RAMP_DECEL:
+                    if (prep.s_curve) {
+                        float t = prep.ramp_time + time_var;
+                        if (t < prep.ramp_duration) {
+                            mm_var = s_ramp_mm(t);
+                            if (mm_var > prep.mm_complete) {  // Mid-deceleration ramp.
+                                prep.ramp_time     = t;
+                                mm_remaining       = mm_var;
+                                prep.current_speed = s_ramp_speed(t);
+                                break;
+                            }
+                        }
+                        // End of block.
+                        time_var           = prep.ramp_duration - prep.ramp_time;
+                        prep.ramp_time     = prep.ramp_duration;
+                        mm_remaining       = prep.mm_complete;
+                        prep.current_speed = prep.exit_speed;
+                        prep.exit_accel    = prep.ramp_a1;
+                        break;
+                    }
                     // NOTE: mm_var used as a misc worker variable to prevent errors when near zero speed.
                     speed_var = pl_block->acceleration * time_var;  // Used as delta speed (mm/min)
                     if (prep.current_speed > speed_var) {           // Check if at or below zero speed.
@@ -731,6 +1232,8 @@ void Stepper::prep_buffer() {
         // isrPeriod is stored as 16 bits, so limit timerTicks to the
         // largest value that will fit in a uint16_t.
         prep_segment->isrPeriod = timerTicks > 0xffff ? 0xffff : timerTicks;
+        prep_segment->at_rest   = mm_remaining == prep.mm_complete && prep.current_speed < REST_SPEED;
+        prepped_at_rest         = prep_segment->at_rest;
 
         // Segment complete! Increment segment buffer indices, so stepper ISR can immediately execute it.
         auto lastseg        = segment_next_head;
@@ -766,6 +1269,25 @@ void Stepper::prep_buffer() {
     }
 }
 
+void Stepper::prep_buffer() {
+    PrepLock lock;
+
+    // Block step prep buffer, while in a suspend state and there is no suspend motion to execute.
+    if (sys.step_control.endMotion) {
+        return;
+    }
+
+    int32_t start  = getCpuTicks();
+    segments_added = false;
+    fill_segment_buffer();
+    if (segments_added) {
+        uint32_t ticks = getCpuTicks() - start;
+        if (ticks > stats.prep_max_ticks) {
+            stats.prep_max_ticks = ticks;
+        }
+    }
+}
+
 // Called by realtime status reporting to fetch the current speed being executed. This value
 // however is not exactly the current speed, but the speed computed in the last step segment
 // in the segment buffer. It will always be behind by up to the number of segment blocks (-1)
@@ -17,6 +17,12 @@ namespace Stepper {
     void init();
 
     bool pulse_func();
+    bool pulse_batch_func();
+
+    // Returns the step ISR function for the configured number of axes,
+    // batched or not according to the capabilities of the stepping engine
+    using pulse_func_t = bool (*)();
+    pulse_func_t select_pulse_func(bool batched);
 
     // Enable steppers, but cycle does not start unless called by motion control or realtime command.
     void wake_up();
@@ -27,6 +33,9 @@ namespace Stepper {
     // Stops stepping (ISR-safe)
     void stop_stepping();
 
+    // Stops stepping at once and discards the step events queued in hardware, from a pin interrupt
+    void stop_from_ISR();
+
     // Reset the stepper subsystem variables
     void reset();
 
@@ -36,9 +45,26 @@ namespace Stepper {
     // Restores the step segment buffer to the normal run state after a parking motion.
     void parking_restore_buffer();
 
-    // Reloads step segment buffer. Called continuously by realtime execution system.
+    // Reloads step segment buffer. Called continuously by the motion prep task, or by the
+    // realtime execution system when that task is disabled.
     void prep_buffer();
 
+    // True if the motion prep task reloads the step segment buffer
+    bool prep_task_running();
+
+    // Wakes the motion prep task early, after the planner has added a block
+    void notify_prep();
+
+    // Excludes the motion prep task while the planner or the realtime execution system
+    // changes planner blocks or step control flags that prep_buffer() reads.  Recursive.
+    void lock();
+    void unlock();
+
+    struct PrepLock {
+        PrepLock() { lock(); }
+        ~PrepLock() { unlock(); }
+    };
+
     // Called by planner_recalculate() when the executing block is updated by the new plan.
     bool update_plan_block_parameters();
 
@@ -46,4 +72,15 @@ namespace Stepper {
     float get_realtime_rate();
 
     extern uint32_t isr_count;
+
+    // Health of the step segment buffer, for $Stats/Motion
+    struct Stats {
+        uint32_t          low_water;       // Fewest queued segments when prep_buffer() had more to add
+        volatile uint32_t underruns;       // The step ISR ran out of segments while the motion was not stopping
+        uint32_t          planner_empty;   // prep_buffer() ran out of planner blocks while the steppers were running
+        uint32_t          prep_max_ticks;  // Longest prep_buffer() call that added segments
+    };
+    extern Stats stats;
+
+    void clear_stats();
 }
@@ -10,6 +10,7 @@ const int   RAMP_ACCEL              = 0;
 const int   RAMP_CRUISE             = 1;
 const int   RAMP_DECEL              = 2;
 const int   RAMP_DECEL_OVERRIDE     = 3;
+const int   SHAPED_SEGMENT_DIVISOR  = 4;  // Input shaped ramps use segments of DT_SEGMENT / 4
 
 struct PrepFlag {
     uint8_t recalculate : 1;
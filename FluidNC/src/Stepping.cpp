@@ -26,8 +26,10 @@ namespace Machine {
 
     AxisMask Stepping::direction_mask = 0;
 
-    bool   Stepping::_switchedStepper = false;
-    size_t Stepping::_segments        = 12;
+    bool     Stepping::_switchedStepper = false;
+    uint32_t Stepping::_segments        = 12;
+    bool     Stepping::_sCurve          = false;
+    bool     Stepping::_prepTask        = true;
 
     uint32_t Stepping::_idleMsecs           = 255;
     uint32_t Stepping::_pulseUsecs          = 4;
@@ -53,7 +55,10 @@ namespace Machine {
         log_info("Stepping:" << stepTypes[_engine].name << " Pulse:" << _pulseUsecs << "us Dsbl Delay:" << _disableDelayUsecs
                              << "us Dir Delay:" << _directionDelayUsecs << "us Idle Delay:" << _idleMsecs << "ms");
 
-        uint32_t actual = step_engine->init(_directionDelayUsecs, _pulseUsecs, fStepperTimer, Stepper::pulse_func);
+        // Engines that can queue step events get the batched pulse function,
+        // which runs once per batch instead of once per step.
+        auto     pulse_func = Stepper::select_pulse_func(step_engine->start_batch != NULL);
+        uint32_t actual     = step_engine->init(_directionDelayUsecs, _pulseUsecs, fStepperTimer, pulse_func);
         if (actual != _pulseUsecs) {
             log_warn("stepping/pulse_us adjusted to " << actual);
         }
@@ -69,17 +74,24 @@ namespace Machine {
 
 Stepping::motor_t* Stepping::axis_motors[MAX_N_AXIS][MAX_MOTORS_PER_AXIS] = { nullptr };
 
+Stepping::motor_t Stepping::_motors[MAX_N_AXIS * MAX_MOTORS_PER_AXIS];
+int               Stepping::_n_motors = 0;
+
 void Stepping::assignMotor(int axis, int motor, int step_pin, bool step_invert, int dir_pin, bool dir_invert) {
     step_pin = step_engine->init_step_pin(step_pin, step_invert);
 
-    motor_t* m               = new motor_t;
-    axis_motors[axis][motor] = m;
-    m->step_pin              = step_pin;
-    m->step_invert           = step_invert;
-    m->dir_pin               = dir_pin;
-    m->dir_invert            = dir_invert;
-    m->blocked               = false;
-    m->limited               = false;
+    motor_t* m = axis_motors[axis][motor];
+    if (!m) {
+        m                        = &_motors[_n_motors++];
+        axis_motors[axis][motor] = m;
+    }
+    m->step_pin    = step_pin;
+    m->step_invert = step_invert;
+    m->dir_pin     = dir_pin;
+    m->dir_invert  = dir_invert;
+    m->axis_bit    = bitnum_to_mask(axis);
+    m->blocked     = false;
+    m->limited     = false;
 
     if (motor == 0 && dir_invert) {
         set_bitnum(direction_mask, axis);
@@ -107,7 +119,7 @@ void Stepping::unblock(int axis, int motor) {
     }
 }
 
-void Stepping::limit(int axis, int motor) {
+void IRAM_ATTR Stepping::limit(int axis, int motor) {
     auto m = axis_motors[axis][motor];
     if (m) {
         m->limited = true;
@@ -130,39 +142,45 @@ void IRAM_ATTR Stepping::step(uint8_t step_mask, uint8_t dir_mask) {
     }
 
     if (dir_mask != previous_dir_mask) {
-        for (size_t axis = 0; axis < Axes::_numberAxis; axis++) {
-            bool dir     = bitnum_is_true(dir_mask, axis);
-            bool old_dir = bitnum_is_true(previous_dir_mask, axis);
-            if (dir != old_dir) {
-                for (size_t motor = 0; motor < MAX_MOTORS_PER_AXIS; motor++) {
-                    auto m = axis_motors[axis][motor];
-                    if (m) {
-                        step_engine->set_dir_pin(m->dir_pin, dir ^ m->dir_invert);
-                    }
-                }
+        uint8_t changed = dir_mask ^ previous_dir_mask;
+        for (int i = 0; i < _n_motors; i++) {
+            auto& m = _motors[i];
+            if (changed & m.axis_bit) {
+                bool dir = dir_mask & m.axis_bit;
+                step_engine->set_dir_pin(m.dir_pin, dir ^ m.dir_invert);
             }
-            // Some stepper drivers need time between changing direction and doing a pulse.
-            step_engine->finish_dir();
         }
+        // Some stepper drivers need time between changing direction and doing a pulse.
+        step_engine->finish_dir();
         previous_dir_mask = dir_mask;
     }
 
     step_engine->start_step();
 
     // Turn on step pulses for motors that are supposed to step now
-    for (size_t axis = 0; axis < Axes::_numberAxis; axis++) {
-        if (bitnum_is_true(step_mask, axis)) {
-            auto increment = bitnum_is_true(dir_mask, axis) ? -1 : 1;
-            axis_steps[axis] += increment;
-            for (size_t motor = 0; motor < MAX_MOTORS_PER_AXIS; motor++) {
-                auto m = axis_motors[axis][motor];
-                if (m && !m->blocked && !m->limited) {
-                    step_engine->set_step_pin(m->step_pin, !m->step_invert);
-                }
-            }
+    for (int i = 0; i < _n_motors; i++) {
+        auto& m = _motors[i];
+        if ((step_mask & m.axis_bit) && !m.blocked && !m.limited) {
+            step_engine->set_step_pin(m.step_pin, !m.step_invert);
         }
     }
     step_engine->finish_step();
+
+    // Update the position of each axis that stepped
+    for (uint8_t bits = step_mask; bits; bits &= bits - 1) {
+        int axis = __builtin_ctz(bits);
+        axis_steps[axis] += bitnum_is_true(dir_mask, axis) ? -1 : 1;
+    }
+}
+
+// Called only from Stepper::pulse_batch_func.  Returns the number of
+// step events that the engine can take in this batch.
+uint32_t IRAM_ATTR Stepping::startBatch() {
+    return step_engine->start_batch();
+}
+
+void IRAM_ATTR Stepping::finishBatch(uint32_t n_events) {
+    step_engine->finish_batch(n_events);
 }
 
 // Turn all stepper pins off
@@ -170,13 +188,8 @@ void IRAM_ATTR Stepping::unstep() {
     if (step_engine->start_unstep()) {
         return;
     }
-    for (size_t axis = 0; axis < Axes::_numberAxis; axis++) {
-        for (size_t motor = 0; motor < MAX_MOTORS_PER_AXIS; motor++) {
-            auto m = axis_motors[axis][motor];
-            if (m) {
-                step_engine->set_step_pin(m->step_pin, m->step_invert);
-            }
-        }
+    for (int i = 0; i < _n_motors; i++) {
+        step_engine->set_step_pin(_motors[i].step_pin, _motors[i].step_invert);
     }
     step_engine->finish_unstep();
 }
@@ -208,6 +221,8 @@ void Stepping::group(Configuration::HandlerBase& handler) {
     handler.item("dir_delay_us", _directionDelayUsecs, 0, 10);
     handler.item("disable_delay_us", _disableDelayUsecs, 0, 1000000);  // max 1 second
     handler.item("segments", _segments, 6, 20);
+    handler.item("s_curve", _sCurve);
+    handler.item("prep_task", _prepTask);
 }
 
 uint32_t Stepping::maxPulsesPerSec() {
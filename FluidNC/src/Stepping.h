@@ -19,16 +19,23 @@ namespace Machine {
 
         static const int MAX_MOTORS_PER_AXIS = 2;
         struct motor_t {
-            int  step_pin;
-            int  dir_pin;
-            bool step_invert;
-            bool dir_invert;
-            bool blocked;
-            bool limited;
+            int      step_pin;
+            int      dir_pin;
+            AxisMask axis_bit;
+            bool     step_invert;
+            bool     dir_invert;
+            bool     blocked;
+            bool     limited;
         };
         static motor_t* axis_motors[MAX_N_AXIS][MAX_MOTORS_PER_AXIS];
         static int      _n_active_axes;
 
+        // The motors in one flat array, so step() and unstep() can run a
+        // single loop over the motors that exist, instead of a nested loop
+        // over all the axis and motor slots with a null check for each.
+        static motor_t _motors[MAX_N_AXIS * MAX_MOTORS_PER_AXIS];
+        static int     _n_motors;
+
         static void    startPulseTimer();
         static void    waitDirection();  // Wait for direction delay
         static int32_t axis_steps[MAX_N_AXIS];
@@ -52,7 +59,7 @@ namespace Machine {
         // execution lead time there is for other processes to run.  The latency for a feedhold or other
         // override is roughly 10 ms times _segments.
 
-        static size_t _segments;
+        static uint32_t _segments;
 
         static uint32_t _idleMsecs;
         static uint32_t _pulseUsecs;
@@ -61,6 +68,23 @@ namespace Machine {
 
         static int _engine;
 
+        // When _sCurve is set, Stepper::prep_buffer() shapes each acceleration and deceleration
+        // ramp so that acceleration rises and falls linearly (a third order, jerk-limited profile)
+        // instead of switching on and off.  Each change takes a quarter of the ramp, so a ramp
+        // that keeps the duration and distance of the constant-acceleration ramp that the planner
+        // computed peaks at sCurvePeakRatio times the average.  Ramps that continue into the next
+        // block keep the planned acceleration across the junction instead.  The planner divides
+        // block acceleration by that ratio so the configured axis accelerations remain the peak
+        // values.  Ramps shaped by input shapers are kept within the same ratio, so blocks that
+        // move shaped axes are derated the same way.
+        static bool            _sCurve;
+        static constexpr float sCurvePeakRatio = 4.0f / 3.0f;
+
+        // When _prepTask is set, Stepper::prep_buffer() runs in its own high priority task
+        // instead of from the protocol loop, so that a slow GCode line, a file read or a
+        // report does not delay the refill of the step segment buffer.
+        static bool _prepTask;
+
         // Interfaces to stepping engine
         static void init();
 
@@ -76,6 +100,10 @@ namespace Machine {
         static void step(uint8_t step_mask, uint8_t dir_mask);
         static void unstep();
 
+        // Batched stepping, for engines that support it
+        static uint32_t startBatch();
+        static void     finishBatch(uint32_t n_events);
+
         // Used to stop a motor quickly when a limit switch is hit
         static bool* limit_var(int axis, int motor);
         static void  limit(int axis, int motor);
@@ -11,6 +11,7 @@
 #include "Config.h"                 // MAX_N_AXIS
 #include "Machine/MachineConfig.h"  // config
 #include "src/Stepping.h"           // config
+#include "Stepper.h"                // Stepper::PrepLock
 
 #include <cstring>  // memset
 #include <cmath>    // roundf
@@ -20,7 +21,8 @@ system_t sys;
 int32_t  probe_steps[MAX_N_AXIS];  // Last probe position in steps.
 
 void system_reset() {
-    // Reset system variables.
+    // Reset system variables.  sys.step_control is read by the motion prep task.
+    Stepper::PrepLock lock;
     State prior_state = sys.state;
     bool  prior_abort = sys.abort;
     memset(&sys, 0, sizeof(system_t));  // Clear system struct variable.
@@ -119,7 +121,8 @@ const std::map<State, const char*> StateName = {
 void set_state(State s) {
     sys.state = s;
 }
-bool state_is(State s) {
+// Also called from pin edge interrupts
+bool IRAM_ATTR state_is(State s) {
     return sys.state == s;
 }
 
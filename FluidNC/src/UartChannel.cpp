@@ -129,14 +129,12 @@ void UartChannel::flushRx() {
 }
 
 size_t UartChannel::timedReadBytes(char* buffer, size_t length, TickType_t timeout) {
-    // It is likely that _queue will be empty because timedReadBytes() is only
+    // It is likely that _rx will be empty because timedReadBytes() is only
     // used in situations where the UART is not receiving GCode commands
     // and Grbl realtime characters.
-    size_t remlen = length;
-    while (remlen && _queue.size()) {
-        *buffer++ = _queue.front();
-        _queue.pop();
-    }
+    size_t queued = _rx.read(reinterpret_cast<uint8_t*>(buffer), length);
+    buffer += queued;
+    size_t remlen = length - queued;
 
     int res = _uart->timedReadBytes(buffer, remlen, timeout);
     // If res < 0, no bytes were read
@@ -9,7 +9,21 @@
 namespace WebUI {
     TelnetClient::TelnetClient(WiFiClient* wifiClient) : Channel("telnet"), _wifiClient(wifiClient) {}
 
-    void TelnetClient::handle() {}
+    // Moves received data into the channel's ring in blocks, as much as fits
+    void TelnetClient::handle() {
+        if (_state == -1) {
+            return;
+        }
+        uint8_t buffer[64];
+        size_t  room;
+        while ((room = std::min(_rx.free(), sizeof(buffer))) && _wifiClient->available() > 0) {
+            int len = _wifiClient->read(buffer, room);
+            if (len <= 0) {
+                break;
+            }
+            push(buffer, len);
+        }
+    }
 
     void TelnetClient::closeOnDisconnect() {
         if (_state != -1 && !_wifiClient->connected()) {
@@ -56,11 +70,11 @@ namespace WebUI {
     }
 
     int TelnetClient::peek(void) {
-        return _wifiClient->peek();
+        return _rx.empty() ? _wifiClient->peek() : _rx.peek();
     }
 
     int TelnetClient::available() {
-        return _wifiClient->available();
+        return _wifiClient->available() + _rx.size();
     }
 
     int TelnetClient::rx_buffer_available() {
@@ -32,14 +32,12 @@ namespace WebUI {
 
         int id() { return _clientNum; }
 
-        int rx_buffer_available() override { return std::max(0, 256 - int(_queue.size())); }
-
         operator bool() const;
 
         ~WSChannel();
 
         int read() override;
-        int available() override { return _queue.size() + (_rtchar > -1); }
+        int available() override { return _rx.size() + (_rtchar > -1); }
 
         void autoReport() override;
 
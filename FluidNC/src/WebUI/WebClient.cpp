@@ -72,6 +72,10 @@ namespace WebUI {
     void WebClient::sendLine(MsgLevel level, const std::string& line) {
         print_msg(level, line.c_str());
     }
+    void WebClient::sendLine(MsgLevel level, LogBuffer* line) {
+        print_msg(level, line->text);
+        log_buffer_release(line);
+    }
 
     void WebClient::out(const char* s, const char* tag) {
         write((uint8_t*)s, strlen(s));
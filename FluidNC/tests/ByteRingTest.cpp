@@ -0,0 +1,51 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+#include "src/ByteRing.h"
+
+TEST(ByteRing, PushPop) {
+    ByteRing<4> ring;
+    EXPECT_TRUE(ring.empty());
+    EXPECT_EQ(ring.pop(), -1);
+    EXPECT_EQ(ring.peek(), -1);
+
+    for (uint8_t i = 1; i <= 4; i++) {
+        EXPECT_TRUE(ring.push(i));
+    }
+    EXPECT_FALSE(ring.push(5));
+    EXPECT_EQ(ring.size(), 4u);
+    EXPECT_EQ(ring.free(), 0u);
+
+    EXPECT_EQ(ring.peek(), 1);
+    EXPECT_EQ(ring.pop(), 1);
+    EXPECT_TRUE(ring.push(5));
+    for (int i = 2; i <= 5; i++) {
+        EXPECT_EQ(ring.pop(), i);
+    }
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(ByteRing, BulkWrapsAround) {
+    ByteRing<8> ring;
+    uint8_t     in[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+    uint8_t     out[12];
+
+    // Move the indices so that the next write wraps
+    EXPECT_EQ(ring.write(in, 5), 5u);
+    EXPECT_EQ(ring.read(out, 5), 5u);
+
+    // Only what fits is written, and read comes back in order
+    EXPECT_EQ(ring.write(in, 12), 8u);
+    EXPECT_EQ(ring.write(in, 1), 0u);
+    EXPECT_EQ(ring.read(out, 3), 3u);
+    EXPECT_EQ(ring.write(in + 8, 4), 3u);
+    EXPECT_EQ(ring.read(out + 3, 12), 8u);
+    for (int i = 0; i < 11; i++) {
+        EXPECT_EQ(out[i], i);
+    }
+
+    ring.write(in, 6);
+    ring.clear();
+    EXPECT_TRUE(ring.empty());
+    EXPECT_EQ(ring.free(), 8u);
+}
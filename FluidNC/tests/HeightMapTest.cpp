@@ -0,0 +1,126 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+#include "src/HeightMapGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+// A 3x3 grid from (0,0) to (20,10), so the cells are 10 by 5
+static HeightMapGrid make_grid() {
+    HeightMapGrid grid;
+    EXPECT_TRUE(grid.set(0.0f, 0.0f, 20.0f, 10.0f, 3, 3));
+    grid.heights() = { 0.0f, 1.0f, 2.0f,  //
+                       0.5f, 1.5f, 0.0f,  //
+                       1.0f, 3.0f, -1.0f };
+    grid.build();
+    return grid;
+}
+
+TEST(HeightMap, RejectsBadGrids) {
+    HeightMapGrid grid;
+    EXPECT_FALSE(grid.set(0.0f, 0.0f, 10.0f, 10.0f, 1, 3));
+    EXPECT_FALSE(grid.set(0.0f, 0.0f, 10.0f, 10.0f, 3, HeightMapGrid::max_points + 1));
+    EXPECT_FALSE(grid.set(10.0f, 0.0f, 10.0f, 10.0f, 3, 3));
+    EXPECT_FALSE(grid.set(0.0f, 10.0f, 10.0f, 0.0f, 3, 3));
+    EXPECT_TRUE(grid.set(0.0f, 0.0f, 10.0f, 10.0f, 2, 2));
+}
+
+TEST(HeightMap, OffsetAtPoints) {
+    auto grid = make_grid();
+    for (int j = 0; j < 3; j++) {
+        for (int i = 0; i < 3; i++) {
+            EXPECT_NEAR(grid.offset(i * 10.0f, j * 5.0f), grid.height(i, j), 1e-5f) << i << "," << j;
+        }
+    }
+}
+
+TEST(HeightMap, OffsetIsBilinear) {
+    auto grid = make_grid();
+    // Midpoints of edges and the center of the first cell
+    EXPECT_NEAR(grid.offset(5.0f, 0.0f), 0.5f, 1e-5f);
+    EXPECT_NEAR(grid.offset(0.0f, 2.5f), 0.25f, 1e-5f);
+    EXPECT_NEAR(grid.offset(5.0f, 2.5f), 0.75f, 1e-5f);
+
+    // Against the bilinear formula inside the last cell
+    float z00 = 1.5f, z10 = 0.0f, z01 = 3.0f, z11 = -1.0f;
+    for (float u = 0.0f; u <= 1.0f; u += 0.125f) {
+        for (float v = 0.0f; v <= 1.0f; v += 0.125f) {
+            float expected = z00 * (1 - u) * (1 - v) + z10 * u * (1 - v) + z01 * (1 - u) * v + z11 * u * v;
+            EXPECT_NEAR(grid.offset(10.0f + 10.0f * u, 5.0f + 5.0f * v), expected, 1e-5f) << u << "," << v;
+        }
+    }
+}
+
+TEST(HeightMap, OffsetOutsideUsesEdges) {
+    auto grid = make_grid();
+    EXPECT_NEAR(grid.offset(-50.0f, -50.0f), grid.height(0, 0), 1e-5f);
+    EXPECT_NEAR(grid.offset(100.0f, 100.0f), grid.height(2, 2), 1e-5f);
+    EXPECT_NEAR(grid.offset(5.0f, -20.0f), grid.offset(5.0f, 0.0f), 1e-5f);
+    EXPECT_NEAR(grid.offset(30.0f, 7.5f), grid.offset(20.0f, 7.5f), 1e-5f);
+}
+
+TEST(HeightMap, NextCrossing) {
+    auto grid = make_grid();
+
+    // Along X from inside the first cell, crossing x=10 and x=20
+    float from[3] = { 5.0f, 2.0f, 0.0f };
+    float to[3]   = { 25.0f, 2.0f, 1.0f };
+    float t       = grid.next_crossing(from, to, 0.0f);
+    EXPECT_NEAR(t, 0.25f, 1e-5f);
+    t = grid.next_crossing(from, to, t);
+    EXPECT_NEAR(t, 0.75f, 1e-5f);
+    EXPECT_EQ(grid.next_crossing(from, to, t), 1.0f);
+
+    // Backward along a diagonal that crosses x=10 and y=5 at the same point
+    float back_from[3] = { 18.0f, 9.0f, 0.0f };
+    float back_to[3]   = { 2.0f, 1.0f, 0.0f };
+    t                  = grid.next_crossing(back_from, back_to, 0.0f);
+    EXPECT_NEAR(t, 0.5f, 1e-5f);
+    EXPECT_EQ(grid.next_crossing(back_from, back_to, t), 1.0f);
+}
+
+TEST(HeightMap, NextCrossingOutsideGrid) {
+    auto grid = make_grid();
+
+    // Entirely outside the grid, and moving away from it
+    float from[3] = { -10.0f, -10.0f, 0.0f };
+    float to[3]   = { -20.0f, -30.0f, 0.0f };
+    EXPECT_EQ(grid.next_crossing(from, to, 0.0f), 1.0f);
+
+    // Moving into the grid crosses its first line
+    float in_to[3] = { 10.0f, -10.0f, 0.0f };
+    EXPECT_NEAR(grid.next_crossing(from, in_to, 0.0f), 0.5f, 1e-5f);
+
+    // A Z-only move does not cross anything
+    float z_to[3] = { -10.0f, -10.0f, 5.0f };
+    EXPECT_EQ(grid.next_crossing(from, z_to, 0.0f), 1.0f);
+}
+
+TEST(HeightMap, CrossingsSplitIntoCells) {
+    auto grid = make_grid();
+
+    // Each piece between consecutive crossings lies within one cell
+    float from[3] = { -3.0f, 1.0f, 0.0f };
+    float to[3]   = { 23.0f, 10.0f, 0.0f };
+    float t       = 0.0f;
+    int   pieces  = 0;
+    while (t < 1.0f) {
+        float next = grid.next_crossing(from, to, t);
+        ASSERT_GT(next, t);
+        auto cell = [&](float f) {
+            float x = from[0] + f * (to[0] - from[0]);
+            float y = from[1] + f * (to[1] - from[1]);
+            int   i = std::min(std::max(int(floorf(x / 10.0f)), 0), 1);
+            int   j = std::min(std::max(int(floorf(y / 5.0f)), 0), 1);
+            return j * 2 + i;
+        };
+        float eps = 1e-4f;
+        EXPECT_EQ(cell(t + eps), cell(next - eps)) << t << " " << next;
+        EXPECT_EQ(cell(t + eps), cell((t + next) / 2)) << t << " " << next;
+        t = next;
+        ++pieces;
+    }
+    // x=0, y=5, x=10 and x=20 are crossed
+    EXPECT_EQ(pieces, 5);
+}
@@ -0,0 +1,113 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+#include "src/InputShaper.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Simulates an undamped resonance excited by a speed ramp from 0 to 1 over
+// ramp_duration seconds, the way the segment generator produces it: the speed
+// is held constant over segments of segment_time seconds.  Returns the
+// amplitude of the vibration that remains after the ramp ends.
+static float residual_vibration(const InputShaper& shaper, float frequency, float ramp_duration, float segment_time) {
+    const double omega = 2.0 * M_PI * frequency;
+    const double dt    = 1e-6;
+
+    // y is the deflection of the frame, driven by the acceleration of the motion
+    double y = 0.0, ydot = 0.0;
+    double speed = 0.0;
+
+    int n_segments = int(ceilf(ramp_duration / segment_time));
+    for (int segment = 1; segment <= n_segments + 1; segment++) {
+        // Average speed over the segment, from the distance the ramp covers in it
+        double t0 = (segment - 1) * segment_time;
+        double t1 = segment * segment_time;
+        double next_speed;
+        if (t0 >= ramp_duration) {
+            next_speed = 1.0;
+        } else {
+            double end = std::min(t1, double(ramp_duration));
+            double d1  = shaper.active() ? shaper.distance_fraction(end, ramp_duration) : 0.5 * end * end / ramp_duration;
+            double d0  = shaper.active() ? shaper.distance_fraction(t0, ramp_duration) : 0.5 * t0 * t0 / ramp_duration;
+            next_speed = (d1 - d0) / (end - t0);
+        }
+
+        // A speed step is an acceleration impulse
+        ydot -= next_speed - speed;
+        speed = next_speed;
+
+        for (double t = t0; t < t1; t += dt) {
+            ydot -= omega * omega * y * dt;
+            y += ydot * dt;
+        }
+    }
+    return float(sqrt(y * y + (ydot / omega) * (ydot / omega)));
+}
+
+TEST(InputShaper, ImpulsesSumToOne) {
+    for (auto type : { InputShaper::ZV, InputShaper::ZVD, InputShaper::MZV }) {
+        InputShaper shaper;
+        shaper.add(type, 40.0f);
+        shaper.add(type, 55.0f);
+
+        // Full speed and the planned distance at the end of the ramp
+        float ramp = 0.2f;
+        EXPECT_NEAR(shaper.speed_fraction(ramp, ramp), 1.0f, 1e-5f);
+        EXPECT_NEAR(shaper.distance_fraction(ramp, ramp), 0.5f * ramp, 1e-5f);
+    }
+}
+
+TEST(InputShaper, TooManyImpulses) {
+    InputShaper shaper;
+    EXPECT_TRUE(shaper.add(InputShaper::ZVD, 40.0f));
+    EXPECT_TRUE(shaper.add(InputShaper::MZV, 50.0f));
+    EXPECT_TRUE(shaper.add(InputShaper::ZVD, 60.0f));
+    EXPECT_FALSE(shaper.add(InputShaper::ZV, 70.0f));
+    EXPECT_EQ(shaper.impulses(), 27);
+}
+
+TEST(InputShaper, ReducesResidualVibration) {
+    const float frequency = 40.0f;
+    const float ramp      = 0.1125f;    // 4.5 periods, the worst case for an unshaped ramp
+    const float segment   = 0.01f / 4;  // DT_SEGMENT / SHAPED_SEGMENT_DIVISOR, in seconds
+
+    InputShaper none;
+    float       unshaped = residual_vibration(none, frequency, ramp, segment);
+    ASSERT_GT(unshaped, 0.0f);
+
+    for (auto type : { InputShaper::ZV, InputShaper::ZVD, InputShaper::MZV }) {
+        InputShaper shaper;
+        shaper.add(type, frequency);
+        EXPECT_LT(residual_vibration(shaper, frequency, ramp, segment), 0.001f * unshaped) << "type " << type;
+    }
+
+    // The longer shapers tolerate a resonance that is 10% off
+    const float off_frequency = frequency * 1.1f;
+    const float off_ramp      = 4.5f / off_frequency;
+    unshaped                  = residual_vibration(none, off_frequency, off_ramp, segment);
+    for (auto type : { InputShaper::ZVD, InputShaper::MZV }) {
+        InputShaper shaper;
+        shaper.add(type, frequency);
+        EXPECT_LT(residual_vibration(shaper, off_frequency, off_ramp, segment), 0.25f * unshaped) << "type " << type;
+    }
+}
+
+TEST(InputShaper, PeakAcceleration) {
+    for (auto type : { InputShaper::ZV, InputShaper::ZVD, InputShaper::MZV }) {
+        InputShaper shaper;
+        shaper.add(type, 40.0f);
+        shaper.add(type, 55.0f);
+
+        // Acceleration as a multiple of the average over the shortest allowed ramp
+        float ramp = shaper.min_ramp_duration(1.5f);
+        float dt   = ramp / 10000;
+        float peak = 0.0f;
+        for (float t = 0.0f; t < ramp; t += dt) {
+            float accel = (shaper.speed_fraction(t + dt, ramp) - shaper.speed_fraction(t, ramp)) / dt * ramp;
+            peak        = std::max(peak, accel);
+        }
+        EXPECT_LT(peak, 1.5f * 1.001f) << "type " << type;
+        EXPECT_GT(peak, 1.5f * 0.999f) << "type " << type;
+    }
+}
@@ -0,0 +1,103 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+#include "src/Kinematics/ScaraGeometry.h"
+#include "src/Kinematics/TrunnionGeometry.h"
+
+#include <cmath>
+
+// Reference forward kinematics in double precision
+static void scara_reference(double l1, double l2, double shoulder, double elbow, double& x, double& y) {
+    x = l1 * cos(shoulder) + l2 * cos(shoulder + elbow);
+    y = l1 * sin(shoulder) + l2 * sin(shoulder + elbow);
+}
+
+TEST(Scara, InverseMatchesReference) {
+    const float l1 = 250.0f, l2 = 150.0f;
+    for (bool right_handed : { false, true }) {
+        ScaraGeometry arm;
+        arm.set(l1, l2, right_handed);
+
+        for (float x = -390.0f; x <= 390.0f; x += 13.0f) {
+            for (float y = -390.0f; y <= 390.0f; y += 13.0f) {
+                float r = hypotf(x, y);
+                float shoulder, elbow;
+                bool  reachable = arm.inverse(x, y, shoulder, elbow);
+                if (r > l1 + l2 || r < l1 - l2) {
+                    EXPECT_FALSE(reachable);
+                    continue;
+                }
+                ASSERT_TRUE(reachable) << x << "," << y;
+                EXPECT_EQ(right_handed, elbow < 0) << x << "," << y;
+
+                double rx, ry;
+                scara_reference(l1, l2, shoulder, elbow, rx, ry);
+                EXPECT_NEAR(rx, x, 0.01) << x << "," << y;
+                EXPECT_NEAR(ry, y, 0.01) << x << "," << y;
+
+                float fx, fy;
+                arm.forward(shoulder, elbow, fx, fy);
+                EXPECT_NEAR(fx, rx, 0.01) << x << "," << y;
+                EXPECT_NEAR(fy, ry, 0.01) << x << "," << y;
+            }
+        }
+    }
+}
+
+TEST(Scara, Unwrap) {
+    const float pi = 3.14159265f;
+    EXPECT_NEAR(ScaraGeometry::unwrap(-0.9f * pi, 0.9f * pi), 1.1f * pi, 1e-5f);
+    EXPECT_NEAR(ScaraGeometry::unwrap(0.9f * pi, -0.9f * pi), -1.1f * pi, 1e-5f);
+    EXPECT_NEAR(ScaraGeometry::unwrap(0.5f, 4 * pi), 0.5f + 4 * pi, 1e-4f);
+}
+
+// Reference transform with explicit rotation matrices in double precision
+static void trunnion_reference(const double* pivot, const double* work, double a, double c, double* machine) {
+    double rz[3][3] = { { cos(c), -sin(c), 0 }, { sin(c), cos(c), 0 }, { 0, 0, 1 } };
+    double rx[3][3] = { { 1, 0, 0 }, { 0, cos(a), -sin(a) }, { 0, sin(a), cos(a) } };
+    double v[3], w[3];
+    for (int i = 0; i < 3; i++) {
+        v[i] = 0;
+        for (int j = 0; j < 3; j++) {
+            v[i] += rz[i][j] * (work[j] - pivot[j]);
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        w[i] = 0;
+        for (int j = 0; j < 3; j++) {
+            w[i] += rx[i][j] * v[j];
+        }
+        machine[i] = pivot[i] + w[i];
+    }
+}
+
+TEST(Trunnion, MatchesReference) {
+    const double pivot[3] = { 12.5, -40.0, -75.0 };
+
+    TrunnionGeometry table;
+    table.set_pivot(float(pivot[0]), float(pivot[1]), float(pivot[2]));
+
+    const float works[][3] = { { 0, 0, 0 }, { 50, 25, -10 }, { -30, 60, -90 }, { 12.5f, -40, -75 } };
+    for (auto& work : works) {
+        for (float a = -1.6f; a <= 1.6f; a += 0.4f) {
+            for (float c = -3.2f; c <= 3.2f; c += 0.4f) {
+                double work_d[3] = { work[0], work[1], work[2] };
+                double expected[3];
+                trunnion_reference(pivot, work_d, a, c, expected);
+
+                float machine[3];
+                table.to_machine(work, a, c, machine);
+                for (int i = 0; i < 3; i++) {
+                    EXPECT_NEAR(machine[i], expected[i], 1e-3) << "a " << a << " c " << c;
+                }
+
+                float back[3];
+                table.to_work(machine, a, c, back);
+                for (int i = 0; i < 3; i++) {
+                    EXPECT_NEAR(back[i], work[i], 1e-3) << "a " << a << " c " << c;
+                }
+            }
+        }
+        EXPECT_NEAR(table.radius(work), hypot(hypot(work[0] - pivot[0], work[1] - pivot[1]), work[2] - pivot[2]), 1e-3);
+    }
+}
@@ -0,0 +1,84 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+#include "src/LineFrame.h"
+
+#include <cstring>
+#include <string>
+
+TEST(LineFrame, Crc) {
+    // The CRC-16/CCITT check value
+    EXPECT_EQ(LineFrame::crc16("123456789", 9), 0x29b1);
+}
+
+TEST(LineFrame, RoundTrip) {
+    char     line[64];
+    uint16_t seq = 0;
+    size_t   len = LineFrame::encode(line, 0xbeef, "G1 X10 F100");
+    EXPECT_EQ(len, strlen("G1 X10 F100") + LineFrame::overhead);
+    EXPECT_EQ(line[0], LineFrame::start);
+    EXPECT_EQ(strncmp(line + 1, "BEEF", 4), 0);
+
+    EXPECT_EQ(LineFrame::decode(line, seq), LineFrame::Status::Ok);
+    EXPECT_EQ(seq, 0xbeef);
+    EXPECT_STREQ(line, "G1 X10 F100");
+
+    LineFrame::encode(line, 7, "");
+    EXPECT_EQ(LineFrame::decode(line, seq), LineFrame::Status::Ok);
+    EXPECT_EQ(seq, 7);
+    EXPECT_STREQ(line, "");
+}
+
+TEST(LineFrame, TooLong) {
+    // The longest frame fills a 255 character line buffer
+    char        line[256];
+    std::string payload(LineFrame::max_payload, 'X');
+    EXPECT_EQ(LineFrame::encode(line, 1, payload.c_str()), 254);
+
+    line[0] = '\0';
+    payload += 'X';
+    EXPECT_EQ(LineFrame::encode(line, 1, payload.c_str()), 0);
+    EXPECT_STREQ(line, "");
+}
+
+TEST(LineFrame, Tracker) {
+    // Realtime characters inside a frame are payload, and the CRC covers them
+    char line[64];
+    LineFrame::encode(line, 3, "(Tool change? Ready!) G1 X1");
+    strcat(line, "\n?~");
+
+    LineFrame::Tracker tracker;
+    size_t             len = strlen(line);
+    for (size_t i = 0; i < len; i++) {
+        EXPECT_EQ(tracker.inFrame(line[i]), i < len - 3) << i;
+    }
+
+    line[len - 3] = '\0';
+    uint16_t seq;
+    EXPECT_EQ(LineFrame::decode(line, seq), LineFrame::Status::Ok);
+    EXPECT_STREQ(line, "(Tool change? Ready!) G1 X1");
+}
+
+TEST(LineFrame, Rejects) {
+    char     line[64];
+    uint16_t seq;
+
+    strcpy(line, "G1 X10");
+    EXPECT_EQ(LineFrame::decode(line, seq), LineFrame::Status::NotFramed);
+    EXPECT_STREQ(line, "G1 X10");
+
+    LineFrame::encode(line, 1, "G1 X10");
+    line[7] = 'Y';
+    EXPECT_EQ(LineFrame::decode(line, seq), LineFrame::Status::Corrupt);
+
+    LineFrame::encode(line, 1, "G1 X10");
+    line[2] = 'G';  // Not a hex digit
+    EXPECT_EQ(LineFrame::decode(line, seq), LineFrame::Status::Corrupt);
+
+    strcpy(line, "\x02" "0001");
+    EXPECT_EQ(LineFrame::decode(line, seq), LineFrame::Status::Corrupt);
+
+    LineFrame::encode(line, 1, "G1 X10");
+    line[0] = '\x06';  // A damaged start character
+    EXPECT_EQ(LineFrame::decode(line, seq), LineFrame::Status::Corrupt);
+}
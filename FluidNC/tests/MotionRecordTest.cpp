@@ -0,0 +1,154 @@
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+#include "src/MotionRecord.h"
+
+#include <cstring>
+
+using namespace MotionRecord;
+
+namespace {
+    Record arc() {
+        Record record;
+        record.motion     = 3;  // G3
+        record.axes       = 0x3;
+        record.plane      = 0;
+        record.turns      = 2;
+        record.has_line   = true;
+        record.line       = 42;
+        record.has_feed   = true;
+        record.feed       = 1200;
+        record.values[0]  = 10;
+        record.values[1]  = -2.5;
+        record.offsets[0] = 5;
+        record.offsets[1] = 0;
+        return record;
+    }
+
+    // A line of records as CompiledFile::pollLine() builds it, without the record mark
+    size_t line_of(const Record* records, size_t count, size_t n_axis, uint8_t* line) {
+        size_t used = 0;
+        for (size_t i = 0; i < count; i++) {
+            size_t length  = encode(records[i], n_axis, line + used + 2);
+            line[used]     = uint8_t(Type::Motion);
+            line[used + 1] = length;
+            used += 2 + length;
+        }
+        return used;
+    }
+}
+
+TEST(MotionRecord, RoundTrip) {
+    Record  in = arc();
+    uint8_t payload[max_bytes];
+    size_t  length = encode(in, 3, payload);
+    EXPECT_EQ(length, 4 + 4 + 4 + 2 * 4 + 2 * 4);
+
+    Record out;
+    ASSERT_TRUE(decode(payload, length, 3, out));
+    EXPECT_EQ(out.motion, 3);
+    EXPECT_EQ(out.axes, 0x3);
+    EXPECT_EQ(out.plane, 0);
+    EXPECT_EQ(out.turns, 2);
+    EXPECT_TRUE(out.has_line);
+    EXPECT_EQ(out.line, 42);
+    EXPECT_TRUE(out.has_feed);
+    EXPECT_EQ(out.feed, 1200);
+    EXPECT_EQ(out.values[0], 10);
+    EXPECT_EQ(out.values[1], -2.5);
+    EXPECT_EQ(out.offsets[0], 5);
+    EXPECT_EQ(out.offsets[1], 0);
+
+    Record linear;
+    linear.motion    = 1;
+    linear.axes      = 0x24;  // Z and C
+    linear.values[2] = -1;
+    linear.values[5] = 90;
+    length           = encode(linear, 6, payload);
+    EXPECT_EQ(length, 4 + 2 * 4);
+    ASSERT_TRUE(decode(payload, length, 6, out));
+    EXPECT_EQ(out.motion, 1);
+    EXPECT_FALSE(out.has_line);
+    EXPECT_FALSE(out.has_feed);
+    EXPECT_EQ(out.values[2], -1);
+    EXPECT_EQ(out.values[5], 90);
+}
+
+TEST(MotionRecord, RejectsBadFields) {
+    uint8_t payload[max_bytes];
+    Record  out;
+    size_t  length = encode(arc(), 3, payload);
+
+    payload[2] |= 3 << plane_shift;  // No fourth plane
+    EXPECT_FALSE(decode(payload, length, 3, out));
+    encode(arc(), 3, payload);
+
+    payload[0] = 4;  // Not G0 to G3
+    EXPECT_FALSE(decode(payload, length, 3, out));
+    encode(arc(), 3, payload);
+
+    payload[1] = 0x8;  // An axis that the machine does not have
+    EXPECT_FALSE(decode(payload, length, 3, out));
+    encode(arc(), 3, payload);
+
+    EXPECT_FALSE(decode(payload, length - 1, 3, out));  // Truncated
+
+    Record helix = arc();
+    helix.axes   = 0x7;
+    length       = encode(helix, 3, payload);
+    EXPECT_FALSE(decode(payload, length, 2, out));  // Compiled for more axes
+    length = encode(arc(), 3, payload);
+
+    float feed = -1;
+    memcpy(payload + 8, &feed, sizeof(feed));
+    EXPECT_FALSE(decode(payload, length, 3, out));
+}
+
+TEST(MotionRecord, WalksLine) {
+    Record  records[3] = { arc(), arc(), arc() };
+    uint8_t line[256];
+    size_t  used = line_of(records, 3, 3, line);
+
+    const uint8_t* p = line;
+    Record         out;
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(next(p, line + used, 3, out), Status::Ok);
+    }
+    EXPECT_EQ(next(p, line + used, 3, out), Status::End);
+    EXPECT_EQ(p, line + used);
+
+    // A length byte that points past the end of the line
+    p = line;
+    EXPECT_EQ(next(p, line + used - 1, 3, out), Status::Ok);
+    EXPECT_EQ(next(p, line + used - 1, 3, out), Status::Ok);
+    EXPECT_EQ(next(p, line + used - 1, 3, out), Status::Corrupt);
+
+    line[1] = 255;
+    p       = line;
+    EXPECT_EQ(next(p, line + used, 3, out), Status::Corrupt);
+    EXPECT_EQ(p, line);
+
+    line[0] = uint8_t(Type::Text);
+    p       = line;
+    EXPECT_EQ(next(p, line + used, 3, out), Status::Corrupt);
+}
+
+TEST(MotionRecord, ArcEndOnCircle) {
+    float start[2]  = { 0, 0 };
+    float offset[2] = { 5, 0 };
+    float half[2]   = { 10, 0 };
+    EXPECT_TRUE(arc_end_on_circle(start, half, offset));
+
+    float close[2] = { 10.004, 0 };
+    EXPECT_TRUE(arc_end_on_circle(start, close, offset));
+
+    float off[2] = { 10.1, 0 };
+    EXPECT_FALSE(arc_end_on_circle(start, off, offset));
+
+    // 0.1% of a large radius is allowed, but never more than 0.5mm
+    float big_offset[2] = { 1000, 0 };
+    float big_close[2]  = { 2000.4, 0 };
+    float big_off[2]    = { 2000.6, 0 };
+    EXPECT_TRUE(arc_end_on_circle(start, big_close, big_offset));
+    EXPECT_FALSE(arc_end_on_circle(start, big_off, big_offset));
+}
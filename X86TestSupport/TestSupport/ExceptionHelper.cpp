@@ -208,6 +208,21 @@ std::exception CreateException(const char* condition, const char* msg) {
 
 #else
 
+#    include <stdexcept>
+#    include <string>
+#    include <sstream>
+#    include <execinfo.h>
+
+void DumpStackTrace(std::ostringstream& builder) {
+    void* frames[32];
+    int   count   = backtrace(frames, 32);
+    char** symbols = backtrace_symbols(frames, count);
+    for (int i = 0; i < count; ++i) {
+        builder << std::endl << "  " << (symbols ? symbols[i] : "?");
+    }
+    free(symbols);
+}
+
 std::exception CreateException(const char* condition, const char* msg) {
     static std::string container;  // Exception data _must_ be stored in a static string!
     std::ostringstream oss;
@@ -215,7 +230,7 @@ std::exception CreateException(const char* condition, const char* msg) {
     oss << "Error: " << condition << " failed: " << msg << " at: " << std::endl;
 
     container = oss.str();
-    return std::exception(container.c_str()); /* this is usually where you want a breakpoint. */
+    return std::runtime_error(container); /* this is usually where you want a breakpoint. */
 }
 
 #endif
@@ -1,33 +1,24 @@
-#include "../../FluidNC/src/I2SOut.h"
+#include "../../FluidNC/include/Driver/i2s_out.h"
 
-// STUB implementation. Won't do you any good.
+// STUB implementation.  There is no shift register, so written bits are only remembered.
 
-int i2s_out_init() {
-    return 0;
-}
-
-void i2s_out_push() {}
-
-void i2s_out_push_sample(unsigned int x) {}
+static uint32_t i2s_out_bits = 0;
 
-int i2s_out_set_passthrough() {
+int i2s_out_init(i2s_out_init_t* init_param) {
+    i2s_out_bits = init_param->init_val;
     return 0;
 }
 
-int i2s_out_set_stepping() {
-    return 0;
+uint8_t i2s_out_read(pinnum_t pin) {
+    return (i2s_out_bits >> pin) & 1;
 }
 
-void i2s_out_delay() {}
-
-int i2s_out_set_pulse_period(unsigned int x) {
-    return 0;
-}
-
-int i2s_out_reset() {
-    return 0;
+void i2s_out_write(pinnum_t pin, uint8_t val) {
+    if (val) {
+        i2s_out_bits |= 1u << pin;
+    } else {
+        i2s_out_bits &= ~(1u << pin);
+    }
 }
 
-i2s_out_pulser_status_t i2s_out_get_pulser_status() {
-    return i2s_out_pulser_status_t::PASSTHROUGH;
-}
+void i2s_out_delay() {}
@@ -61,6 +61,10 @@ public:
     // default to zero, meaning "a single write may block"
     // should be overriden by subclasses with buffering
     virtual int availableForWrite() { return 0; }
+
+    // As in the ESP32 Arduino core, where flush() moved here from Stream
+    virtual void flush() {}
+
     size_t      print(const String&);
     size_t      print(const char[]);
     size_t      print(char);
@@ -44,10 +44,9 @@ protected:
     int           peekNextDigit();  // returns the next numeric digit in the stream or -1 if timeout
 
 public:
-    virtual int  available() = 0;
-    virtual int  read()      = 0;
-    virtual int  peek()      = 0;
-    virtual void flush()     = 0;
+    virtual int available() = 0;
+    virtual int read()      = 0;
+    virtual int peek()      = 0;
 
     Stream() : _startMillis(0) { _timeout = 1000; }
     virtual ~Stream() {}
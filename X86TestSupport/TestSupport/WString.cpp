@@ -3,12 +3,21 @@
 #include <iomanip>
 #include <sstream>
 
-#pragma warning(disable : 4996)  // itoa
-
 std::string String::ValueToString(int value, int base) {
-    char        buffer[100] = { 0 };
-    int         number_base = 10;
-    std::string output      = itoa(value, buffer, base);
+    // What itoa() does, which not every C library has
+    if (base < 2 || base > 36) {
+        return "";
+    }
+    bool         negative  = base == 10 && value < 0;
+    unsigned int magnitude = negative ? 0u - unsigned(value) : unsigned(value);
+    std::string  output;
+    do {
+        output.insert(output.begin(), "0123456789abcdefghijklmnopqrstuvwxyz"[magnitude % base]);
+        magnitude /= base;
+    } while (magnitude);
+    if (negative) {
+        output.insert(output.begin(), '-');
+    }
     return output;
 }
 
@@ -0,0 +1,5 @@
+#pragma once
+
+// Only the handle type; there is no SPI bus on the host
+struct spi_device_t;
+typedef struct spi_device_t* spi_device_handle_t;
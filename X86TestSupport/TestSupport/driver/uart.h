@@ -5,6 +5,8 @@
 #include "freertos/FreeRTOS.h"
 #include "esp_err.h"
 
+#define UART_FIFO_LEN 128  ///< Length of the UART HW FIFO of the ESP32
+
 /**
  * @brief UART mode selection
  */
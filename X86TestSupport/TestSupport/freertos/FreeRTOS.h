@@ -1,7 +1,7 @@
 #pragma once
 
-#include "Task.h"
-#include "Queue.h"
+#include "task.h"
+#include "queue.h"
 #include "FreeRTOSTypes.h"
 #include <mutex>
 #include <atomic>
@@ -19,13 +19,18 @@ struct portMUX_TYPE {
     void unlock() { lock_.store(false, std::memory_order_release); }
 };
 
-inline void vTaskExitCritical(portMUX_TYPE* mux) {
+inline void vTaskEnterCritical(portMUX_TYPE* mux) {
     mux->lock();
 }
-inline void vTaskEnterCritical(portMUX_TYPE* mux) {
+inline void vTaskExitCritical(portMUX_TYPE* mux) {
     mux->unlock();
 }
 
+#define portENTER_CRITICAL(mux) vTaskEnterCritical(mux)
+#define portEXIT_CRITICAL(mux) vTaskExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux) vTaskEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux) vTaskExitCritical(mux)
+
 inline int32_t xPortGetFreeHeapSize() {
     return 1024 * 1024 * 4;
 }
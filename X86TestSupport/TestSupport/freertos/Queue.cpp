@@ -1,6 +1,7 @@
-#include "Queue.h"
+#include "queue.h"
 
 #include <atomic>
+#include <cstring>
 #include <vector>
 #include <mutex>
 
@@ -60,3 +61,10 @@ BaseType_t xQueueGenericReset(QueueHandle_t xQueue, BaseType_t xNewQueue) {
 BaseType_t xQueueGenericSend(QueueHandle_t xQueue, const void* const pvItemToQueue, TickType_t xTicksToWait, BaseType_t xCopyPosition) {
     return xQueueGenericSendFromISR(xQueue, pvItemToQueue, nullptr, xCopyPosition);
 }
+
+UBaseType_t uxQueueMessagesWaiting(const QueueHandle_t xQueue) {
+    std::lock_guard<std::mutex> lock(xQueue->mutex);
+
+    auto bytes = xQueue->writeIndex + xQueue->data.size() - xQueue->readIndex;
+    return UBaseType_t((bytes % xQueue->data.size()) / xQueue->entrySize);
+}
@@ -1,4 +1,4 @@
-#include "Task.h"
+#include "task.h"
 
 #include "Capture.h"
 #include "../Arduino.h"
@@ -8,10 +8,30 @@
 // each CPU) and then allocate multiple cooperative (non-preemptive) fibers on it.
 
 #include <thread>
-#include <vector>
-#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 
-std::vector<std::unique_ptr<std::thread>> threads;
+// What FreeRTOS keeps in a task control block that the stubs need.  A TaskHandle_t
+// points to one of these.  Tasks run until the program exits, so their threads
+// are detached and their state is never freed; a task that is still waiting at
+// exit must not find its mutex destroyed under it.
+struct TaskState {
+    std::mutex              mutex;
+    std::condition_variable notified;
+    uint32_t                notifications = 0;
+};
+
+// The task that the calling thread runs; threads that were not created by
+// xTaskCreate() get one when they first need it
+static thread_local TaskState* currentTask = nullptr;
+
+static TaskState* current_task() {
+    if (!currentTask) {
+        currentTask = new TaskState();
+    }
+    return currentTask;
+}
 
 BaseType_t xTaskCreatePinnedToCore(TaskFunction_t      pvTaskCode,
                                    const char* const   pcName,
@@ -20,8 +40,14 @@ BaseType_t xTaskCreatePinnedToCore(TaskFunction_t      pvTaskCode,
                                    UBaseType_t         uxPriority,
                                    TaskHandle_t* const pvCreatedTask,
                                    const BaseType_t    xCoreID) {
-    std::unique_ptr<std::thread> thread = std::make_unique<std::thread>(pvTaskCode, pvParameters);
-    threads.emplace_back(std::move(thread));
+    TaskState* task = new TaskState();
+    if (pvCreatedTask) {
+        *pvCreatedTask = task;
+    }
+    std::thread([=]() {
+        currentTask = task;
+        pvTaskCode(pvParameters);
+    }).detach();
     return pdTRUE;
 }
 
@@ -33,6 +59,49 @@ void vTaskDelayUntil(TickType_t* const pxPreviousWakeTime, const TickType_t xTim
     Capture::instance().waitUntil((*pxPreviousWakeTime + xTimeIncrement));
 }
 
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait) {
+    TaskState*                   task = current_task();
+    std::unique_lock<std::mutex> lock(task->mutex);
+    auto                         ready = [task]() { return task->notifications != 0; };
+    if (xTicksToWait == portMAX_DELAY) {
+        task->notified.wait(lock, ready);
+    } else {
+        task->notified.wait_for(lock, std::chrono::milliseconds(xTicksToWait * portTICK_PERIOD_MS), ready);
+    }
+    uint32_t count = task->notifications;
+    if (count) {
+        task->notifications = xClearCountOnExit ? 0 : count - 1;
+    }
+    return count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify) {
+    auto task = static_cast<TaskState*>(xTaskToNotify);
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        ++task->notifications;
+    }
+    task->notified.notify_one();
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t* pxHigherPriorityTaskWoken) {
+    xTaskNotifyGive(xTaskToNotify);
+    if (pxHigherPriorityTaskWoken) {
+        *pxHigherPriorityTaskWoken = pdFALSE;
+    }
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return current_task();
+}
+
+void vTaskPrioritySet(TaskHandle_t xTask, UBaseType_t uxNewPriority) {}
+
+void vTaskSuspend(TaskHandle_t xTaskToSuspend) {}
+
+void vTaskResume(TaskHandle_t xTaskToResume) {}
+
 TickType_t xTaskGetTickCount(void) {
     auto& inst = Capture::instance();
     inst.wait(1);
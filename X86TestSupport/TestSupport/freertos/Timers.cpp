@@ -0,0 +1,50 @@
+#include "timers.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+struct TimerState {
+    TickType_t              period;
+    bool                    autoReload;
+    void*                   id;
+    TimerCallbackFunction_t callback;
+    std::atomic<uint32_t>   generation { 0 };  // Changed by each start and stop
+};
+
+TimerHandle_t xTimerCreate(const char* const       pcTimerName,
+                           const TickType_t        xTimerPeriodInTicks,
+                           const UBaseType_t       uxAutoReload,
+                           void* const             pvTimerID,
+                           TimerCallbackFunction_t pxCallbackFunction) {
+    auto timer        = new TimerState;
+    timer->period     = xTimerPeriodInTicks;
+    timer->autoReload = uxAutoReload;
+    timer->id         = pvTimerID;
+    timer->callback   = pxCallbackFunction;
+    return timer;
+}
+
+BaseType_t xTimerStart(TimerHandle_t xTimer, TickType_t xTicksToWait) {
+    // Starting a running timer restarts its period, as in FreeRTOS
+    uint32_t generation = ++xTimer->generation;
+    std::thread([xTimer, generation]() {
+        do {
+            std::this_thread::sleep_for(std::chrono::milliseconds(xTimer->period * portTICK_PERIOD_MS));
+            if (xTimer->generation != generation) {
+                return;
+            }
+            xTimer->callback(xTimer);
+        } while (xTimer->autoReload);
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTimerStop(TimerHandle_t xTimer, TickType_t xTicksToWait) {
+    ++xTimer->generation;
+    return pdPASS;
+}
+
+void* pvTimerGetTimerID(const TimerHandle_t xTimer) {
+    return xTimer->id;
+}
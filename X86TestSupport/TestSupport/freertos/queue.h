@@ -1,6 +1,6 @@
 #pragma once
 
-#include "Task.h"
+#include "task.h"
 #include "FreeRTOSTypes.h"
 
 #include <queue>
@@ -39,11 +39,15 @@ BaseType_t xQueueGenericReset(QueueHandle_t xQueue, BaseType_t xNewQueue);
 
 BaseType_t xQueueGenericSend(QueueHandle_t xQueue, const void* const pvItemToQueue, TickType_t xTicksToWait, BaseType_t xCopyPosition);
 
+UBaseType_t uxQueueMessagesWaiting(const QueueHandle_t xQueue);
+
 #define xQueueSendFromISR(xQueue, pvItemToQueue, pxHigherPriorityTaskWoken)                                                                \
     xQueueGenericSendFromISR((xQueue), (pvItemToQueue), (pxHigherPriorityTaskWoken), queueSEND_TO_BACK)
 
 #define pdFALSE ((BaseType_t)0)
 #define pdTRUE ((BaseType_t)1)
+#define pdPASS (pdTRUE)
+#define pdFAIL (pdFALSE)
 #define xQueueReceive(xQueue, pvBuffer, xTicksToWait) xQueueGenericReceive((xQueue), (pvBuffer), (xTicksToWait), pdFALSE)
 
 #define queueQUEUE_TYPE_BASE ((uint8_t)0U)
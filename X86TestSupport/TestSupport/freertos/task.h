@@ -4,6 +4,8 @@
 #include "FreeRTOS.h"
 #include "FreeRTOSTypes.h"
 
+#include <climits>
+
 void vTaskDelay(const TickType_t xTicksToDelay);
 
 #define CONFIG_ARDUINO_RUNNING_CORE 0
@@ -27,9 +29,21 @@ static inline IRAM_ATTR BaseType_t xTaskCreate(TaskFunction_t      pvTaskCode,
     return xTaskCreatePinnedToCore(pvTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pvCreatedTask, tskNO_AFFINITY);
 }
 
+// Priorities and suspension are not modeled; tasks are plain threads
+void vTaskPrioritySet(TaskHandle_t xTask, UBaseType_t uxNewPriority);
+void vTaskSuspend(TaskHandle_t xTaskToSuspend);
+void vTaskResume(TaskHandle_t xTaskToResume);
+
 void vTaskDelayUntil(TickType_t* const pxPreviousWakeTime, const TickType_t xTimeIncrement);
 
-TickType_t xTaskGetTickCount(void);
+// Direct to task notifications, used as a counting semaphore.  The timeout is in
+// milliseconds of host time, because a waiting thread does not advance Capture time.
+uint32_t   ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait);
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify);
+void       vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t* pxHigherPriorityTaskWoken);
+
+TickType_t   xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
 
 #define CONFIG_FREERTOS_HZ 1000
 #define configTICK_RATE_HZ (CONFIG_FREERTOS_HZ)
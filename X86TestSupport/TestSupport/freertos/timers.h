@@ -0,0 +1,19 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+// Software timers.  Each started timer is a thread that calls the callback
+// every period of host time.
+struct TimerState;
+typedef TimerState* TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t xTimer);
+
+TimerHandle_t xTimerCreate(const char* const       pcTimerName,
+                           const TickType_t        xTimerPeriodInTicks,
+                           const UBaseType_t       uxAutoReload,
+                           void* const             pvTimerID,
+                           TimerCallbackFunction_t pxCallbackFunction);
+
+BaseType_t xTimerStart(TimerHandle_t xTimer, TickType_t xTicksToWait);
+BaseType_t xTimerStop(TimerHandle_t xTimer, TickType_t xTicksToWait);
+void*      pvTimerGetTimerID(const TimerHandle_t xTimer);
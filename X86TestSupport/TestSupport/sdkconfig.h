@@ -0,0 +1,4 @@
+#pragma once
+
+// The host build stands in for a plain ESP32
+#define CONFIG_IDF_TARGET_ESP32 1
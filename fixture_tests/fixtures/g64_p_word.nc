@@ -0,0 +1,40 @@
+# G64 P is the path tolerance.  A block that sets it cannot also use P for
+# another command, and G64 without P leaves P to the other commands.
+=> ./config.yaml /littlefs/config.yaml
+-> $Bye
+<... * Grbl 3.8*
+-> $X
+<~ [MSG:INFO: Caution: Unlocked]
+<- ok
+-> G21 G90 G54
+<- ok
+# M62 P is the output pin
+-> G64 M62 P0
+<- error:25
+<- [MSG:ERR: Gcode word repeated]
+# G2 P is the number of turns
+-> G64 P0.05 G2 X10 Y0 I5 J0
+<- error:25
+<- [MSG:ERR: Gcode word repeated]
+# An arc in G64 mode without P is valid
+-> G64 G2 X10 Y0 I5 J0
+<- ok
+-> G0 X0 Y0
+<- ok
+-> G4 G64 P1
+<- error:25
+<- [MSG:ERR: Gcode word repeated]
+-> G10 L2 G64 P1 X0
+<- error:25
+<- [MSG:ERR: Gcode word repeated]
+-> G38.2 G64 Z-1 F100 P1
+<- error:25
+<- [MSG:ERR: Gcode word repeated]
+-> M66 G64 P0 L0
+<- error:25
+<- [MSG:ERR: Gcode word repeated]
+# P on its own line sets the tolerance
+-> G64 P0.05
+<- ok
+-> G61
+<- ok
@@ -0,0 +1,282 @@
+"""Sender side of the framed line protocol enabled with $Channel/Framing=ON.
+
+Each line is sent as STX, a 4 hex digit sequence number, the line, and the
+4 hex digit CRC-16/CCITT of the sequence number and the line.  The
+controller acknowledges in batches:
+
+  [ACK:seq,window]       frames up to seq have been executed
+  [ERR:seq,code,window]  frame seq failed, earlier frames were executed
+  [NAK:seq,window]       frame seq was corrupt or missing, resend from seq
+
+window is the number of bytes the sender may have in flight beyond seq.
+"""
+
+import random
+import re
+import socket
+import time
+from collections import deque
+
+import serial
+
+STX = "\x02"
+OVERHEAD = 9
+MAX_PAYLOAD = 254 - OVERHEAD  # Channel::maxLine less the terminator
+
+_REPLY = re.compile(r"^\[(ACK|ERR|NAK|FRAMING):([0-9,]+)\]$")
+
+
+def crc16(data, crc=0xFFFF):
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def encode(seq, payload):
+    """Raises ValueError if the payload would not fit in a line of input"""
+    if len(payload.encode("utf-8")) > MAX_PAYLOAD:
+        raise ValueError(f"Line too long: {payload}")
+    body = f"{seq & 0xFFFF:04X}{payload}".encode("utf-8")
+    return STX.encode() + body + f"{crc16(body):04X}\n".encode()
+
+
+class SerialTransport:
+    def __init__(self, device, baudrate):
+        self._serial = serial.Serial(device, baudrate, timeout=0.05)
+
+    def write(self, data):
+        self._serial.write(data)
+
+    def readline(self):
+        return self._serial.readline().decode("utf-8", "replace").strip() or None
+
+    def close(self):
+        self._serial.close()
+
+
+class SocketTransport:
+    """A Telnet connection, host:port with port 23 by default"""
+
+    def __init__(self, address):
+        host, _, port = address.partition(":")
+        self._socket = socket.create_connection((host, int(port or 23)))
+        self._socket.settimeout(0.05)
+        self._buffer = b""
+
+    def write(self, data):
+        self._socket.sendall(data)
+
+    def readline(self):
+        while b"\n" not in self._buffer:
+            try:
+                data = self._socket.recv(4096)
+            except socket.timeout:
+                return None
+            if not data:
+                return None
+            self._buffer += data
+        line, _, self._buffer = self._buffer.partition(b"\n")
+        return line.decode("utf-8", "replace").strip()
+
+    def close(self):
+        self._socket.close()
+
+
+class LoopbackController:
+    """A host stand-in for Channel's framing, for exercising the sender
+    without hardware.  It corrupts and drops some of what it receives and
+    executes a few lines per read, like a busy controller."""
+
+    def __init__(self, capacity=256, error_rate=0.02, seed=1):
+        self._capacity = capacity
+        self._rx = bytearray()
+        self._out = deque()
+        self._random = random.Random(seed)
+        self._error_rate = error_rate
+        self._framing = False
+        self._expected = 0
+        self._nak_sent = False
+        self._pending = None
+        self._ack_bytes = 0
+        self.executed = []
+
+    def _window(self):
+        # Lines are executed as soon as they are read, so the whole buffer is
+        # available beyond the last executed frame
+        return self._capacity
+
+    def write(self, data):
+        for byte in data:
+            if len(self._rx) >= self._capacity:
+                continue  # Overrun
+            if self._framing and self._random.random() < self._error_rate / 32:
+                byte ^= 0x04  # Line noise
+            self._rx.append(byte)
+
+    def _line(self, line):
+        if line == "$Channel/Framing=ON":
+            self._framing = True
+            self._expected = 0
+            self._out.append(f"[FRAMING:{self._window()}]")
+            self._out.append("ok")
+            return
+        if line == "$Channel/Framing=OFF":
+            self._framing = False
+            self._out.append("ok")
+            return
+        if not (self._framing and line[:1] < " "):
+            self._out.append("ok")
+            return
+        try:
+            seq, crc = int(line[1:5], 16), int(line[-4:], 16)
+        except ValueError:
+            seq, crc = None, None
+        if not line.startswith(STX) or len(line) < OVERHEAD or crc != crc16(line[1:-4].encode("utf-8")):
+            self._nak()
+            return
+        ahead = (seq - self._expected) & 0xFFFF
+        if ahead >= 0x8000:
+            self._pending = (self._expected - 1) & 0xFFFF
+            return
+        if ahead:
+            self._nak()
+            return
+        self._expected = (self._expected + 1) & 0xFFFF
+        self._nak_sent = False
+        self.executed.append(line[5:-4])
+        self._pending = seq
+        self._ack_bytes += len(line) + 1
+        if self._ack_bytes >= self._capacity // 4:
+            self._ack()
+
+    def _nak(self):
+        if not self._nak_sent:
+            self._out.append(f"[NAK:{self._expected},{self._window()}]")
+            self._nak_sent = True
+
+    def _ack(self):
+        self._out.append(f"[ACK:{self._pending},{self._window()}]")
+        self._pending = None
+        self._ack_bytes = 0
+
+    def readline(self):
+        for _ in range(self._random.randint(1, 4)):
+            end = self._rx.find(b"\n")
+            if end < 0:
+                break
+            line = self._rx[:end].decode("utf-8", "replace")
+            del self._rx[: end + 1]
+            self._line(line)
+        if not self._out and self._pending is not None and b"\n" not in self._rx:
+            self._ack()
+        return self._out.popleft() if self._out else None
+
+    def close(self):
+        pass
+
+
+class FramedSender:
+    def __init__(self, transport, timeout=2.0, verbose=False):
+        self._transport = transport
+        self._timeout = timeout
+        self._verbose = verbose
+        self.errors = []
+        self.resends = 0
+
+    def _log(self, text):
+        if self._verbose:
+            print(text)
+
+    def _command(self, line):
+        """Sends an ordinary line and returns the replies up to ok"""
+        self._transport.write(line.encode("utf-8") + b"\n")
+        replies = []
+        deadline = time.monotonic() + self._timeout
+        while time.monotonic() < deadline:
+            reply = self._transport.readline()
+            if reply is None:
+                continue
+            if reply == "ok":
+                return replies
+            if reply.startswith("error:"):
+                raise RuntimeError(f"{line}: {reply}")
+            replies.append(reply)
+        raise TimeoutError(line)
+
+    def _to_index(self, seq, base):
+        """Converts a 16-bit sequence number to an index near base"""
+        ahead = (seq - base) & 0xFFFF
+        return base + ahead if ahead < 0x8000 else base - (0x10000 - ahead)
+
+    def stream(self, lines):
+        window = None
+        for reply in self._command("$Channel/Framing=ON"):
+            match = _REPLY.match(reply)
+            if match and match.group(1) == "FRAMING":
+                window = int(match.group(2))
+        if window is None:
+            raise RuntimeError("The controller does not support framing")
+
+        frames = [encode(seq, line) for seq, line in enumerate(lines)]
+
+        base = 0  # Oldest unacknowledged frame
+        sent = 0  # Next frame to send
+        stale = 0  # Bytes sent before a NAK that the controller will drop
+        stale_until = 0  # Stale bytes are gone once this frame is acknowledged
+        in_flight = 0
+        last_reply = time.monotonic()
+
+        while base < len(frames):
+            # A frame that is the only one outstanding is always sent, so that
+            # a window that is full of stale bytes cannot stall the stream
+            while sent < len(frames) and (sent == base or in_flight + stale + len(frames[sent]) <= window):
+                self._transport.write(frames[sent])
+                in_flight += len(frames[sent])
+                sent += 1
+
+            reply = self._transport.readline()
+            if reply is None:
+                if time.monotonic() - last_reply > self._timeout and sent > base:
+                    # The ack or NAK was lost; resending makes the controller ack again
+                    self._log(f"timeout, resending from {base}")
+                    stale += in_flight
+                    stale_until = base + 1
+                    in_flight = 0
+                    sent = base
+                    self.resends += 1
+                    last_reply = time.monotonic()
+                continue
+            last_reply = time.monotonic()
+
+            match = _REPLY.match(reply)
+            if not match:
+                print(reply)
+                continue
+            kind = match.group(1)
+            fields = [int(field) for field in match.group(2).split(",")]
+            index = self._to_index(fields[0], base)
+            window = fields[-1]
+
+            if kind == "NAK":
+                if base <= index < sent:
+                    self._log(f"NAK {index}, resending")
+                    stale += sum(len(frame) for frame in frames[index:sent])
+                    in_flight -= sum(len(frame) for frame in frames[index:sent])
+                    stale_until = index + 1
+                    sent = index
+                    self.resends += 1
+                continue
+
+            if kind == "ERR":
+                self.errors.append((index, fields[1]))
+                print(f"error:{fields[1]} at line {index + 1}: {lines[index]}")
+            if index >= base:
+                in_flight -= sum(len(frame) for frame in frames[base : index + 1])
+                base = index + 1
+                if base >= stale_until:
+                    stale = 0
+
+        self._command("$Channel/Framing=OFF")